@@ -0,0 +1,276 @@
+#ifndef CHROME_PLUS_SRC_ACCESSIBLETREE_H_
+#define CHROME_PLUS_SRC_ACCESSIBLETREE_H_
+
+#include <algorithm>
+#include <concepts>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// The tree algorithms behind iaccessible.h, written against a node concept
+// instead of `IAccessible`, so that they do not depend on Windows.
+
+// The MSAA roles and states the algorithms look at, with the values
+// <oleacc.h> gives them.
+inline constexpr long kRoleMenuItem = 0x0C;
+inline constexpr long kRolePane = 0x10;
+inline constexpr long kRoleToolbar = 0x16;
+inline constexpr long kRolePageTab = 0x25;
+inline constexpr long kRoleText = 0x2A;
+inline constexpr long kRolePushButton = 0x2B;
+inline constexpr long kRolePageTabList = 0x3C;
+
+inline constexpr long kStateFocused = 0x4;
+
+// What the algorithms need from a tree. `Node` is a cheap handle that
+// converts to false when empty, and `Rect` has `left`, `top`, `right` and
+// `bottom` in screen coordinates. `ForEachChild` calls `f` for each visible
+// child in order until it returns true.
+template <typename Tree>
+concept AccessibleTree =
+    requires(const Tree& tree, const typename Tree::Node& node) {
+      static_cast<bool>(node);
+      { tree.Role(node) } -> std::convertible_to<long>;
+      { tree.State(node) } -> std::convertible_to<long>;
+      { tree.Parent(node) } -> std::convertible_to<typename Tree::Node>;
+      {
+        tree.Location(node)
+      } -> std::same_as<std::optional<typename Tree::Rect>>;
+      tree.Description(node, [](std::wstring_view) {});
+      tree.ForEachChild(node,
+                        [](const typename Tree::Node&) { return false; });
+    };
+
+// Like `PtInRect`: the right and bottom edges are outside.
+bool RectContains(const auto& rect, const auto& pt) {
+  return pt.x >= rect.left && pt.x < rect.right && pt.y >= rect.top &&
+         pt.y < rect.bottom;
+}
+
+inline bool IsBrowserUIContainer(long role) {
+  // We should keep these restrictions to avoid unbounded DFS, which may
+  // traverse into unexpected subtree (e.g. web content) instead of staying
+  // within the browser UI tree. We might get buggy controls or false
+  // positives (#56, #191).
+  return role == kRolePane || role == kRoleToolbar;
+}
+
+// Recursively find an element with the specified role, with or without pruning.
+// To find a element when specifing more than one condition (e.g. name
+// description, state, etc), use lambda to recurse manually.
+template <AccessibleTree Tree, typename Predicate>
+typename Tree::Node FindElementWithRole(const Tree& tree,
+                                        const typename Tree::Node& node,
+                                        long target_role,
+                                        Predicate predicate) {
+  typename Tree::Node element{};
+  if (!node) {
+    return element;
+  }
+  tree.ForEachChild(node, [&](const typename Tree::Node& child) {
+    const auto child_role = tree.Role(child);
+    if (child_role == target_role) {
+      element = child;
+      return true;
+    } else if (predicate(child_role)) {
+      element = FindElementWithRole(tree, child, target_role, predicate);
+      if (element) {
+        return true;
+      }
+    }
+    return false;
+  });
+  return element;
+}
+
+// Trees that can remember searches provide `RememberFind`, which returns the
+// result of an earlier search for `target_role` below `node` or else calls
+// `find` and keeps its result.
+template <AccessibleTree Tree>
+typename Tree::Node FindElementWithRole(const Tree& tree,
+                                        const typename Tree::Node& node,
+                                        long target_role) {
+  auto find = [&] {
+    return FindElementWithRole(tree, node, target_role, IsBrowserUIContainer);
+  };
+  if constexpr (requires { tree.RememberFind(node, target_role, find); }) {
+    return tree.RememberFind(node, target_role, find);
+  } else {
+    return find();
+  }
+}
+
+// The pane that holds the tabs, which is the parent of the first tab.
+template <AccessibleTree Tree>
+typename Tree::Node FindPageTabPane(const Tree& tree,
+                                    const typename Tree::Node& top) {
+  auto page_tab_list = FindElementWithRole(tree, top, kRolePageTabList);
+  if (!page_tab_list) {
+    return {};
+  }
+  auto page_tab = FindElementWithRole(tree, page_tab_list, kRolePageTab);
+  if (!page_tab) {
+    return {};
+  }
+  return tree.Parent(page_tab);
+}
+
+template <AccessibleTree Tree>
+std::vector<typename Tree::Node> CollectTabs(const Tree& tree,
+                                             const typename Tree::Node& top) {
+  std::vector<typename Tree::Node> tabs;
+  auto page_tab_pane = FindPageTabPane(tree, top);
+  if (!page_tab_pane) {
+    return tabs;
+  }
+  tree.ForEachChild(page_tab_pane, [&](const typename Tree::Node& child) {
+    if (tree.Role(child) == kRolePageTab) {
+      tabs.push_back(child);
+    }
+    return false;
+  });
+  return tabs;
+}
+
+// How many tabs follow `tab` in its tab strip, which is how far it is from the
+// end, or nothing if `tab` is not among the children of its parent. Only the
+// siblings are read, not the whole strip.
+template <AccessibleTree Tree>
+std::optional<int> CountTabsAfter(const Tree& tree,
+                                  const typename Tree::Node& tab) {
+  auto page_tab_pane = tree.Parent(tab);
+  if (!page_tab_pane) {
+    return std::nullopt;
+  }
+  bool found = false;
+  int count = 0;
+  tree.ForEachChild(page_tab_pane, [&](const typename Tree::Node& child) {
+    if (!found) {
+      found = child == tab;
+    } else if (tree.Role(child) == kRolePageTab) {
+      ++count;
+    }
+    return false;
+  });
+  return found ? std::optional<int>(count) : std::nullopt;
+}
+
+// Whether `pt` is on a bookmark below `root`. Bookmarks are buttons or menu
+// items whose description is their URL. This walks the whole subtree, since
+// bookmark folders can open anywhere.
+template <AccessibleTree Tree>
+bool IsBookmarkAt(const Tree& tree,
+                  const typename Tree::Node& root,
+                  const auto& pt) {
+  bool flag = false;
+  auto find_bookmark = [&](this auto&& self,
+                           const typename Tree::Node& child) -> bool {
+    auto role = tree.Role(child);
+    if (role == kRolePushButton || role == kRoleMenuItem) {
+      auto rect = tree.Location(child);
+      if (rect && RectContains(*rect, pt)) {
+        tree.Description(child, [&flag](std::wstring_view description) {
+          flag = (description.find_first_of(L".:") !=
+                  std::wstring_view::npos) &&
+                 (description.substr(0, 11) != L"javascript:");
+        });
+        if (flag) {
+          return true;  // Stop traversing if found.
+        }
+      }
+    }
+    // traverse the child nodes.
+    if (child) {
+      tree.ForEachChild(child, self);
+    }
+    return flag;
+  };
+  // Start traversing.
+  if (root) {
+    tree.ForEachChild(root, find_bookmark);
+  }
+  return flag;
+}
+
+// Whether the focused element is the text field of a toolbar below `top`,
+// which is the omnibox.
+template <AccessibleTree Tree>
+bool HasFocusedOmnibox(const Tree& tree, const typename Tree::Node& top) {
+  if (!top) {
+    return false;
+  }
+
+  bool is_focused = false;
+  auto find_focused = [&](this auto&& self,
+                          const typename Tree::Node& node) -> bool {
+    if (tree.Role(node) == kRoleText &&
+        (tree.State(node) & kStateFocused)) {
+      is_focused = true;
+      return true;
+    }
+    tree.ForEachChild(node, self);
+    return is_focused;
+  };
+
+  auto find_toolbar = [&](this auto&& self,
+                          const typename Tree::Node& node) -> bool {
+    if (tree.Role(node) == kRoleToolbar) {
+      find_focused(node);
+      return is_focused;
+    }
+    tree.ForEachChild(node, self);
+    return is_focused;
+  };
+  tree.ForEachChild(top, find_toolbar);
+  return is_focused;
+}
+
+// Regions sorted by their start along the main axis of the tab strip, so that
+// a hit test is a binary search followed by a short backwards scan. `Item`
+// has a `rect`.
+template <typename Item>
+struct RegionIndex {
+  std::vector<Item> items;
+  long max_extent = 0;
+};
+
+long RegionStart(const auto& rect, bool horizontal) {
+  return horizontal ? rect.left : rect.top;
+}
+
+template <typename Item>
+void SortRegions(RegionIndex<Item>& index, bool horizontal) {
+  std::ranges::sort(index.items, {}, [horizontal](const Item& item) {
+    return RegionStart(item.rect, horizontal);
+  });
+  index.max_extent = 0;
+  for (const auto& item : index.items) {
+    const auto& rect = item.rect;
+    long extent = horizontal ? rect.right - rect.left : rect.bottom - rect.top;
+    index.max_extent = std::max(index.max_extent, extent);
+  }
+}
+
+template <typename Item>
+const Item* HitRegion(const RegionIndex<Item>& index,
+                      bool horizontal,
+                      const auto& pt) {
+  long value = horizontal ? pt.x : pt.y;
+  auto it = std::ranges::upper_bound(
+      index.items, value, {}, [horizontal](const Item& item) {
+        return RegionStart(item.rect, horizontal);
+      });
+  while (it != index.items.begin()) {
+    --it;
+    // Every earlier region starts even further away, so none can reach `pt`.
+    if (RegionStart(it->rect, horizontal) + index.max_extent <= value) {
+      break;
+    }
+    if (RectContains(it->rect, pt)) {
+      return &*it;
+    }
+  }
+  return nullptr;
+}
+
+#endif  // CHROME_PLUS_SRC_ACCESSIBLETREE_H_
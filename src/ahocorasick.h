@@ -0,0 +1,184 @@
+#ifndef CHROME_PLUS_SRC_AHOCORASICK_H_
+#define CHROME_PLUS_SRC_AHOCORASICK_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Aho-Corasick automaton that finds every occurrence of a set of patterns in a
+// single pass over the text.
+template <typename CharT>
+class AhoCorasick {
+ public:
+  AhoCorasick() : nodes_(1), transitions_(kDense ? kAlphabetSize : 0) {}
+
+  // Adds a non-empty `pattern` and returns its id, which is the number of
+  // patterns added before it. `Build` must be called again afterwards.
+  size_t Add(std::basic_string_view<CharT> pattern) {
+    uint32_t state = 0;
+    for (CharT c : pattern) {
+      uint32_t next = Child(state, c);
+      if (next == kNone) {
+        next = static_cast<uint32_t>(nodes_.size());
+        auto& edges = nodes_[state].next;
+        auto it = std::ranges::lower_bound(edges, c, {}, &Edge::first);
+        edges.insert(it, {c, next});
+        nodes_.emplace_back();
+      }
+      state = next;
+    }
+    size_t id = lengths_.size();
+    lengths_.push_back(pattern.size());
+    if (!pattern.empty()) {
+      nodes_[state].outputs.push_back(static_cast<uint32_t>(id));
+    }
+    return id;
+  }
+
+  // Computes the failure links. Breadth-first order guarantees that the link
+  // of a node's parent is final before the node itself is visited.
+  void Build() {
+    std::queue<uint32_t> pending;
+    std::vector<uint32_t> order;
+    order.reserve(nodes_.size());
+    for (const auto& [c, child] : nodes_[0].next) {
+      nodes_[child].fail = 0;
+      nodes_[child].dict_link = kNone;
+      pending.push(child);
+    }
+    while (!pending.empty()) {
+      uint32_t state = pending.front();
+      pending.pop();
+      order.push_back(state);
+      for (const auto& [c, child] : nodes_[state].next) {
+        uint32_t fail = nodes_[state].fail;
+        uint32_t target = Child(fail, c);
+        while (fail != 0 && target == kNone) {
+          fail = nodes_[fail].fail;
+          target = Child(fail, c);
+        }
+        Node& node = nodes_[child];
+        node.fail = target == kNone ? 0 : target;
+        const Node& fallback = nodes_[node.fail];
+        node.dict_link =
+            fallback.outputs.empty() ? fallback.dict_link : node.fail;
+        pending.push(child);
+      }
+    }
+    if constexpr (kDense) {
+      BuildTransitions(order);
+    }
+  }
+
+  bool empty() const { return lengths_.empty(); }
+  size_t size() const { return lengths_.size(); }
+  size_t length(size_t id) const { return lengths_[id]; }
+
+  // Calls `f(id, end)` for every occurrence of every pattern in `text`, where
+  // `end` is the offset just past the match. Occurrences are reported in
+  // order of `end`; ones sharing an end are reported longest first.
+  template <typename F>
+  void Match(std::basic_string_view<CharT> text, F&& f) const {
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+      state = Step(state, text[i]);
+      uint32_t output = nodes_[state].outputs.empty()
+                            ? nodes_[state].dict_link
+                            : state;
+      for (; output != kNone; output = nodes_[output].dict_link) {
+        for (uint32_t id : nodes_[output].outputs) {
+          f(static_cast<size_t>(id), i + 1);
+        }
+      }
+    }
+  }
+
+  // Whether any pattern occurs in `text`, stopping at the first occurrence.
+  bool Contains(std::basic_string_view<CharT> text) const {
+    if (empty()) {
+      return false;
+    }
+    uint32_t state = 0;
+    for (CharT c : text) {
+      state = Step(state, c);
+      if (!nodes_[state].outputs.empty() || nodes_[state].dict_link != kNone) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+  // Single-byte characters get a complete transition table with a row of
+  // `kAlphabetSize` next states per node, so that a step is one load instead
+  // of a search of the edges and the failure links. Wider characters would
+  // need rows far too large and keep the sparse edges.
+  static constexpr bool kDense = sizeof(CharT) == 1;
+  static constexpr size_t kAlphabetSize = 256;
+
+  using Edge = std::pair<CharT, uint32_t>;
+
+  struct Node {
+    // Sorted by character.
+    std::vector<Edge> next;
+    uint32_t fail = 0;
+    // Closest node on the failure chain that ends a pattern.
+    uint32_t dict_link = kNone;
+    std::vector<uint32_t> outputs;
+  };
+
+  uint32_t Child(uint32_t state, CharT c) const {
+    const auto& edges = nodes_[state].next;
+    auto it = std::ranges::lower_bound(edges, c, {}, &Edge::first);
+    return it != edges.end() && it->first == c ? it->second : kNone;
+  }
+
+  // Fills in the rows of `transitions_` in breadth-first `order`, so that the
+  // row of a node's failure link, which is shallower, is already final: a
+  // node moves like its failure link, except along its own edges.
+  void BuildTransitions(const std::vector<uint32_t>& order) {
+    transitions_.assign(nodes_.size() * kAlphabetSize, 0);
+    for (const auto& [c, child] : nodes_[0].next) {
+      transitions_[static_cast<uint8_t>(c)] = child;
+    }
+    for (uint32_t state : order) {
+      uint32_t* row = &transitions_[size_t{state} * kAlphabetSize];
+      std::copy_n(&transitions_[size_t{nodes_[state].fail} * kAlphabetSize],
+                  kAlphabetSize, row);
+      for (const auto& [c, child] : nodes_[state].next) {
+        row[static_cast<uint8_t>(c)] = child;
+      }
+    }
+  }
+
+  uint32_t Step(uint32_t state, CharT c) const {
+    if constexpr (kDense) {
+      return transitions_[size_t{state} * kAlphabetSize +
+                          static_cast<uint8_t>(c)];
+    }
+    while (true) {
+      uint32_t next = Child(state, c);
+      if (next != kNone) {
+        return next;
+      }
+      if (state == 0) {
+        return 0;
+      }
+      state = nodes_[state].fail;
+    }
+  }
+
+  std::vector<Node> nodes_;
+  std::vector<size_t> lengths_;
+  // The transition table of single-byte automatons, valid after `Build`.
+  std::vector<uint32_t> transitions_;
+};
+
+#endif  // CHROME_PLUS_SRC_AHOCORASICK_H_
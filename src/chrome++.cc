@@ -35,14 +35,18 @@ void ChromePlus() {
 
   // Process the hotkey.
   GetHotkey();
+
+  // Reload chrome++.ini when it changes.
+  Config::WatchForChanges();
 }
 
 void ChromePlusCommand(LPWSTR param) {
   if (!wcsstr(param, L"--portable")) {
     Portable(param);
   } else {
+    ConfigReadScope config_scope;
     ChromePlus();
-    LaunchCommands(config.GetLaunchOnStartup());
+    LaunchCommands(config->GetLaunchOnStartup());
     should_run_exit_cmd = true;
   }
 }
@@ -88,7 +92,8 @@ BOOL WINAPI DllMain(HINSTANCE hModule, DWORD dwReason, LPVOID pv) {
 
     InstallLoader();
   } else if (dwReason == DLL_PROCESS_DETACH && ::should_run_exit_cmd) {
-    LaunchCommands(config.GetLaunchOnExit());
+    ConfigReadScope config_scope;
+    LaunchCommands(config->GetLaunchOnExit());
     should_run_exit_cmd = false;
   }
   return TRUE;
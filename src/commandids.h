@@ -0,0 +1,27 @@
+#ifndef CHROME_PLUS_SRC_COMMANDIDS_H_
+#define CHROME_PLUS_SRC_COMMANDIDS_H_
+
+// Chrome command IDs
+// https://source.chromium.org/chromium/chromium/src/+/main:chrome/app/chrome_command_ids.h?q=chrome_command_ids.h&ss=chromium%2Fchromium%2Fsrc
+#define IDC_NEW_TAB 34014
+#define IDC_CLOSE_TAB 34015
+#define IDC_SELECT_NEXT_TAB 34016
+#define IDC_SELECT_PREVIOUS_TAB 34017
+#define IDC_SELECT_TAB_0 34018
+#define IDC_SELECT_TAB_1 34019
+#define IDC_SELECT_TAB_2 34020
+#define IDC_SELECT_TAB_3 34021
+#define IDC_SELECT_TAB_4 34022
+#define IDC_SELECT_TAB_5 34023
+#define IDC_SELECT_TAB_6 34024
+#define IDC_SELECT_TAB_7 34025
+#define IDC_SELECT_LAST_TAB 34026
+#define IDC_FULLSCREEN 34030
+#define IDC_MOVE_TAB_NEXT 34032
+#define IDC_MOVE_TAB_PREVIOUS 34033
+#define IDC_SHOW_TRANSLATE 35009
+#define IDC_WINDOW_CLOSE_OTHER_TABS 35023
+#define IDC_CLOSE_FIND_OR_STOP 37003
+#define IDC_UPGRADE_DIALOG 40024
+
+#endif  // CHROME_PLUS_SRC_COMMANDIDS_H_
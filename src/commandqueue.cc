@@ -0,0 +1,205 @@
+#include "commandqueue.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hookstats.h"
+#include "iaccessible.h"
+#include "uitask.h"
+#include "utils.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct QueuedCommand {
+  int id = 0;
+  int count = 0;
+  Clock::time_point queued;
+  std::vector<CommandCallback> callbacks;
+};
+
+// Only touched from the UI thread. Elements of an `unordered_map` stay where
+// they are when others are added, so a command can be queued while another
+// one is being sent.
+std::unordered_map<HWND, std::deque<QueuedCommand>> command_queues;
+// The command being sent, which is neither merged into nor cancelled out.
+const QueuedCommand* running_command = nullptr;
+bool pump_posted = false;
+std::function<void(const CommandTrace&)> command_observer;
+
+// Selecting the next and then the previous tab, or the other way around,
+// changes nothing since both wrap around. Moving a tab does not wrap, so
+// moving it back and forth changes nothing only away from the ends of the
+// strip, and those are not paired.
+int GetOppositeCommand(int id) {
+  switch (id) {
+    case IDC_SELECT_NEXT_TAB:
+      return IDC_SELECT_PREVIOUS_TAB;
+    case IDC_SELECT_PREVIOUS_TAB:
+      return IDC_SELECT_NEXT_TAB;
+    default:
+      return 0;
+  }
+}
+
+uint32_t GetElapsedUs(Clock::time_point from, Clock::time_point to) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+  return static_cast<uint32_t>(std::clamp<int64_t>(us.count(), 0, UINT32_MAX));
+}
+
+size_t GetQueueDepth() {
+  size_t depth = 0;
+  for (const auto& [hwnd, commands] : command_queues) {
+    depth += commands.size();
+  }
+  return depth;
+}
+
+void ReportSlice(const CommandTrace& trace) {
+  if (command_observer) {
+    command_observer(trace);
+    return;
+  }
+  if (trace.run_us / trace.count > kHookBudgetUs) {
+    DebugLog(L"Command {}: {} runs took {} us after waiting {} us, {} queued",
+             trace.id, trace.count, trace.run_us, trace.wait_us,
+             trace.queue_depth);
+  }
+}
+
+void Complete(std::vector<CommandCallback> callbacks, bool ran) {
+  for (auto& callback : callbacks) {
+    if (callback) {
+      callback(ran);
+    }
+  }
+}
+
+// Sends the command at the front of the queue of `hwnd` until it has run as
+// often as queued or the slice has used up the budget of a hook call.
+void RunCommandSlice(HWND hwnd) {
+  auto it = command_queues.find(hwnd);
+  if (it == command_queues.end() || it->second.empty()) {
+    return;
+  }
+  auto& commands = it->second;
+  if (!IsWindow(hwnd)) {
+    std::deque<QueuedCommand> dropped;
+    dropped.swap(commands);
+    for (auto& command : dropped) {
+      Complete(std::move(command.callbacks), false);
+    }
+    return;
+  }
+
+  QueuedCommand& command = commands.front();
+  CommandTrace trace = {command.id};
+  auto start = Clock::now();
+  trace.wait_us = GetElapsedUs(command.queued, start);
+  running_command = &command;
+  do {
+    --command.count;
+    ++trace.count;
+    ::SendMessageTimeoutW(hwnd, WM_SYSCOMMAND, command.id, 0, 0, 1000, 0);
+  } while (command.count > 0 &&
+           GetElapsedUs(start, Clock::now()) < kHookBudgetUs);
+  running_command = nullptr;
+  trace.run_us = GetElapsedUs(start, Clock::now());
+
+  // The commands may have changed the tab strip.
+  InvalidateAccessibleSnapshot();
+  InvalidateUIRegions();
+
+  std::vector<CommandCallback> callbacks;
+  if (command.count <= 0) {
+    callbacks = std::move(command.callbacks);
+    commands.pop_front();
+  }
+  trace.queue_depth = GetQueueDepth();
+  ReportSlice(trace);
+  Complete(std::move(callbacks), true);
+}
+
+void PostCommandPump();
+
+// Gives every window one slice, then yields to input before the next.
+void RunCommands() {
+  pump_posted = false;
+  std::vector<HWND> windows;
+  for (const auto& [hwnd, commands] : command_queues) {
+    windows.push_back(hwnd);
+  }
+  for (HWND hwnd : windows) {
+    RunCommandSlice(hwnd);
+  }
+  std::erase_if(command_queues,
+                [](const auto& queue) { return queue.second.empty(); });
+  if (!command_queues.empty()) {
+    PostCommandPump();
+  }
+}
+
+void PostCommandPump() {
+  // A command sent by a slice may queue more; they wait for the next pump
+  // rather than run inside the slice.
+  if (pump_posted || running_command) {
+    return;
+  }
+  pump_posted = true;
+  PostUITask(L"RunCommands", RunCommands);
+}
+
+}  // namespace
+
+void QueueCommand(int id, HWND hwnd, int count, CommandCallback done) {
+  if (hwnd == nullptr) {
+    hwnd = GetForegroundWindow();
+  }
+  if (count <= 0) {
+    if (done) {
+      done(true);
+    }
+    return;
+  }
+
+  auto& commands = command_queues[hwnd];
+  QueuedCommand* last = commands.empty() ? nullptr : &commands.back();
+  if (last && last != running_command) {
+    if (last->id == id) {
+      last->count += count;
+      last->callbacks.push_back(std::move(done));
+      return;
+    }
+    if (GetOppositeCommand(id) == last->id) {
+      int cancelled = std::min(last->count, count);
+      last->count -= cancelled;
+      count -= cancelled;
+      if (last->count == 0) {
+        std::vector<CommandCallback> callbacks = std::move(last->callbacks);
+        commands.pop_back();
+        Complete(std::move(callbacks), true);
+      }
+      if (count == 0) {
+        Complete({std::move(done)}, true);
+        return;
+      }
+    }
+  }
+
+  commands.push_back({id, count, Clock::now(), {}});
+  commands.back().callbacks.push_back(std::move(done));
+  PostCommandPump();
+}
+
+void SetCommandObserver(std::function<void(const CommandTrace&)> observer) {
+  command_observer = std::move(observer);
+}
@@ -0,0 +1,43 @@
+#ifndef CHROME_PLUS_SRC_COMMANDQUEUE_H_
+#define CHROME_PLUS_SRC_COMMANDQUEUE_H_
+
+#include <windows.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Called once a queued command has run, or was cancelled out by its opposite,
+// with `ran` true. `ran` is false if the window went away first.
+using CommandCallback = std::function<void(bool ran)>;
+
+// Runs the browser command `id` `count` times in `hwnd`, or in the foreground
+// window if it is null, from a UI task instead of at once. The commands of a
+// window run in the order they were queued. A command queued behind the same
+// command is merged into it, and one queued behind its opposite cancels one run
+// of it out. Long runs are split so that input is handled in between.
+void QueueCommand(int id,
+                  HWND hwnd = nullptr,
+                  int count = 1,
+                  CommandCallback done = {});
+
+// One slice of a run of commands.
+struct CommandTrace {
+  int id = 0;
+  // Times the command was sent in this slice.
+  int count = 0;
+  // Commands still queued in all windows after this slice, a merged run
+  // counting as one.
+  size_t queue_depth = 0;
+  // From queueing the command to the start of the slice.
+  uint32_t wait_us = 0;
+  // Spent sending the command to the browser in this slice.
+  uint32_t run_us = 0;
+};
+
+// Replaces what is done with the trace of every slice. By default, slices
+// that took longer than `kHookBudgetUs` per command are written to the debug
+// log.
+void SetCommandObserver(std::function<void(const CommandTrace&)> observer);
+
+#endif  // CHROME_PLUS_SRC_COMMANDQUEUE_H_
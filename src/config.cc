@@ -2,61 +2,224 @@
 
 #include <windows.h>
 
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <thread>
 
+#include "hotkey.h"
+#include "ini.h"
+#include "snapshot.h"
 #include "utils.h"
 
-Config& Config::Instance() {
-  static Config instance;
-  return instance;
+namespace {
+
+std::string ToUtf8(std::wstring_view text) {
+  int size = ::WideCharToMultiByte(CP_UTF8, 0, text.data(),
+                                   static_cast<int>(text.size()), nullptr, 0,
+                                   nullptr, nullptr);
+  std::string result(size, '\0');
+  ::WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()),
+                        result.data(), size, nullptr, nullptr);
+  return result;
+}
+
+// Editors often save in several steps, so a reload waits until the file has
+// been quiet for a while.
+constexpr DWORD kReloadDelayMs = 200;
+constexpr DWORD kReclaimRetryMs = 1000;
+
+// Never destroyed, since the exit commands read the config while the process
+// is shutting down.
+SnapshotStore<Config>& GetStore() {
+  static auto* store = new SnapshotStore<Config>(
+      new Config(IniFile::Load(GetIniPath()).value_or(IniFile())));
+  return *store;
+}
+
+void ReloadConfig(SnapshotStore<Config>& store) {
+  // A missing or locked file is most likely being replaced, so the current
+  // snapshot stays until the next change reloads it.
+  auto ini = IniFile::Load(GetIniPath());
+  if (!ini) {
+    DebugLog(L"Config reload skipped, chrome++.ini could not be read");
+    return;
+  }
+  store.Publish(new Config(*ini));
+  DebugLog(L"Config reloaded");
+  ReloadHotkeys();
+}
+
+void Reclaim(SnapshotStore<Config>& store, bool& unpinned_reads_logged) {
+  store.Reclaim();
+  if (!unpinned_reads_logged && store.HasUnpinnedReads()) {
+    unpinned_reads_logged = true;
+    DebugLog(L"Config read outside of a scope, old snapshots are kept");
+  }
 }
 
-Config::Config() {
-  LoadConfig();
+bool IsIniFileChange(const uint8_t* buffer, DWORD size) {
+  // An overflowed buffer reports nothing, so assume the file changed.
+  if (size == 0) {
+    return true;
+  }
+  const std::wstring ini_name =
+      std::filesystem::path(GetIniPath()).filename().wstring();
+  for (DWORD offset = 0; offset < size;) {
+    auto* info =
+        reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+    if (::CompareStringOrdinal(
+            info->FileName,
+            static_cast<int>(info->FileNameLength / sizeof(wchar_t)),
+            ini_name.c_str(), static_cast<int>(ini_name.size()),
+            TRUE) == CSTR_EQUAL) {
+      return true;
+    }
+    if (info->NextEntryOffset == 0) {
+      break;
+    }
+    offset += info->NextEntryOffset;
+  }
+  return false;
+}
+
+void WatchIniFile(SnapshotStore<Config>& store) {
+  HANDLE dir = ::CreateFileW(
+      GetAppDir().c_str(), FILE_LIST_DIRECTORY,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+      OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+      nullptr);
+  if (dir == INVALID_HANDLE_VALUE) {
+    DebugLog(L"Watch config failed: {}", ::GetLastError());
+    return;
+  }
+  OVERLAPPED overlapped = {};
+  overlapped.hEvent = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+  alignas(DWORD) uint8_t buffer[4096];
+  bool read_pending = false;
+  bool unpinned_reads_logged = false;
+  ULONGLONG reload_at = 0;
+  while (true) {
+    if (!read_pending) {
+      ::ResetEvent(overlapped.hEvent);
+      if (!::ReadDirectoryChangesW(
+              dir, buffer, sizeof(buffer), FALSE,
+              FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE |
+                  FILE_NOTIFY_CHANGE_SIZE,
+              nullptr, &overlapped, nullptr)) {
+        DebugLog(L"ReadDirectoryChangesW failed: {}", ::GetLastError());
+        break;
+      }
+      read_pending = true;
+    }
+
+    DWORD timeout = INFINITE;
+    if (reload_at != 0) {
+      ULONGLONG now = ::GetTickCount64();
+      timeout = now < reload_at ? static_cast<DWORD>(reload_at - now) : 0;
+    } else if (store.retired_count() > 0) {
+      timeout = kReclaimRetryMs;
+    }
+
+    DWORD wait = ::WaitForSingleObject(overlapped.hEvent, timeout);
+    if (wait == WAIT_OBJECT_0) {
+      read_pending = false;
+      DWORD size = 0;
+      if (!::GetOverlappedResult(dir, &overlapped, &size, FALSE)) {
+        DebugLog(L"Watch config failed: {}", ::GetLastError());
+        break;
+      }
+      if (IsIniFileChange(buffer, size)) {
+        reload_at = ::GetTickCount64() + kReloadDelayMs;
+      }
+    } else if (wait == WAIT_TIMEOUT) {
+      if (reload_at != 0 && ::GetTickCount64() >= reload_at) {
+        reload_at = 0;
+        ReloadConfig(store);
+      }
+      Reclaim(store, unpinned_reads_logged);
+    } else {
+      break;
+    }
+  }
+
+  ::CancelIo(dir);
+  ::CloseHandle(overlapped.hEvent);
+  ::CloseHandle(dir);
+}
+
+}  // namespace
+
+ConfigReadScope::ConfigReadScope() {
+  GetStore().Pin();
 }
 
-void Config::LoadConfig() {
+ConfigReadScope::~ConfigReadScope() {
+  GetStore().Unpin();
+}
+
+const Config& Config::Current() {
+  return GetStore().Current();
+}
+
+void Config::WatchForChanges() {
+  static std::atomic<bool> watching = false;
+  if (watching.exchange(true)) {
+    return;
+  }
+  SnapshotStore<Config>& store = GetStore();
+  store.StartWriter();
+  std::thread(WatchIniFile, std::ref(store)).detach();
+}
+
+Config::Config(const IniFile& ini) {
+  LoadConfig(ini);
+}
+
+void Config::LoadConfig(const IniFile& ini) {
   // general
-  command_line_ = GetIniString(L"general", L"command_line", L"");
-  launch_on_startup_ = GetIniString(L"general", L"launch_on_startup", L"");
-  launch_on_exit_ = GetIniString(L"general", L"launch_on_exit", L"");
-  user_data_dir_ = LoadDirPath(L"data");
-  disk_cache_dir_ = LoadDirPath(L"cache");
-  boss_key_ = GetIniString(L"general", L"boss_key", L"");
-  translate_key_ = GetIniString(L"general", L"translate_key", L"");
-  show_password_ = ::GetPrivateProfileIntW(L"general", L"show_password", 1,
-                                           GetIniPath().c_str()) != 0;
-  win32k_ = ::GetPrivateProfileIntW(L"general", L"win32k", 0,
-                                    GetIniPath().c_str()) != 0;
+  command_line_ = ini.GetString(L"general", L"command_line", L"");
+  launch_on_startup_ = ini.GetString(L"general", L"launch_on_startup", L"");
+  launch_on_exit_ = ini.GetString(L"general", L"launch_on_exit", L"");
+  user_data_dir_ = LoadDirPath(ini, L"data");
+  disk_cache_dir_ = LoadDirPath(ini, L"cache");
+  boss_key_ = ini.GetString(L"general", L"boss_key", L"");
+  translate_key_ = ini.GetString(L"general", L"translate_key", L"");
+  show_password_ = ini.GetInt(L"general", L"show_password", 1) != 0;
+  win32k_ = ini.GetInt(L"general", L"win32k", 0) != 0;
+  pak_patch_ = ini.GetInt(L"general", L"pak_patch", 1) != 0;
 
   // tabs
-  keep_last_tab_ = ::GetPrivateProfileIntW(L"tabs", L"keep_last_tab", 1,
-                                           GetIniPath().c_str()) != 0;
-  double_click_close_ = ::GetPrivateProfileIntW(L"tabs", L"double_click_close",
-                                                1, GetIniPath().c_str()) != 0;
-  right_click_close_ = ::GetPrivateProfileIntW(L"tabs", L"right_click_close", 0,
-                                               GetIniPath().c_str()) != 0;
-  wheel_tab_ = ::GetPrivateProfileIntW(L"tabs", L"wheel_tab", 1,
-                                       GetIniPath().c_str()) != 0;
+  keep_last_tab_ = ini.GetInt(L"tabs", L"keep_last_tab", 1) != 0;
+  double_click_close_ = ini.GetInt(L"tabs", L"double_click_close", 1) != 0;
+  right_click_close_ = ini.GetInt(L"tabs", L"right_click_close", 0) != 0;
+  wheel_tab_ = ini.GetInt(L"tabs", L"wheel_tab", 1) != 0;
   wheel_tab_when_press_rbutton_ =
-      ::GetPrivateProfileIntW(L"tabs", L"wheel_tab_when_press_rbutton", 1,      
-                              GetIniPath().c_str()) != 0;
-  open_url_new_tab_ = LoadOpenUrlNewTabMode();
-  bookmark_new_tab_ = LoadBookmarkNewTabMode();
-  drag_new_tab_ =
-      ::GetPrivateProfileIntW(L"tabs", L"drag_new_tab", 0,
-                              GetIniPath().c_str());
-  new_tab_disable_ = ::GetPrivateProfileIntW(L"tabs", L"new_tab_disable", 1,    
-                                             GetIniPath().c_str()) != 0;        
-  disable_tab_name_ = GetIniString(L"tabs", L"new_tab_disable_name", L"");
-  switch_to_prev_ = GetIniString(L"tabs", L"switch_to_prev", L"");
-  switch_to_next_ = GetIniString(L"tabs", L"switch_to_next", L"");
-}
-
-std::wstring Config::LoadDirPath(const std::wstring& dir_type) {
+      ini.GetInt(L"tabs", L"wheel_tab_when_press_rbutton", 1) != 0;
+  open_url_new_tab_ = LoadOpenUrlNewTabMode(ini);
+  bookmark_new_tab_ = LoadBookmarkNewTabMode(ini);
+  drag_new_tab_ = ini.GetInt(L"tabs", L"drag_new_tab", 0);
+  new_tab_disable_ = ini.GetInt(L"tabs", L"new_tab_disable", 1) != 0;
+  disable_tab_name_ = ini.GetString(L"tabs", L"new_tab_disable_name", L"");
+  LoadDisableTabNames();
+  switch_to_prev_ = ini.GetString(L"tabs", L"switch_to_prev", L"");
+  switch_to_next_ = ini.GetString(L"tabs", L"switch_to_next", L"");
+  ui_automation_ = ini.GetInt(L"tabs", L"ui_automation", 0) != 0;
+  LoadKeyBindings();
+
+  // pak_patch
+  LoadPakPatchRules(ini);
+}
+
+std::wstring Config::LoadDirPath(const IniFile& ini,
+                                 const std::wstring& dir_type) {
   std::wstring path = CanonicalizePath(GetAppDir() + L"\\..\\" + dir_type);
   std::wstring dir_key = dir_type + L"_dir";
-  std::wstring dir_buffer = GetIniString(L"general", dir_key, path);
+  std::wstring dir_buffer(ini.GetString(L"general", dir_key, path));
 
   if (dir_buffer == L"none") {
     return L"";
@@ -71,13 +234,48 @@ std::wstring Config::LoadDirPath(const std::wstring& dir_type) {
   return GetAbsolutePath(expanded_path);
 }
 
-int Config::LoadOpenUrlNewTabMode() {
-  return ::GetPrivateProfileIntW(L"tabs", L"open_url_new_tab", 0,
-                                 GetIniPath().c_str());
+int Config::LoadOpenUrlNewTabMode(const IniFile& ini) {
+  return ini.GetInt(L"tabs", L"open_url_new_tab", 0);
+}
+int Config::LoadBookmarkNewTabMode(const IniFile& ini) {
+  return ini.GetInt(L"tabs", L"open_bookmark_new_tab", 0);
 }
-int Config::LoadBookmarkNewTabMode() {
-  return ::GetPrivateProfileIntW(L"tabs", L"open_bookmark_new_tab", 0,
-                                 GetIniPath().c_str());
+
+void Config::LoadDisableTabNames() {
+  for (const auto& name : StringSplit(disable_tab_name_, L',', L"\"")) {
+    if (!name.empty()) {
+      disable_tab_name_matcher_.Add(name);
+    }
+  }
+  disable_tab_name_matcher_.Build();
 }
 
-const Config& config = Config::Instance();
+// The order of insertion decides which action wins when two bindings share the
+// same key, matching the order the keyboard hook used to check them in.
+void Config::LoadKeyBindings() {
+  key_bindings_ = KeyBindingTable();
+  if (!translate_key_.empty()) {
+    key_bindings_.Add(ParseHotkeys(translate_key_), KeyAction::kTranslate);
+  }
+  if (!switch_to_prev_.empty()) {
+    key_bindings_.Add(ParseHotkeys(switch_to_prev_), KeyAction::kSwitchToPrev);
+  }
+  if (!switch_to_next_.empty()) {
+    key_bindings_.Add(ParseHotkeys(switch_to_next_), KeyAction::kSwitchToNext);
+  }
+}
+
+// Each line is `name="marker","search","replace"`; the name only documents
+// the rule. The raw value is used since unquoting would strip the quotes
+// around the first and last field.
+void Config::LoadPakPatchRules(const IniFile& ini) {
+  pak_patch_rules_.clear();
+  for (const auto& [name, value] : ini.GetSection(L"pak_patch")) {
+    auto rule = ParsePakPatchRule(ToUtf8(value));
+    if (!rule) {
+      DebugLog(L"Invalid pak_patch rule: {}", name);
+      continue;
+    }
+    pak_patch_rules_.push_back(std::move(*rule));
+  }
+}
@@ -2,10 +2,31 @@
 #define CHROME_PLUS_SRC_CONFIG_H_
 
 #include <string>
+#include <vector>
 
+#include "ahocorasick.h"
+#include "ini.h"
+#include "keybindings.h"
+#include "pakrules.h"
+
+// The options read from chrome++.ini. A `Config` is an immutable snapshot:
+// when the file changes, a new one is built on the watcher thread and
+// published in place of the old one, which is freed once no reader can still
+// be using it.
 class Config {
  public:
-  static Config& Instance();
+  explicit Config(const IniFile& ini);
+  Config(const Config&) = delete;
+  Config& operator=(const Config&) = delete;
+
+  // The snapshot pinned by the innermost `ConfigReadScope` of this thread, or
+  // the latest one outside of a scope.
+  static const Config& Current();
+
+  // Watches chrome++.ini from a thread of its own and publishes a new snapshot
+  // whenever the file changes. Options that are only used at startup, such as
+  // the command line or the pak patch rules, still need a restart.
+  static void WatchForChanges();
 
   // general
   const std::wstring& GetCommandLine() const { return command_line_; }
@@ -17,6 +38,12 @@ class Config {
   const std::wstring& GetTranslateKey() const { return translate_key_; }
   bool IsShowPassword() const { return show_password_; }
   bool IsWin32K() const { return win32k_; }
+  bool IsPakPatch() const { return pak_patch_; }
+
+  // pak_patch
+  const std::vector<PakPatchRule>& GetPakPatchRules() const {
+    return pak_patch_rules_;
+  }
 
   // tabs
   bool IsKeepLastTab() const { return keep_last_tab_; }
@@ -31,20 +58,26 @@ class Config {
   int GetDragNewTabMode() const { return drag_new_tab_; }
   bool IsNewTabDisable() const { return new_tab_disable_; }
   const std::wstring& GetDisableTabName() const { return disable_tab_name_; }
+  // Compiled from the comma separated `new_tab_disable_name`.
+  const AhoCorasick<wchar_t>& GetDisableTabNameMatcher() const {
+    return disable_tab_name_matcher_;
+  }
   const std::wstring& GetSwitchToPrevKey() const { return switch_to_prev_; }
   const std::wstring& GetSwitchToNextKey() const { return switch_to_next_; }
+  bool IsUIAutomation() const { return ui_automation_; }
 
- private:
-  Config();
-  ~Config() = default;
-  Config(const Config&) = delete;
-  Config& operator=(const Config&) = delete;
+  // Compiled from `translate_key`, `switch_to_prev` and `switch_to_next`.
+  const KeyBindingTable& GetKeyBindings() const { return key_bindings_; }
 
-  void LoadConfig();
+ private:
+  void LoadConfig(const IniFile& ini);
 
-  std::wstring LoadDirPath(const std::wstring& dir_type);
-  int LoadOpenUrlNewTabMode();
-  int LoadBookmarkNewTabMode();
+  std::wstring LoadDirPath(const IniFile& ini, const std::wstring& dir_type);
+  int LoadOpenUrlNewTabMode(const IniFile& ini);
+  int LoadBookmarkNewTabMode(const IniFile& ini);
+  void LoadDisableTabNames();
+  void LoadKeyBindings();
+  void LoadPakPatchRules(const IniFile& ini);
 
  private:
   // general
@@ -57,6 +90,7 @@ class Config {
   std::wstring translate_key_;
   bool show_password_;
   bool win32k_;
+  bool pak_patch_;
 
   // tabs
   bool keep_last_tab_;
@@ -69,10 +103,37 @@ class Config {
   int drag_new_tab_;
   bool new_tab_disable_;
   std::wstring disable_tab_name_;
+  AhoCorasick<wchar_t> disable_tab_name_matcher_;
   std::wstring switch_to_prev_;
   std::wstring switch_to_next_;
+  bool ui_automation_;
+  KeyBindingTable key_bindings_;
+
+  // pak_patch
+  std::vector<PakPatchRule> pak_patch_rules_;
+};
+
+// Pins the current snapshot for the calling thread. References returned by the
+// getters stay valid until the outermost scope of the thread ends, and every
+// read in between sees the same snapshot. Entering and leaving a scope never
+// blocks, so the input hooks open one per event.
+//
+// Reading the config outside of any scope is only safe before the watcher
+// starts; a read like that afterwards keeps every old snapshot alive for the
+// rest of the process.
+class ConfigReadScope {
+ public:
+  ConfigReadScope();
+  ~ConfigReadScope();
+  ConfigReadScope(const ConfigReadScope&) = delete;
+  ConfigReadScope& operator=(const ConfigReadScope&) = delete;
+};
+
+// `config->IsWheelTab()` reads `Config::Current()`.
+struct ConfigAccessor {
+  const Config* operator->() const { return &Config::Current(); }
 };
 
-extern const Config& config;
+inline constexpr ConfigAccessor config;
 
 #endif  // CHROME_PLUS_SRC_CONFIG_H_
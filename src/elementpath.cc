@@ -0,0 +1,202 @@
+#include "elementpath.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+namespace {
+
+constexpr char kElementPathMagic[8] = {'C', 'P', 'P', 'P', 'A', 'T', 'H', 'S'};
+constexpr uint32_t kElementPathFormat = 1;
+// The paths are a few steps deep; anything beyond these is corrupt.
+constexpr uint32_t kMaxPathDepth = 64;
+constexpr uint32_t kMaxPathCount = 64;
+// Paths kept per role. The oldest is dropped when a new one is learned.
+constexpr size_t kMaxPathsPerRole = 4;
+
+struct ElementPathCache {
+  // The Chrome build the paths were learned on, 0 if unknown.
+  uint64_t browser_version = 0;
+  std::map<long, std::vector<ElementPath>> paths;
+};
+
+std::filesystem::path GetElementPathCachePath() {
+  std::filesystem::path path = GetAppDir();
+  path /= L"chrome++.pathcache";
+  return path;
+}
+
+// The file version of the browser exe. It is read from the version resource
+// of the loaded image, since this dll stands in for version.dll.
+uint64_t GetBrowserVersion() {
+  HMODULE exe = GetModuleHandleW(nullptr);
+  HRSRC info =
+      FindResourceW(exe, MAKEINTRESOURCEW(VS_VERSION_INFO), RT_VERSION);
+  HGLOBAL data = info ? LoadResource(exe, info) : nullptr;
+  const auto* bytes =
+      data ? static_cast<const uint8_t*>(LockResource(data)) : nullptr;
+  if (!bytes) {
+    return 0;
+  }
+  // `VS_FIXEDFILEINFO` is the 32-bit aligned value of the root block.
+  DWORD size = SizeofResource(exe, info);
+  for (DWORD offset = 0; offset + sizeof(VS_FIXEDFILEINFO) <= size;
+       offset += 4) {
+    VS_FIXEDFILEINFO fixed;
+    std::memcpy(&fixed, bytes + offset, sizeof(fixed));
+    if (fixed.dwSignature == VS_FFI_SIGNATURE) {
+      return (static_cast<uint64_t>(fixed.dwFileVersionMS) << 32) |
+             fixed.dwFileVersionLS;
+    }
+  }
+  return 0;
+}
+
+template <typename T>
+bool ReadValue(std::ifstream& file, T& value) {
+  return static_cast<bool>(
+      file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+template <typename T>
+void WriteValue(std::ofstream& file, const T& value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool LoadElementPaths(ElementPathCache& cache) {
+  std::ifstream file(GetElementPathCachePath(), std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  char magic[sizeof(kElementPathMagic)];
+  uint32_t format = 0;
+  uint64_t browser_version = 0;
+  uint32_t count = 0;
+  if (!file.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kElementPathMagic, sizeof(magic)) != 0 ||
+      !ReadValue(file, format) || format != kElementPathFormat ||
+      !ReadValue(file, browser_version) ||
+      browser_version != cache.browser_version || !ReadValue(file, count) ||
+      count > kMaxPathCount) {
+    return false;
+  }
+
+  std::map<long, std::vector<ElementPath>> paths;
+  for (uint32_t i = 0; i < count; ++i) {
+    int32_t role = 0;
+    uint32_t depth = 0;
+    if (!ReadValue(file, role) || !ReadValue(file, depth) ||
+        depth == 0 || depth > kMaxPathDepth) {
+      return false;
+    }
+    ElementPath path(depth);
+    for (auto& step : path) {
+      if (!ReadValue(file, step.index) || !ReadValue(file, step.role)) {
+        return false;
+      }
+    }
+    auto& role_paths = paths[role];
+    if (role_paths.size() < kMaxPathsPerRole) {
+      role_paths.push_back(std::move(path));
+    }
+  }
+  cache.paths = std::move(paths);
+  return true;
+}
+
+void SaveElementPaths(const ElementPathCache& cache) {
+  auto path = GetElementPathCachePath();
+  auto temp_path = path;
+  temp_path += L".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      DebugLog(L"SaveElementPaths failed: cannot open {}",
+               temp_path.wstring());
+      return;
+    }
+
+    uint32_t count = 0;
+    for (const auto& [role, role_paths] : cache.paths) {
+      count += static_cast<uint32_t>(role_paths.size());
+    }
+    file.write(kElementPathMagic, sizeof(kElementPathMagic));
+    WriteValue(file, kElementPathFormat);
+    WriteValue(file, cache.browser_version);
+    WriteValue(file, count);
+    for (const auto& [role, role_paths] : cache.paths) {
+      for (const auto& element_path : role_paths) {
+        WriteValue(file, static_cast<int32_t>(role));
+        WriteValue(file, static_cast<uint32_t>(element_path.size()));
+        for (const auto& step : element_path) {
+          WriteValue(file, step.index);
+          WriteValue(file, step.role);
+        }
+      }
+    }
+    if (!file.flush()) {
+      DebugLog(L"SaveElementPaths failed: write error");
+      return;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    DebugLog(L"SaveElementPaths failed: rename error {}", ec.value());
+    std::filesystem::remove(temp_path, ec);
+  }
+}
+
+// Only touched from the UI thread the hooks are installed on.
+ElementPathCache& GetElementPathCache() {
+  static ElementPathCache cache = [] {
+    ElementPathCache cache;
+    cache.browser_version = GetBrowserVersion();
+    if (cache.browser_version) {
+      LoadElementPaths(cache);
+    }
+    return cache;
+  }();
+  return cache;
+}
+
+}  // namespace
+
+std::span<const ElementPath> GetElementPaths(long role) {
+  const auto& paths = GetElementPathCache().paths;
+  auto it = paths.find(role);
+  if (it == paths.end()) {
+    return {};
+  }
+  return it->second;
+}
+
+void AddElementPath(long role, ElementPath path) {
+  if (path.empty() || path.size() > kMaxPathDepth) {
+    return;
+  }
+  auto& cache = GetElementPathCache();
+  auto& role_paths = cache.paths[role];
+  std::erase(role_paths, path);
+  role_paths.insert(role_paths.begin(), std::move(path));
+  if (role_paths.size() > kMaxPathsPerRole) {
+    role_paths.pop_back();
+  }
+  // Without a version there is no telling when the paths go stale.
+  if (cache.browser_version) {
+    SaveElementPaths(cache);
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef CHROME_PLUS_SRC_ELEMENTPATH_H_
+#define CHROME_PLUS_SRC_ELEMENTPATH_H_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// One step down the accessibility tree: the index of the child among all
+// children of its parent, and the role it had when the path was recorded.
+struct ElementPathStep {
+  uint32_t index = 0;
+  int32_t role = 0;
+
+  bool operator==(const ElementPathStep&) const = default;
+};
+
+using ElementPath = std::vector<ElementPathStep>;
+
+// The paths recorded from the `Chrome_WidgetWin_1` root to the element with
+// `role`, most recently learned first. Windows of different kinds (e.g. app
+// windows) lay out their tree differently, so a role can have several.
+std::span<const ElementPath> GetElementPaths(long role);
+
+// Remembers `path` for `role` and stores the cache next to chrome++.ini, so
+// that the next launch of the same Chrome build starts with it.
+void AddElementPath(long role, ElementPath path);
+
+#endif  // CHROME_PLUS_SRC_ELEMENTPATH_H_
@@ -1,18 +1,27 @@
 #include "fastsearch.h"
 
+#include <bit>
 #include <cstdint>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || \
+    defined(__x86_64__)
+#define FASTSEARCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC allows AVX2 intrinsics in any function.
+#define TARGET_AVX2
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 namespace {
 
 static const uint8_t* ForceSearch(const uint8_t* s, int n, const uint8_t* p) {
-  int i;
-  for (i = 0; i < n; ++i) {
-    if (*(s + i) == *p) {
-      return s + i;
-    }
-  }
-
-  return nullptr;
+  return static_cast<const uint8_t*>(std::memchr(s, *p, n));
 }
 
 const uint8_t* SundaySearch(const uint8_t* s, int n, const uint8_t* p, int m) {
@@ -38,12 +47,110 @@ const uint8_t* SundaySearch(const uint8_t* s, int n, const uint8_t* p, int m) {
       }
     }
 
+    // `s[i + m]` is past the end on the last possible position.
+    if (i + m >= n) {
+      break;
+    }
     i += static_cast<int>(skip[s[i + m]]);
   }
 
   return nullptr;
 }
 
+#if defined(FASTSEARCH_X86)
+
+// Both SIMD searches compare a block of candidate positions against the first
+// and the last byte of the needle at once, and only run `memcmp` on positions
+// where both match. The end of the haystack that does not fill a whole block
+// is left to `SundaySearch`.
+
+const uint8_t* Sse2Search(const uint8_t* s, int n, const uint8_t* p, int m) {
+  const __m128i first = _mm_set1_epi8(static_cast<char>(p[0]));
+  const __m128i last = _mm_set1_epi8(static_cast<char>(p[m - 1]));
+
+  int i = 0;
+  for (; i + 16 + m - 1 <= n; i += 16) {
+    const __m128i block_first =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    const __m128i block_last =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + m - 1));
+    uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+    while (mask) {
+      int offset = std::countr_zero(mask);
+      if (std::memcmp(s + i + offset + 1, p + 1, m - 2) == 0) {
+        return s + i + offset;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  return SundaySearch(s + i, n - i, p, m);
+}
+
+TARGET_AVX2 const uint8_t* Avx2Search(const uint8_t* s,
+                                      int n,
+                                      const uint8_t* p,
+                                      int m) {
+  const __m256i first = _mm256_set1_epi8(static_cast<char>(p[0]));
+  const __m256i last = _mm256_set1_epi8(static_cast<char>(p[m - 1]));
+
+  int i = 0;
+  for (; i + 32 + m - 1 <= n; i += 32) {
+    const __m256i block_first =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+    const __m256i block_last =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + m - 1));
+    uint32_t mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(first, block_first),
+            _mm256_cmpeq_epi8(last, block_last))));
+    while (mask) {
+      int offset = std::countr_zero(mask);
+      if (std::memcmp(s + i + offset + 1, p + 1, m - 2) == 0) {
+        return s + i + offset;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  return Sse2Search(s + i, n - i, p, m);
+}
+
+bool HasAvx2() {
+#if defined(_MSC_VER)
+  int info[4] = {};
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuidex(info, 1, 0);
+  bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                      (_xgetbv(0) & 0x6) == 0x6;
+  __cpuidex(info, 7, 0);
+  return os_saves_ymm && (info[1] & (1 << 5));
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif  // FASTSEARCH_X86
+
+using SearchFunction = const uint8_t* (*)(const uint8_t*,
+                                          int,
+                                          const uint8_t*,
+                                          int);
+
+// Picks the widest search the CPU supports, once per process.
+SearchFunction GetSearchFunction() {
+#if defined(FASTSEARCH_X86)
+  static const SearchFunction search = HasAvx2() ? Avx2Search : Sse2Search;
+  return search;
+#else
+  return SundaySearch;
+#endif
+}
+
 }  // namespace
 
 const uint8_t* FastSearch(const uint8_t* s, int n, const uint8_t* p, int m) {
@@ -56,5 +163,5 @@ const uint8_t* FastSearch(const uint8_t* s, int n, const uint8_t* p, int m) {
     return ForceSearch(s, n, p);
   }
 
-  return SundaySearch(s, n, p, m);
+  return GetSearchFunction()(s, n, p, m);
 }
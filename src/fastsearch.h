@@ -1,8 +1,50 @@
 #ifndef CHROME_PLUS_SRC_FASTSEARCH_H_
 #define CHROME_PLUS_SRC_FASTSEARCH_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <string_view>
+#include <utility>
 
 const uint8_t* FastSearch(const uint8_t* s, int n, const uint8_t* p, int m);
 
+// A string literal usable as a template argument.
+template <size_t N>
+struct FixedString {
+  consteval FixedString(const char (&str)[N]) { std::copy_n(str, N, data); }
+
+  static constexpr size_t size() { return N - 1; }
+  constexpr std::string_view view() const { return {data, N - 1}; }
+
+  char data[N] = {};
+};
+
+// A byte string known at compile time, such as a file signature. The
+// comparison is unrolled by the compiler; searching for a literal is left to
+// `FastSearch`, whose vectorized filter beats a scalar scan even with the skip
+// table built at compile time.
+template <FixedString Needle>
+class Searcher {
+ public:
+  static constexpr size_t kSize = Needle.size();
+  static_assert(kSize > 0, "the needle must not be empty");
+
+  static constexpr std::string_view view() { return Needle.view(); }
+
+  static constexpr bool IsPrefixOf(const uint8_t* s, size_t n) {
+    return s && n >= kSize && Equals(s, std::make_index_sequence<kSize>());
+  }
+
+ private:
+  static constexpr uint8_t At(size_t i) {
+    return static_cast<uint8_t>(Needle.data[i]);
+  }
+
+  template <size_t... I>
+  static constexpr bool Equals(const uint8_t* s, std::index_sequence<I...>) {
+    return ((s[I] == At(I)) && ...);
+  }
+};
+
 #endif  // CHROME_PLUS_SRC_FASTSEARCH_H_
@@ -76,11 +76,12 @@ BOOL WINAPI MyUpdateProcThreadAttribute(
     __in_opt PSIZE_T lpReturnSize) {
   if (Attribute == PROC_THREAD_ATTRIBUTE_MITIGATION_POLICY &&
       cbSize >= sizeof(DWORD64)) {
+    ConfigReadScope config_scope;
     // https://source.chromium.org/chromium/chromium/src/+/main:sandbox/win/src/process_mitigations.cc;l=362;drc=4c2fec5f6699ffeefd93137d2bf8c03504c6664c
     PDWORD64 policy_value_1 = &(static_cast<PDWORD64>(lpValue))[0];
     *policy_value_1 &= ~static_cast<DWORD64>(
         ProcessCreationMitigationPolicy::BlockNonMicrosoftBinariesAlwaysOn);
-    if (config.IsWin32K()) {
+    if (config->IsWin32K()) {
       *policy_value_1 &= static_cast<DWORD64>(
           ProcessCreationMitigationPolicy::Win32kSystemCallDisableAlwaysOn);
     }
@@ -183,7 +184,7 @@ void MakeGreen() {
   DetourAttach(reinterpret_cast<LPVOID*>(&RawCryptUnprotectData),
                reinterpret_cast<void*>(MyCryptUnprotectData));
 
-  if (config.IsShowPassword()) {
+  if (config->IsShowPassword()) {
     // advapi32.dll
     DetourAttach(reinterpret_cast<LPVOID*>(&RawLogonUserW),
                  reinterpret_cast<void*>(MyLogonUserW));
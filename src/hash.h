@@ -0,0 +1,18 @@
+#ifndef CHROME_PLUS_SRC_HASH_H_
+#define CHROME_PLUS_SRC_HASH_H_
+
+#include <cstdint>
+#include <span>
+
+// FNV-1a, which is plenty for telling apart two builds of the same file or
+// two tabs of the same window.
+inline uint64_t HashBytes(std::span<const uint8_t> bytes) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (uint8_t byte : bytes) {
+    hash ^= byte;
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+#endif  // CHROME_PLUS_SRC_HASH_H_
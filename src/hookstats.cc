@@ -0,0 +1,158 @@
+#include "hookstats.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "iaccessible.h"
+#include "utils.h"
+
+#if defined(_DEBUG)
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#endif
+
+namespace {
+
+constexpr std::array<const wchar_t*, static_cast<size_t>(HookHandler::kCount)>
+    kHookHandlerNames = {
+        L"MouseMove",   L"ButtonDown", L"LButtonUp",
+        L"RButtonUp",   L"MButtonUp",  L"DoubleClick",
+        L"MouseWheel",  L"Keyboard",   L"Other",
+};
+
+constexpr uint32_t kReportInterval = 1000;
+
+struct HookHandlerStats {
+  LatencyHistogram latency_us;
+  uint32_t over_budget = 0;
+  uint64_t com_calls = 0;
+  uint32_t max_com_calls = 0;
+};
+
+// Only touched from the thread the hooks are installed on.
+std::array<HookHandlerStats, static_cast<size_t>(HookHandler::kCount)>
+    hook_stats;
+
+LONGLONG GetPerformanceFrequency() {
+  static const LONGLONG frequency = [] {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return frequency.QuadPart;
+  }();
+  return frequency;
+}
+
+void AddToStats(const HookTraceRecord& record) {
+  auto& stats = hook_stats[static_cast<size_t>(record.handler)];
+  stats.latency_us.Add(record.latency_us);
+  stats.com_calls += record.com_calls;
+  stats.max_com_calls =
+      std::max<uint32_t>(stats.max_com_calls, record.com_calls);
+  if (record.latency_us > kHookBudgetUs) {
+    ++stats.over_budget;
+    DebugLog(L"{}: took {} us, over the {} us budget",
+             kHookHandlerNames[static_cast<size_t>(record.handler)],
+             record.latency_us, kHookBudgetUs);
+  }
+
+  uint32_t count = stats.latency_us.count();
+  if (count % kReportInterval == 0) {
+    DebugLog(
+        L"{}: {} calls, p50 {} us, p99 {} us, max {} us, {} over budget, "
+        L"{} accessibility calls on average, {} at most",
+        kHookHandlerNames[static_cast<size_t>(record.handler)], count,
+        stats.latency_us.GetPercentile(50), stats.latency_us.GetPercentile(99),
+        stats.latency_us.max(), stats.over_budget, stats.com_calls / count,
+        stats.max_com_calls);
+  }
+}
+
+#if defined(_DEBUG)
+// Records are written in batches of this many.
+constexpr size_t kHookTraceBatch = 256;
+
+class HookTraceWriter {
+ public:
+  HookTraceWriter() {
+    std::filesystem::path path = GetAppDir();
+    path /= L"Chrome++_HookTrace.bin";
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+      DebugLog(L"HookTraceWriter failed: cannot open {}", path.wstring());
+      return;
+    }
+    uint32_t header[] = {kHookTraceFormat, sizeof(HookTraceRecord)};
+    file_.write(kHookTraceMagic, sizeof(kHookTraceMagic));
+    file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+    records_.reserve(kHookTraceBatch);
+  }
+
+  ~HookTraceWriter() { Flush(); }
+
+  void Append(HookTraceRecord record, LONGLONG start) {
+    if (!file_.is_open()) {
+      return;
+    }
+    if (first_start_ == 0) {
+      first_start_ = start;
+    }
+    record.time_us = static_cast<uint64_t>(
+        (start - first_start_) * 1000000 / GetPerformanceFrequency());
+    records_.push_back(record);
+    if (records_.size() >= kHookTraceBatch) {
+      Flush();
+    }
+  }
+
+ private:
+  void Flush() {
+    if (records_.empty()) {
+      return;
+    }
+    file_.write(reinterpret_cast<const char*>(records_.data()),
+                records_.size() * sizeof(HookTraceRecord));
+    file_.flush();
+    records_.clear();
+  }
+
+  std::ofstream file_;
+  std::vector<HookTraceRecord> records_;
+  LONGLONG first_start_ = 0;
+};
+#endif
+
+}  // namespace
+
+HookLatencyScope::HookLatencyScope(HookHandler handler,
+                                   UINT message,
+                                   POINT pt,
+                                   uint32_t data) {
+  record_.handler = handler;
+  record_.message = message;
+  record_.x = pt.x;
+  record_.y = pt.y;
+  record_.data = data;
+  QueryPerformanceCounter(&start_);
+}
+
+HookLatencyScope::~HookLatencyScope() {
+  LARGE_INTEGER end;
+  QueryPerformanceCounter(&end);
+  record_.latency_us = static_cast<uint32_t>(std::min<LONGLONG>(
+      (end.QuadPart - start_.QuadPart) * 1000000 / GetPerformanceFrequency(),
+      std::numeric_limits<uint32_t>::max()));
+  record_.com_calls = static_cast<uint16_t>(
+      std::min<uint32_t>(GetAccessibleCallStats().com_calls,
+                         std::numeric_limits<uint16_t>::max()));
+  AddToStats(record_);
+
+#if defined(_DEBUG)
+  static HookTraceWriter writer;
+  writer.Append(record_, start_.QuadPart);
+#endif
+}
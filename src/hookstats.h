@@ -0,0 +1,29 @@
+#ifndef CHROME_PLUS_SRC_HOOKSTATS_H_
+#define CHROME_PLUS_SRC_HOOKSTATS_H_
+
+#include <windows.h>
+
+#include <cstdint>
+
+#include "hooktrace.h"
+
+// Times one hook call. On destruction it adds the latency and the
+// accessibility calls counted by the `AccessibleSnapshotScope` of the call to
+// the statistics of `handler`, which are logged every 1000 calls along with
+// their p50, p99 and max. It must be constructed before that scope.
+class HookLatencyScope {
+ public:
+  HookLatencyScope(HookHandler handler,
+                   UINT message,
+                   POINT pt = {},
+                   uint32_t data = 0);
+  ~HookLatencyScope();
+  HookLatencyScope(const HookLatencyScope&) = delete;
+  HookLatencyScope& operator=(const HookLatencyScope&) = delete;
+
+ private:
+  HookTraceRecord record_;
+  LARGE_INTEGER start_;
+};
+
+#endif  // CHROME_PLUS_SRC_HOOKSTATS_H_
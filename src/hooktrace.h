@@ -0,0 +1,142 @@
+#ifndef CHROME_PLUS_SRC_HOOKTRACE_H_
+#define CHROME_PLUS_SRC_HOOKTRACE_H_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// The parts of the hook statistics that do not depend on Windows, so that
+// traces can be replayed and their latencies summarized on any platform.
+
+// The handlers the input hooks dispatch to, which latency is kept for.
+enum class HookHandler : uint8_t {
+  kMouseMove,  // Drag-new-tab arming.
+  kButtonDown,
+  kLButtonUp,  // Bookmarks and drag-new-tab drops.
+  kRButtonUp,
+  kMButtonUp,
+  kDoubleClick,
+  kMouseWheel,
+  kKeyboard,
+  kOther,
+  kCount,
+};
+
+// Chrome does not process an input event before the hooks have returned, so
+// any time spent in them beyond this budget is input lag. Slower work belongs
+// in a task queued with `PostUITask`.
+inline constexpr uint32_t kHookBudgetUs = 1000;
+
+// One hook call in the trace that debug builds write to
+// Chrome++_HookTrace.bin next to chrome++.ini. The file starts with the magic
+// "CPPHOOKT", the format version and the record size as two `uint32_t`, and
+// is followed by the records in call order.
+#pragma pack(push, 1)
+struct HookTraceRecord {
+  // Since the first record of the trace.
+  uint64_t time_us = 0;
+  uint32_t latency_us = 0;
+  // Calls made into the accessibility objects of the browser, saturated.
+  uint16_t com_calls = 0;
+  HookHandler handler = HookHandler::kOther;
+  uint8_t reserved = 0;
+  // The window message, `WM_KEYDOWN` or `WM_KEYUP` for the keyboard hook.
+  uint32_t message = 0;
+  int32_t x = 0;
+  int32_t y = 0;
+  // The wheel delta of mouse messages and the virtual key of key messages.
+  uint32_t data = 0;
+};
+#pragma pack(pop)
+static_assert(sizeof(HookTraceRecord) == 32);
+
+inline constexpr char kHookTraceMagic[8] = {'C', 'P', 'P', 'H',
+                                            'O', 'O', 'K', 'T'};
+inline constexpr uint32_t kHookTraceFormat = 1;
+inline constexpr size_t kHookTraceHeaderSize =
+    sizeof(kHookTraceMagic) + 2 * sizeof(uint32_t);
+
+// Reads the records of a trace file. Returns false if `data` is not a trace
+// of this format; a partly written last record is dropped.
+inline bool ParseHookTrace(std::span<const uint8_t> data,
+                           std::vector<HookTraceRecord>& records) {
+  records.clear();
+  if (data.size() < kHookTraceHeaderSize ||
+      std::memcmp(data.data(), kHookTraceMagic, sizeof(kHookTraceMagic)) !=
+          0) {
+    return false;
+  }
+  uint32_t header[2];
+  std::memcpy(header, data.data() + sizeof(kHookTraceMagic), sizeof(header));
+  if (header[0] != kHookTraceFormat ||
+      header[1] != sizeof(HookTraceRecord)) {
+    return false;
+  }
+  data = data.subspan(kHookTraceHeaderSize);
+  records.resize(data.size() / sizeof(HookTraceRecord));
+  std::memcpy(records.data(), data.data(),
+              records.size() * sizeof(HookTraceRecord));
+  return true;
+}
+
+// A latency histogram with a fixed size. Values below 16 get a bucket each.
+// Above that, every power of two is split into 8 buckets, which bounds the
+// error of a percentile to 12.5%. The unit is up to the caller.
+class LatencyHistogram {
+ public:
+  void Add(uint32_t value) {
+    ++buckets_[GetBucket(value)];
+    ++count_;
+    max_ = std::max(max_, value);
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t max() const { return max_; }
+
+  uint64_t GetPercentile(uint32_t percent) const {
+    uint64_t rank = (uint64_t{count_} * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        return std::min<uint64_t>(GetBucketLimit(i), max_);
+      }
+    }
+    return max_;
+  }
+
+ private:
+  static constexpr int kExactBuckets = 16;
+  static constexpr int kSubBuckets = 8;
+  static constexpr int kBucketCount = kExactBuckets + (32 - 4) * kSubBuckets;
+
+  static int GetBucket(uint32_t value) {
+    if (value < kExactBuckets) {
+      return static_cast<int>(value);
+    }
+    int exponent = std::bit_width(value) - 1;
+    int mantissa = (value >> (exponent - 3)) & (kSubBuckets - 1);
+    return kExactBuckets + (exponent - 4) * kSubBuckets + mantissa;
+  }
+
+  // The largest value that falls into `bucket`.
+  static uint64_t GetBucketLimit(int bucket) {
+    if (bucket < kExactBuckets) {
+      return bucket;
+    }
+    int exponent = (bucket - kExactBuckets) / kSubBuckets + 4;
+    int mantissa = (bucket - kExactBuckets) % kSubBuckets;
+    return ((uint64_t{kSubBuckets} + mantissa + 1) << (exponent - 3)) - 1;
+  }
+
+  std::array<uint32_t, kBucketCount> buckets_ = {};
+  uint32_t count_ = 0;
+  uint32_t max_ = 0;
+};
+
+#endif  // CHROME_PLUS_SRC_HOOKTRACE_H_
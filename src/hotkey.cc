@@ -8,8 +8,11 @@
 #include <tlhelp32.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cwctype>
 #include <iterator>
+#include <latch>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -25,6 +28,22 @@ namespace {
 
 using HotkeyAction = void (*)();
 
+// All global hotkeys are registered to one message-only window, whose thread
+// also runs the unmute retries and handles the audio session notifications.
+constexpr wchar_t kHotkeyWindowClass[] = L"ChromePlusHotkey";
+constexpr UINT kReloadHotkeysMessage = WM_APP + 1;
+constexpr UINT kSessionCreatedMessage = WM_APP + 2;
+
+// Set from the start of a service thread until it has exited.
+std::atomic<bool> hotkey_service_running = false;
+
+// Null while the service is not running. Everything below is only touched
+// from the service thread.
+std::atomic<HWND> hotkey_window = nullptr;
+
+// Set once the window is being destroyed, after which reloads are refused.
+bool hotkey_service_stopping = false;
+
 // Static variables for internal use
 bool is_hide = false;
 std::vector<HWND> hwnd_list;
@@ -37,65 +56,14 @@ constexpr UINT kUnmuteRetryDelayMs = 200;
 constexpr int kUnmuteRetryMax = 5;
 int unmute_retry_left = 0;
 bool unmute_watch_active = false;
-bool unmute_watch_com_initialized = false;
-bool unmute_watch_com_should_uninit = false;
 IAudioSessionNotification* unmute_watch_notification = nullptr;
 std::vector<IAudioSessionManager2*> unmute_watch_managers;
 
 #define MOD_NOREPEAT 0x4000
 
-UINT ParseHotkeys(std::wstring_view keys) {
-  UINT mo = 0;
-  UINT vk = 0;
-  std::wstring temp(keys);
-  std::vector<std::wstring> key_parts = StringSplit(temp, L'+');
-
-  static const std::unordered_map<std::wstring, UINT> key_map = {
-      {L"shift", MOD_SHIFT},  {L"ctrl", MOD_CONTROL}, {L"alt", MOD_ALT},
-      {L"win", MOD_WIN},      {L"left", VK_LEFT},     {L"right", VK_RIGHT},
-      {L"up", VK_UP},         {L"down", VK_DOWN},     {L"←", VK_LEFT},
-      {L"→", VK_RIGHT},       {L"↑", VK_UP},          {L"↓", VK_DOWN},
-      {L"esc", VK_ESCAPE},    {L"tab", VK_TAB},       {L"backspace", VK_BACK},
-      {L"enter", VK_RETURN},  {L"space", VK_SPACE},   {L"prtsc", VK_SNAPSHOT},
-      {L"scroll", VK_SCROLL}, {L"pause", VK_PAUSE},   {L"insert", VK_INSERT},
-      {L"delete", VK_DELETE}, {L"end", VK_END},       {L"home", VK_HOME},
-      {L"pageup", VK_PRIOR},  {L"pagedown", VK_NEXT},
-  };
-
-  for (auto& key : key_parts) {
-    std::ranges::transform(key, key.begin(), ::towlower);
-
-    if (key_map.contains(key)) {
-      if (key == L"shift" || key == L"ctrl" || key == L"alt" || key == L"win") {
-        mo |= key_map.at(key);
-      } else {
-        vk = key_map.at(key);
-      }
-    } else {
-      TCHAR wch = key[0];
-      if (key.length() == 1)  // Parse single characters A-Z, 0-9, etc.
-      {
-        if (isalnum(wch)) {
-          vk = toupper(wch);
-        } else {
-          vk = LOWORD(VkKeyScan(wch));
-        }
-      } else if (wch == 'F' || wch == 'f')  // Parse the F1-F24 function keys.
-      {
-        if (isdigit(key[1])) {
-          int fx = _wtoi(&key[1]);
-          if (fx >= 1 && fx <= 24) {
-            vk = VK_F1 + fx - 1;
-          }
-        }
-      }
-    }
-  }
-
-  mo |= MOD_NOREPEAT;
-
-  return MAKELPARAM(mo, vk);
-}
+static_assert(kModifierAlt == MOD_ALT && kModifierControl == MOD_CONTROL &&
+              kModifierShift == MOD_SHIFT && kModifierWin == MOD_WIN &&
+              kModifierNoRepeat == MOD_NOREPEAT);
 
 BOOL CALLBACK SearchChromeWindow(HWND hwnd, LPARAM lparam) {
   if (IsWindowVisible(hwnd)) {
@@ -362,7 +330,7 @@ Cleanup:
 
 void StopUnmuteRetries(bool clear_state) {
   if (unmute_retry_left > 0) {
-    KillTimer(nullptr, kUnmuteRetryTimerId);
+    KillTimer(hotkey_window.load(), kUnmuteRetryTimerId);
   }
   unmute_retry_left = 0;
   if (clear_state) {
@@ -376,23 +344,58 @@ void StartUnmuteRetries() {
   if (unmute_retry_left <= 0) {
     return;
   }
-  if (SetTimer(nullptr, kUnmuteRetryTimerId, kUnmuteRetryDelayMs, nullptr) ==
-      0) {
+  if (SetTimer(hotkey_window.load(), kUnmuteRetryTimerId, kUnmuteRetryDelayMs,
+               nullptr) == 0) {
     StopUnmuteRetries(true);
   }
 }
 
-bool EnsureUnmuteWatchComInitialized() {
-  if (unmute_watch_com_initialized) {
-    return true;
+void UnmuteCreatedSession(IAudioSessionControl* new_session) {
+  IAudioSessionControl2* session2 = nullptr;
+  HRESULT hr = new_session->QueryInterface(__uuidof(IAudioSessionControl2),
+                                           (void**)&session2);
+  if (FAILED(hr) || !session2) {
+    return;
   }
-  HRESULT hr = CoInitialize(nullptr);
-  if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
-    return false;
+  DWORD session_pid = 0;
+  if (FAILED(session2->GetProcessId(&session_pid))) {
+    session2->Release();
+    return;
   }
-  unmute_watch_com_initialized = true;
-  unmute_watch_com_should_uninit = (hr == S_OK || hr == S_FALSE);
-  return true;
+  auto pids = GetAppPids();
+  if (std::find(pids.begin(), pids.end(), session_pid) == pids.end()) {
+    session2->Release();
+    return;
+  }
+
+  auto session_key = GetSessionKey(session2);
+  ISimpleAudioVolume* volume = nullptr;
+  hr = session2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&volume);
+  if (SUCCEEDED(hr) && volume) {
+    bool should_unmute = true;
+    if (session_key) {
+      auto it = original_mute_states.find(*session_key);
+      if (it != original_mute_states.end()) {
+        should_unmute = !it->second;
+      }
+    } else {
+      should_unmute = ShouldUnmuteUnknownSession();
+    }
+    if (should_unmute) {
+      volume->SetMute(FALSE, nullptr);
+    }
+    volume->Release();
+  }
+  session2->Release();
+}
+
+// Unmutes a session of the browser created while the watch is active, unless
+// it was muted before the browser was hidden. Releases `new_session`.
+void HandleSessionCreated(IAudioSessionControl* new_session) {
+  if (unmute_watch_active && !is_hide) {
+    UnmuteCreatedSession(new_session);
+  }
+  new_session->Release();
 }
 
 class SessionNotification final : public IAudioSessionNotification {
@@ -427,48 +430,19 @@ class SessionNotification final : public IAudioSessionNotification {
     return E_NOINTERFACE;
   }
 
+  // Called on a thread of the audio service. The session is handed to the
+  // service thread, which owns the mute state.
   HRESULT STDMETHODCALLTYPE OnSessionCreated(
       IAudioSessionControl* new_session) override {
-    if (!new_session || !unmute_watch_active || is_hide) {
+    HWND window = hotkey_window.load();
+    if (!new_session || !window) {
       return S_OK;
     }
-    IAudioSessionControl2* session2 = nullptr;
-    HRESULT hr = new_session->QueryInterface(__uuidof(IAudioSessionControl2),
-                                             (void**)&session2);
-    if (FAILED(hr) || !session2) {
-      return S_OK;
-    }
-    DWORD session_pid = 0;
-    if (FAILED(session2->GetProcessId(&session_pid))) {
-      session2->Release();
-      return S_OK;
-    }
-    auto pids = GetAppPids();
-    if (std::find(pids.begin(), pids.end(), session_pid) == pids.end()) {
-      session2->Release();
-      return S_OK;
-    }
-
-    auto session_key = GetSessionKey(session2);
-    ISimpleAudioVolume* volume = nullptr;
-    hr = session2->QueryInterface(__uuidof(ISimpleAudioVolume),
-                                  (void**)&volume);
-    if (SUCCEEDED(hr) && volume) {
-      bool should_unmute = true;
-      if (session_key) {
-        auto it = original_mute_states.find(*session_key);
-        if (it != original_mute_states.end()) {
-          should_unmute = !it->second;
-        }
-      } else {
-        should_unmute = ShouldUnmuteUnknownSession();
-      }
-      if (should_unmute) {
-        volume->SetMute(FALSE, nullptr);
-      }
-      volume->Release();
+    new_session->AddRef();
+    if (!PostMessageW(window, kSessionCreatedMessage, 0,
+                      reinterpret_cast<LPARAM>(new_session))) {
+      new_session->Release();
     }
-    session2->Release();
     return S_OK;
   }
 
@@ -490,11 +464,6 @@ void UnregisterUnmuteWatch(bool clear_state) {
     unmute_watch_notification->Release();
     unmute_watch_notification = nullptr;
   }
-  if (unmute_watch_com_initialized && unmute_watch_com_should_uninit) {
-    CoUninitialize();
-  }
-  unmute_watch_com_initialized = false;
-  unmute_watch_com_should_uninit = false;
   unmute_watch_active = false;
   if (clear_state) {
     ClearMuteStatesIfIdle();
@@ -505,9 +474,6 @@ void RegisterUnmuteWatch() {
   if (unmute_watch_active) {
     return;
   }
-  if (!EnsureUnmuteWatchComInitialized()) {
-    return;
-  }
   unmute_watch_notification = new SessionNotification();
 
   IMMDeviceEnumerator* enumerator = nullptr;
@@ -559,6 +525,18 @@ void HandleUnmuteRetryTimer() {
   }
 }
 
+void ShowChromeWindows() {
+  for (auto r_iter = hwnd_list.rbegin(); r_iter != hwnd_list.rend();
+       ++r_iter) {
+    ShowWindow(*r_iter, SW_SHOW);
+    SetWindowPos(*r_iter, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
+    SetForegroundWindow(*r_iter);
+    SetWindowPos(*r_iter, HWND_NOTOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
+    SetActiveWindow(*r_iter);
+  }
+  hwnd_list.clear();
+}
+
 void HideAndShow() {
   auto chrome_pids = GetAppPids();
   if (!is_hide) {
@@ -568,16 +546,7 @@ void HideAndShow() {
     EnumWindows(SearchChromeWindow, 0);
     MuteProcess(chrome_pids, true, true);
   } else {
-    for (auto r_iter = hwnd_list.rbegin(); r_iter != hwnd_list.rend();
-         ++r_iter) {
-      ShowWindow(*r_iter, SW_SHOW);
-      SetWindowPos(*r_iter, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE);
-      SetForegroundWindow(*r_iter);
-      SetWindowPos(*r_iter, HWND_NOTOPMOST, 0, 0, 0, 0,
-                   SWP_NOMOVE | SWP_NOSIZE);
-      SetActiveWindow(*r_iter);
-    }
-    hwnd_list.clear();
+    ShowChromeWindows();
     MuteProcess(chrome_pids, false, false, false);
     StartUnmuteRetries();
     StartUnmuteWatch();
@@ -585,67 +554,261 @@ void HideAndShow() {
   is_hide = !is_hide;
 }
 
-void OnHotkey(HotkeyAction action) {
-  action();
+struct GlobalHotkey {
+  const std::wstring& (Config::*keys)() const;
+  HotkeyAction action;
+};
+
+// The ID of a global hotkey is its index in this table plus one, so that
+// `WM_HOTKEY` is dispatched without a search.
+constexpr GlobalHotkey kGlobalHotkeys[] = {
+    {&Config::GetBossKey, HideAndShow},
+};
+
+std::array<bool, std::size(kGlobalHotkeys)> registered_hotkeys{};
+
+bool HasGlobalHotkeys() {
+  ConfigReadScope config_scope;
+  return std::ranges::any_of(kGlobalHotkeys, [](const GlobalHotkey& hotkey) {
+    return !(Config::Current().*hotkey.keys)().empty();
+  });
+}
+
+void UnregisterHotkeys(HWND hwnd) {
+  for (size_t i = 0; i < registered_hotkeys.size(); ++i) {
+    if (registered_hotkeys[i]) {
+      UnregisterHotKey(hwnd, static_cast<int>(i + 1));
+      registered_hotkeys[i] = false;
+    }
+  }
+}
+
+// Registers the hotkeys of the current config in place of the old ones, and
+// returns whether any is registered.
+bool RegisterHotkeys(HWND hwnd) {
+  UnregisterHotkeys(hwnd);
+  ConfigReadScope config_scope;
+  bool any = false;
+  for (size_t i = 0; i < std::size(kGlobalHotkeys); ++i) {
+    const auto& keys = (Config::Current().*kGlobalHotkeys[i].keys)();
+    if (keys.empty()) {
+      continue;
+    }
+    UINT flag = ParseHotkeys(keys);
+    if (!RegisterHotKey(hwnd, static_cast<int>(i + 1), LOWORD(flag),
+                        HIWORD(flag))) {
+      DebugLog(L"RegisterHotKey {} failed: {}", keys, GetLastError());
+      continue;
+    }
+    registered_hotkeys[i] = true;
+    any = true;
+  }
+  return any;
 }
 
-void Hotkey(std::wstring_view keys, HotkeyAction action) {
-  if (keys.empty()) {
+void OnHotkey(WPARAM id) {
+  if (id == 0 || id > std::size(kGlobalHotkeys)) {
     return;
-  } else {
-    UINT flag = ParseHotkeys(keys.data());
+  }
+  ConfigReadScope config_scope;
+  kGlobalHotkeys[id - 1].action();
+}
 
-    std::thread th([flag, action]() {
-      RegisterHotKey(nullptr, 0, LOWORD(flag), HIWORD(flag));
+// Undoes what the hotkeys left behind, so that the browser is not stuck
+// hidden or muted once no key can bring it back.
+void StopHotkeyService(HWND hwnd) {
+  UnregisterHotkeys(hwnd);
+  StopUnmuteRetries(false);
+  UnregisterUnmuteWatch(false);
+  if (is_hide) {
+    ShowChromeWindows();
+    MuteProcess(GetAppPids(), false, false, false);
+    is_hide = false;
+  }
+  ResetMuteStateTracking();
 
-      MSG msg;
-      while (GetMessage(&msg, nullptr, 0, 0)) {
-        if (msg.message == WM_TIMER) {
-          if (msg.wParam == kUnmuteRetryTimerId) {
-            HandleUnmuteRetryTimer();
-            continue;
-          }
-        }
-        if (msg.message == WM_HOTKEY) {
-          OnHotkey(action);
-        }
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+  MSG msg;
+  while (PeekMessageW(&msg, hwnd, kSessionCreatedMessage,
+                      kSessionCreatedMessage, PM_REMOVE)) {
+    reinterpret_cast<IAudioSessionControl*>(msg.lParam)->Release();
+  }
+  hotkey_window = nullptr;
+}
+
+LRESULT CALLBACK HotkeyWindowProc(HWND hwnd,
+                                  UINT message,
+                                  WPARAM wparam,
+                                  LPARAM lparam) {
+  switch (message) {
+    case WM_HOTKEY:
+      OnHotkey(wparam);
+      return 0;
+    case WM_TIMER:
+      if (wparam == kUnmuteRetryTimerId) {
+        HandleUnmuteRetryTimer();
+        return 0;
       }
-    });
-    th.detach();
+      break;
+    case kSessionCreatedMessage:
+      HandleSessionCreated(reinterpret_cast<IAudioSessionControl*>(lparam));
+      return 0;
+    case kReloadHotkeysMessage:
+      // `StopHotkeyService` peeks at messages, which delivers the ones sent
+      // meanwhile. The caller starts a new service when this returns 0.
+      if (hotkey_service_stopping) {
+        return 0;
+      }
+      if (!RegisterHotkeys(hwnd)) {
+        DestroyWindow(hwnd);
+      }
+      return 1;
+    case WM_DESTROY:
+      hotkey_service_stopping = true;
+      StopHotkeyService(hwnd);
+      PostQuitMessage(0);
+      return 0;
+  }
+  return DefWindowProcW(hwnd, message, wparam, lparam);
+}
+
+void RunHotkeyService(std::latch* started) {
+  // The audio session notifications are registered from this thread, and its
+  // message loop serves them.
+  HRESULT hr = CoInitialize(nullptr);
+  hotkey_service_stopping = false;
+  WNDCLASSEXW window_class = {sizeof(window_class)};
+  window_class.lpfnWndProc = HotkeyWindowProc;
+  window_class.hInstance = hInstance;
+  window_class.lpszClassName = kHotkeyWindowClass;
+  HWND window = nullptr;
+  if (RegisterClassExW(&window_class) ||
+      GetLastError() == ERROR_CLASS_ALREADY_EXISTS) {
+    window = CreateWindowExW(0, kHotkeyWindowClass, L"", 0, 0, 0, 0, 0,
+                             HWND_MESSAGE, nullptr, hInstance, nullptr);
+  }
+  if (!window) {
+    DebugLog(L"Hotkey service failed: {}", GetLastError());
+  } else {
+    hotkey_window = window;
+    if (!RegisterHotkeys(window)) {
+      DestroyWindow(window);
+    }
   }
+  started->count_down();
+
+  if (window) {
+    MSG msg;
+    while (GetMessageW(&msg, nullptr, 0, 0) > 0) {
+      DispatchMessageW(&msg);
+    }
+  }
+  if (SUCCEEDED(hr)) {
+    CoUninitialize();
+  }
+  hotkey_service_running = false;
+  hotkey_service_running.notify_all();
+}
+
+// Returns once the service has registered its hotkeys, or has given up. The
+// thread is detached, as a joinable `std::thread` left in a static would
+// terminate the process when the DLL is unloaded; a new service waits for
+// the previous one to exit instead of joining it.
+void StartHotkeyService() {
+  hotkey_service_running.wait(true);
+  hotkey_service_running = true;
+  std::latch started(1);
+  std::thread(RunHotkeyService, &started).detach();
+  started.wait();
 }
 
 }  // anonymous namespace
 
-UINT ParseTranslateKey() {
-  const auto& translate_key = config.GetTranslateKey();
-  if (translate_key.empty()) {
-    return 0;
+UINT ParseHotkeys(std::wstring_view keys) {
+  UINT mo = 0;
+  UINT vk = 0;
+  std::wstring temp(keys);
+  std::vector<std::wstring> key_parts = StringSplit(temp, L'+');
+
+  static const std::unordered_map<std::wstring, UINT> key_map = {
+      {L"shift", MOD_SHIFT},  {L"ctrl", MOD_CONTROL}, {L"alt", MOD_ALT},
+      {L"win", MOD_WIN},      {L"left", VK_LEFT},     {L"right", VK_RIGHT},
+      {L"up", VK_UP},         {L"down", VK_DOWN},     {L"←", VK_LEFT},
+      {L"→", VK_RIGHT},       {L"↑", VK_UP},          {L"↓", VK_DOWN},
+      {L"esc", VK_ESCAPE},    {L"tab", VK_TAB},       {L"backspace", VK_BACK},
+      {L"enter", VK_RETURN},  {L"space", VK_SPACE},   {L"prtsc", VK_SNAPSHOT},
+      {L"scroll", VK_SCROLL}, {L"pause", VK_PAUSE},   {L"insert", VK_INSERT},
+      {L"delete", VK_DELETE}, {L"end", VK_END},       {L"home", VK_HOME},
+      {L"pageup", VK_PRIOR},  {L"pagedown", VK_NEXT},
+  };
+
+  for (auto& key : key_parts) {
+    std::ranges::transform(key, key.begin(), ::towlower);
+
+    if (key_map.contains(key)) {
+      if (key == L"shift" || key == L"ctrl" || key == L"alt" || key == L"win") {
+        mo |= key_map.at(key);
+      } else {
+        vk = key_map.at(key);
+      }
+    } else {
+      TCHAR wch = key[0];
+      if (key.length() == 1)  // Parse single characters A-Z, 0-9, etc.
+      {
+        if (isalnum(wch)) {
+          vk = toupper(wch);
+        } else {
+          vk = LOWORD(VkKeyScan(wch));
+        }
+      } else if (wch == 'F' || wch == 'f')  // Parse the F1-F24 function keys.
+      {
+        if (isdigit(key[1])) {
+          int fx = _wtoi(&key[1]);
+          if (fx >= 1 && fx <= 24) {
+            vk = VK_F1 + fx - 1;
+          }
+        }
+      }
+    }
   }
-  return ParseHotkeys(translate_key.c_str());
+
+  mo |= MOD_NOREPEAT;
+
+  return MAKELPARAM(mo, vk);
 }
 
-UINT ParseSwitchToPrevKey() {
-  const auto& switch_to_prev = config.GetSwitchToPrevKey();
-  if (switch_to_prev.empty()) {
-    return 0;
+bool AreModifiersPressed(uint32_t modifiers) {
+  if ((modifiers & MOD_SHIFT) && !IsPressed(VK_SHIFT)) {
+    return false;
+  }
+  if ((modifiers & MOD_CONTROL) && !IsPressed(VK_CONTROL)) {
+    return false;
+  }
+  if ((modifiers & MOD_ALT) && !IsPressed(VK_MENU)) {
+    return false;
+  }
+  if ((modifiers & MOD_WIN) && !IsPressed(VK_LWIN) && !IsPressed(VK_RWIN)) {
+    return false;
   }
-  return ParseHotkeys(switch_to_prev.c_str());
+  return true;
 }
 
-UINT ParseSwitchToNextKey() {
-  const auto& switch_to_next = config.GetSwitchToNextKey();
-  if (switch_to_next.empty()) {
-    return 0;
+void GetHotkey() {
+  if (HasGlobalHotkeys()) {
+    StartHotkeyService();
   }
-  return ParseHotkeys(switch_to_next.c_str());
 }
 
-void GetHotkey() {
-  const auto& boss_key = config.GetBossKey();
-  if (!boss_key.empty()) {
-    Hotkey(boss_key, HideAndShow);
+void ReloadHotkeys() {
+  // Waits so that the service has re-registered its hotkeys, or shut down for
+  // lack of any, by the time the next reload comes. The window can destroy
+  // itself at any point after it has been loaded here: a message that finds
+  // it gone fails, and one that finds it being destroyed is refused, so in
+  // both cases a new service is started once the old one has exited.
+  HWND window = hotkey_window.load();
+  if (window && SendMessageW(window, kReloadHotkeysMessage, 0, 0)) {
+    return;
+  }
+  if (HasGlobalHotkeys()) {
+    StartHotkeyService();
   }
 }
@@ -3,10 +3,24 @@
 
 #include <windows.h>
 
+#include <cstdint>
+#include <string_view>
+
+#include "keybindings.h"
+
+// Returns `MAKELPARAM(modifiers, vk)` for a string like "Ctrl+Alt+B".
+UINT ParseHotkeys(std::wstring_view keys);
+
+// Whether all of `modifiers`, a combination of `MOD_*` flags, are held down.
+bool AreModifiersPressed(uint32_t modifiers);
+
+// Registers the global hotkeys of the config, such as the boss key, on a
+// service thread of their own. The thread is not started when none is set.
 void GetHotkey();
 
-UINT ParseTranslateKey();
-UINT ParseSwitchToPrevKey();
-UINT ParseSwitchToNextKey();
+// Registers the global hotkeys again after the config has been reloaded,
+// starting the service if it was not running and stopping it if no hotkey is
+// left. Stopping it shows and unmutes the browser if it was hidden.
+void ReloadHotkeys();
 
 #endif  // CHROME_PLUS_SRC_HOTKEY_H_
@@ -5,18 +5,108 @@
 #include <oleacc.h>
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <optional>
 #include <ranges>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "accessibletree.h"
 #include "config.h"
+#include "elementpath.h"
+#include "tabstrip.h"
+#include "uiatabs.h"
 #include "utils.h"
 
 namespace {
 
+static_assert(kRoleMenuItem == ROLE_SYSTEM_MENUITEM);
+static_assert(kRolePane == ROLE_SYSTEM_PANE);
+static_assert(kRoleToolbar == ROLE_SYSTEM_TOOLBAR);
+static_assert(kRolePageTab == ROLE_SYSTEM_PAGETAB);
+static_assert(kRoleText == ROLE_SYSTEM_TEXT);
+static_assert(kRolePushButton == ROLE_SYSTEM_PUSHBUTTON);
+static_assert(kRolePageTabList == ROLE_SYSTEM_PAGETABLIST);
+static_assert(kStateFocused == STATE_SYSTEM_FOCUSED);
+static_assert(kStateCollapsed == STATE_SYSTEM_COLLAPSED);
+
+// Each value is read at most once per snapshot. The browser only changes the
+// tree in response to input, which the hooks see before it does, so a value
+// stays good until the handler itself acts on the browser.
+struct AccessibleMemo {
+  struct NodeInfo {
+    // Keeps the pointer used as the key alive.
+    NodePtr node;
+    std::optional<long> role;
+    std::optional<long> state;
+    std::optional<std::optional<RECT>> location;
+    std::optional<NodePtr> parent;
+    std::optional<std::vector<NodePtr>> children;
+    // Results of `FindElementWithRole` by role.
+    std::map<long, NodePtr> found;
+    // Set on the page tab list when UI Automation is enabled.
+    std::optional<std::shared_ptr<const UIATabStrip>> uia_tab_strip;
+  };
+
+  NodeInfo& Get(const NodePtr& node) {
+    auto [it, inserted] = nodes.try_emplace(node.Get());
+    if (inserted) {
+      it->second.node = node;
+    }
+    return it->second;
+  }
+
+  std::unordered_map<IAccessible*, NodeInfo> nodes;
+};
+
+struct SnapshotState {
+  int depth = 0;
+  AccessibleMemo* memo = nullptr;
+  AccessibleCallStats stats;
+};
+
+thread_local SnapshotState snapshot_state;
+
+// Created on first use, since most mouse events never touch the tree.
+AccessibleMemo* GetAccessibleMemo() {
+  SnapshotState& state = snapshot_state;
+  if (state.depth == 0) {
+    return nullptr;
+  }
+  if (!state.memo) {
+    state.memo = new AccessibleMemo;
+  }
+  return state.memo;
+}
+
+void CountComCall(uint32_t count = 1) {
+  if (snapshot_state.depth > 0) {
+    snapshot_state.stats.com_calls += count;
+  }
+}
+
+// Returns the memoized `field` of `node`, calling `fetch` to fill it in.
+template <typename T, typename Fetch>
+T Memoize(const NodePtr& node,
+          std::optional<T> AccessibleMemo::NodeInfo::* field,
+          Fetch fetch) {
+  AccessibleMemo* memo = GetAccessibleMemo();
+  if (!memo) {
+    return fetch();
+  }
+  std::optional<T>& value = memo->Get(node).*field;
+  if (value) {
+    ++snapshot_state.stats.memo_hits;
+  } else {
+    value = fetch();
+  }
+  return *value;
+}
+
 template <typename Function>
 void GetAccessibleName(const NodePtr& node, Function f) {
   VARIANT self;
@@ -24,6 +114,7 @@ void GetAccessibleName(const NodePtr& node, Function f) {
   self.lVal = CHILDID_SELF;
 
   BSTR bstr = nullptr;
+  CountComCall();
   if (S_OK == node->get_accName(self, &bstr)) {
     f(bstr);
     SysFreeString(bstr);
@@ -37,6 +128,7 @@ void GetAccessibleDescription(const NodePtr& node, Function f) {
   self.lVal = CHILDID_SELF;
 
   BSTR bstr = nullptr;
+  CountComCall();
   if (S_OK == node->get_accDescription(self, &bstr)) {
     f(bstr);
     SysFreeString(bstr);
@@ -50,32 +142,44 @@ void GetAccessibleValue(const NodePtr& node, Function f) {
   self.lVal = CHILDID_SELF;
 
   BSTR bstr = nullptr;
+  CountComCall();
   if (S_OK == node->get_accValue(self, &bstr)) {
     f(bstr);
     SysFreeString(bstr);
   }
 }
 
-template <typename Function>
-void GetAccessibleSize(const NodePtr& node, Function f) {
+std::optional<RECT> ReadAccessibleLocation(const NodePtr& node) {
   VARIANT self;
   self.vt = VT_I4;
   self.lVal = CHILDID_SELF;
 
   RECT rect;
-  if (S_OK == node->accLocation(&rect.left, &rect.top, &rect.right,
+  CountComCall();
+  if (S_OK != node->accLocation(&rect.left, &rect.top, &rect.right,
                                 &rect.bottom, self)) {
-    auto [left, top, right, bottom] = rect;
-    f({left, top, right + left, bottom + top});
+    return std::nullopt;
   }
+  auto [left, top, right, bottom] = rect;
+  return RECT{left, top, right + left, bottom + top};
 }
 
-long GetAccessibleRole(const NodePtr& node) {
+template <typename Function>
+void GetAccessibleSize(const NodePtr& node, Function f) {
+  auto location = Memoize(node, &AccessibleMemo::NodeInfo::location,
+                          [&node] { return ReadAccessibleLocation(node); });
+  if (location) {
+    f(*location);
+  }
+}
+
+long ReadAccessibleRole(const NodePtr& node) {
   VARIANT self;
   self.vt = VT_I4;
   self.lVal = CHILDID_SELF;
 
   VARIANT role;
+  CountComCall();
   if (S_OK == node->get_accRole(self, &role)) {
     if (role.vt == VT_I4) {
       return role.lVal;
@@ -84,12 +188,18 @@ long GetAccessibleRole(const NodePtr& node) {
   return 0;
 }
 
-long GetAccessibleState(const NodePtr& node) {
+long GetAccessibleRole(const NodePtr& node) {
+  return Memoize(node, &AccessibleMemo::NodeInfo::role,
+                 [&node] { return ReadAccessibleRole(node); });
+}
+
+long ReadAccessibleState(const NodePtr& node) {
   VARIANT self;
   self.vt = VT_I4;
   self.lVal = CHILDID_SELF;
 
   VARIANT state;
+  CountComCall();
   if (S_OK == node->get_accState(self, &state)) {
     if (state.vt == VT_I4) {
       return state.lVal;
@@ -98,6 +208,40 @@ long GetAccessibleState(const NodePtr& node) {
   return 0;
 }
 
+long GetAccessibleState(const NodePtr& node) {
+  return Memoize(node, &AccessibleMemo::NodeInfo::state,
+                 [&node] { return ReadAccessibleState(node); });
+}
+
+// Fetches all children of `node` at once, for the snapshot.
+std::vector<NodePtr> GetAccessibleChildren(const NodePtr& node) {
+  std::vector<NodePtr> children;
+  long child_count = 0;
+  CountComCall();
+  if (S_OK != node->get_accChildCount(&child_count) || child_count <= 0) {
+    return children;
+  }
+
+  auto arr_children = std::make_unique<VARIANT[]>(child_count);
+  long get_count = 0;
+  CountComCall();
+  if (S_OK != AccessibleChildren(node.Get(), 0, child_count,
+                                 arr_children.get(), &get_count)) {
+    return children;
+  }
+  children.reserve(get_count);
+  for (long i = 0; i < get_count; ++i) {
+    NodePtr child_node = nullptr;
+    if (arr_children[i].vt == VT_DISPATCH &&
+        S_OK == arr_children[i].pdispVal->QueryInterface(
+                    IID_IAccessible, (void**)(&child_node))) {
+      children.push_back(std::move(child_node));
+    }
+    VariantClear(&arr_children[i]);
+  }
+  return children;
+}
+
 template <typename Function>
 void TraversalAccessible(const NodePtr& node,
                          Function f,
@@ -106,6 +250,25 @@ void TraversalAccessible(const NodePtr& node,
     return;
   }
 
+  if (GetAccessibleMemo()) {
+    // A copy, since `f` may invalidate the snapshot.
+    const std::vector<NodePtr> children =
+        Memoize(node, &AccessibleMemo::NodeInfo::children,
+                [&node] { return GetAccessibleChildren(node); });
+    for (const NodePtr& child_node : children) {
+      if (raw_traversal) {
+        TraversalAccessible(child_node, f, true);
+        if (f(child_node)) {
+          return;
+        }
+      } else if (!(GetAccessibleState(child_node) & STATE_SYSTEM_INVISIBLE) &&
+                 f(child_node)) {
+        return;
+      }
+    }
+    return;
+  }
+
   long child_count = 0;
   if (S_OK != node->get_accChildCount(&child_count) || child_count == 0) {
     return;
@@ -170,67 +333,334 @@ NodePtr GetParentElement(const NodePtr& child) {
   if (!child) {
     return nullptr;
   }
-  NodePtr element = nullptr;
-  Microsoft::WRL::ComPtr<IDispatch> dispatch = nullptr;
-  if (S_OK == child->get_accParent(&dispatch) && dispatch) {
-    NodePtr parent = nullptr;
-    if (S_OK == dispatch->QueryInterface(IID_IAccessible, (void**)&parent)) {
-      element = parent;
+  return Memoize(child, &AccessibleMemo::NodeInfo::parent, [&child] {
+    NodePtr element = nullptr;
+    Microsoft::WRL::ComPtr<IDispatch> dispatch = nullptr;
+    CountComCall();
+    if (S_OK == child->get_accParent(&dispatch) && dispatch) {
+      NodePtr parent = nullptr;
+      if (S_OK == dispatch->QueryInterface(IID_IAccessible, (void**)&parent)) {
+        element = parent;
+      }
+    }
+    return element;
+  });
+}
+
+// All children of `node`, invisible ones included, in the order
+// `AccessibleChildren` returns them.
+std::vector<NodePtr> GetAllChildren(const NodePtr& node) {
+  return Memoize(node, &AccessibleMemo::NodeInfo::children,
+                 [&node] { return GetAccessibleChildren(node); });
+}
+
+// Like `FindElementWithRole`, and records the way down to the element in
+// `path`.
+NodePtr FindElementPathWithRole(const NodePtr& node,
+                                long target_role,
+                                ElementPath& path) {
+  const std::vector<NodePtr> children = GetAllChildren(node);
+  for (size_t i = 0; i < children.size(); ++i) {
+    const NodePtr& child = children[i];
+    if (GetAccessibleState(child) & STATE_SYSTEM_INVISIBLE) {
+      continue;
+    }
+    long role = GetAccessibleRole(child);
+    path.push_back({static_cast<uint32_t>(i), static_cast<int32_t>(role)});
+    if (role == target_role) {
+      return child;
+    }
+    if (IsBrowserUIContainer(role)) {
+      if (NodePtr element = FindElementPathWithRole(child, target_role, path)) {
+        return element;
+      }
     }
+    path.pop_back();
   }
-  return element;
+  return nullptr;
 }
 
-bool IsBrowserUIContainer(long role) {
-  // We should keep these restrictions to avoid unbounded DFS, which may
-  // traverse into unexpected subtree (e.g. web content) instead of staying
-  // within the browser UI tree. We might get buggy controls or false
-  // positives (#56, #191).
-  return role == ROLE_SYSTEM_PANE || role == ROLE_SYSTEM_TOOLBAR;
+// Walks `path` down from `node`. Returns nullptr as soon as a step leads to a
+// missing or invisible child or one whose role changed.
+NodePtr FollowElementPath(NodePtr node, const ElementPath& path) {
+  for (const auto& step : path) {
+    if (!node) {
+      return nullptr;
+    }
+    const std::vector<NodePtr> children = GetAllChildren(node);
+    if (step.index >= children.size()) {
+      return nullptr;
+    }
+    node = children[step.index];
+    if (GetAccessibleRole(node) != step.role ||
+        (GetAccessibleState(node) & STATE_SYSTEM_INVISIBLE)) {
+      return nullptr;
+    }
+  }
+  return node;
 }
-// Recursively find an element with the specified role, with or without pruning.
-// To find a element when specifing more than one condition (e.g. name
-// description, state, etc), use lambda to recurse manually.
-NodePtr FindElementWithRole(const NodePtr& node,
-                            long target_role,
-                            auto predicate) {
-  if (!node) {
+
+// Finds the element with `role` below the widget root `root`. The tree only
+// changes shape between Chrome builds, so the paths learned earlier are tried
+// first, which costs a few calls per level instead of a search through every
+// pane on the way.
+NodePtr LocateElement(const NodePtr& root, long role) {
+  if (!root) {
     return nullptr;
   }
-  NodePtr element = nullptr;
-  TraversalAccessible(node, [&](const NodePtr& child) {
-    const auto child_role = GetAccessibleRole(child);
-    if (child_role == target_role) {
-      element = child;
-      return true;
-    } else if (predicate(child_role)) {
-      element = FindElementWithRole(child, target_role, predicate);
-      if (element) {
-        return true;
-      }
+  for (const ElementPath& path : GetElementPaths(role)) {
+    if (NodePtr element = FollowElementPath(root, path)) {
+      return element;
     }
-    return false;
-  });
+  }
+  ElementPath path;
+  NodePtr element = FindElementPathWithRole(root, role, path);
+  if (element) {
+    AddElementPath(role, std::move(path));
+  }
   return element;
 }
 
+// The live MSAA tree for the algorithms in accessibletree.h, read through the
+// snapshot when there is one.
+struct MsaaTree {
+  using Node = NodePtr;
+  using Rect = RECT;
+
+  long Role(const NodePtr& node) const { return GetAccessibleRole(node); }
+
+  long State(const NodePtr& node) const { return GetAccessibleState(node); }
+
+  NodePtr Parent(const NodePtr& node) const { return GetParentElement(node); }
+
+  std::optional<RECT> Location(const NodePtr& node) const {
+    std::optional<RECT> location;
+    GetAccessibleSize(node, [&location](RECT rect) { location = rect; });
+    return location;
+  }
+
+  void Description(const NodePtr& node, auto f) const {
+    GetAccessibleDescription(node, [&f](BSTR bstr) {
+      f(bstr ? std::wstring_view(bstr) : std::wstring_view());
+    });
+  }
+
+  void ForEachChild(const NodePtr& node, auto f) const {
+    TraversalAccessible(node, f);
+  }
+
+  NodePtr RememberFind(const NodePtr& node, long role, auto find) const {
+    AccessibleMemo* memo = GetAccessibleMemo();
+    if (!memo || !node) {
+      return find();
+    }
+    auto& found = memo->Get(node).found;
+    if (auto it = found.find(role); it != found.end()) {
+      ++snapshot_state.stats.memo_hits;
+      return it->second;
+    }
+    NodePtr element = find();
+    found.emplace(role, element);
+    return element;
+  }
+};
+
+static_assert(AccessibleTree<MsaaTree>);
+
 NodePtr FindElementWithRole(const NodePtr& node, long target_role) {
-  return FindElementWithRole(node, target_role, IsBrowserUIContainer);
+  return FindElementWithRole(MsaaTree{}, node, target_role);
 }
 
 NodePtr FindPageTabPane(const NodePtr& node) {
-  if (!node) {
+  return FindPageTabPane(MsaaTree{}, node);
+}
+
+// Screen geometry of the tab strip of one browser window. Mouse hooks hit-test
+// against it instead of walking the accessibility tree on every event, which
+// costs a cross-process call per visited node.
+struct Region {
+  RECT rect = {};
+  NodePtr node = nullptr;
+  // Set instead of `node` for tabs read through UI Automation, which are only
+  // turned into an `IAccessible` when a caller asks for one.
+  ElementPtr element = nullptr;
+};
+
+using UIRegionMap = TabStripRegions<RECT, Region>;
+
+struct WindowCache {
+  HWND hwnd = nullptr;
+  RECT window_rect = {};
+  NodePtr top = nullptr;
+  ULONGLONG expire_tick = 0;
+  std::optional<UIRegionMap> regions;
+  ULONGLONG regions_expire_tick = 0;
+};
+
+// Only touched from the UI thread the hooks are installed on.
+std::vector<WindowCache> window_caches;
+ULONGLONG ui_region_settle_tick = 0;
+
+// The name of the new tab button only depends on the UI language, so unlike
+// the rest of the cache it is kept for as long as the window lives.
+struct NewTabButtonName {
+  HWND hwnd = nullptr;
+  std::wstring name;
+};
+std::vector<NewTabButtonName> new_tab_button_names;
+
+// The tab strip only moves with its window, so its bounds outlive the region
+// map and answer whether a point is on it without reading the tree.
+struct TabStripBounds {
+  HWND hwnd = nullptr;
+  RECT window_rect = {};
+  RECT tab_strip = {};
+};
+std::vector<TabStripBounds> tab_strip_bounds;
+
+// The tab strip of `top` read through UI Automation, or nullptr when that is
+// disabled in the config or fails, in which case callers use MSAA instead.
+std::shared_ptr<const UIATabStrip> GetUIATabStrip(const NodePtr& top) {
+  if (!config->IsUIAutomation() || !top) {
     return nullptr;
   }
-  NodePtr page_tab_list = FindElementWithRole(node, ROLE_SYSTEM_PAGETABLIST);
+  NodePtr page_tab_list = FindElementWithRole(top, ROLE_SYSTEM_PAGETABLIST);
   if (!page_tab_list) {
     return nullptr;
   }
-  NodePtr page_tab = FindElementWithRole(page_tab_list, ROLE_SYSTEM_PAGETAB);
-  if (!page_tab) {
+  return Memoize(
+      page_tab_list, &AccessibleMemo::NodeInfo::uia_tab_strip,
+      [&page_tab_list]() -> std::shared_ptr<const UIATabStrip> {
+        auto strip = std::make_shared<UIATabStrip>();
+        bool read = ReadUIATabStrip(page_tab_list.Get(), *strip);
+        CountComCall(strip->com_calls);
+        return read ? strip : nullptr;
+      });
+}
+
+NodePtr GetUIATabNode(IUIAutomationElement* element) {
+  CountComCall();
+  return GetUIAElementAccessible(element);
+}
+
+// Chrome keeps one accessibility object per node for as long as the node
+// lives, so the COM identity of a tab read through MSAA tells it apart. An
+// address can only be reused once the tab it belonged to has closed.
+TabKey GetIdentityKey(const NodePtr& node) {
+  Microsoft::WRL::ComPtr<IUnknown> identity;
+  CountComCall();
+  if (FAILED(node.As(&identity))) {
+    return 0;
+  }
+  return reinterpret_cast<uintptr_t>(identity.Get());
+}
+
+bool BuildUIRegionMap(const NodePtr& top, UIRegionMap& map) {
+  map = {};
+  if (auto strip = GetUIATabStrip(top)) {
+    map.tab_strip = strip->bounds;
+    map.horizontal = IsHorizontal(map.tab_strip);
+    for (const auto& button : strip->new_tab_buttons) {
+      map.new_tab_buttons.push_back(button.rect);
+    }
+    for (const auto& rect : strip->close_buttons) {
+      map.close_buttons.items.push_back({rect, nullptr, nullptr});
+    }
+    for (const auto& tab : strip->tabs) {
+      map.tabs.items.push_back({tab.rect, nullptr, tab.element});
+    }
+    map.tab_count =
+        static_cast<int>(strip->tabs.size()) + strip->collapsed_groups;
+    SortRegions(map.tabs, map.horizontal);
+    SortRegions(map.close_buttons, map.horizontal);
+    return true;
+  }
+
+  return BuildTabStripRegions(MsaaTree{}, top, map);
+}
+
+bool IsWindowCacheValid(const WindowCache& cache, ULONGLONG now) {
+  if (now >= cache.expire_tick || !cache.hwnd) {
+    return false;
+  }
+  RECT rect;
+  return GetWindowRect(cache.hwnd, &rect) &&
+         EqualRect(&rect, &cache.window_rect);
+}
+
+WindowCache* FindWindowCache(auto predicate) {
+  const auto now = GetTickCount64();
+  std::erase_if(window_caches, [now](const WindowCache& cache) {
+    return !IsWindowCacheValid(cache, now);
+  });
+  auto it = std::ranges::find_if(window_caches, predicate);
+  return it == window_caches.end() ? nullptr : &*it;
+}
+
+// Returns the region map of the window cache `predicate` picks if it is cached
+// and still current, without building one.
+const UIRegionMap* FindCachedUIRegionMapIf(auto predicate) {
+  const WindowCache* cache = FindWindowCache(predicate);
+  if (!cache || !cache->regions ||
+      GetTickCount64() >= cache->regions_expire_tick) {
+    return nullptr;
+  }
+  return &*cache->regions;
+}
+
+const UIRegionMap* FindCachedUIRegionMap(const NodePtr& top) {
+  if (!top) {
+    return nullptr;
+  }
+  return FindCachedUIRegionMapIf([&top](const WindowCache& entry) {
+    return entry.top.Get() == top.Get();
+  });
+}
+
+const UIRegionMap* FindCachedUIRegionMap(HWND hwnd) {
+  if (!hwnd) {
+    return nullptr;
+  }
+  return FindCachedUIRegionMapIf(
+      [hwnd](const WindowCache& entry) { return entry.hwnd == hwnd; });
+}
+
+// Returns the region map of the window `top` belongs to, rebuilding it when
+// it has been invalidated or has expired.
+const UIRegionMap* GetUIRegionMap(const NodePtr& top) {
+  if (!top) {
+    return nullptr;
+  }
+  WindowCache* cache = FindWindowCache([&top](const WindowCache& entry) {
+    return entry.top.Get() == top.Get();
+  });
+  if (!cache) {
+    // `top` was not obtained from `GetTopContainerView`; build a map that is
+    // only used for this query.
+    static UIRegionMap scratch;
+    return BuildUIRegionMap(top, scratch) ? &scratch : nullptr;
+  }
+
+  const auto now = GetTickCount64();
+  if (cache->regions && now < cache->regions_expire_tick) {
+    return &*cache->regions;
+  }
+  UIRegionMap map;
+  if (!BuildUIRegionMap(top, map)) {
+    // The cached view may have been destroyed; look it up again next time.
+    cache->expire_tick = 0;
     return nullptr;
   }
-  return GetParentElement(page_tab);
+  std::erase_if(tab_strip_bounds, [cache](const TabStripBounds& bounds) {
+    return bounds.hwnd == cache->hwnd;
+  });
+  tab_strip_bounds.push_back(
+      {cache->hwnd, cache->window_rect, map.tab_strip});
+  cache->regions = std::move(map);
+  cache->regions_expire_tick = now < ui_region_settle_tick
+                                   ? ui_region_settle_tick
+                                   : cache->expire_tick;
+  return &*cache->regions;
 }
 
 [[maybe_unused]] NodePtr FindChildElement(const NodePtr& parent,
@@ -285,12 +715,59 @@ std::optional<std::wstring> GetStdNameFromNewTabButton(
                           : std::optional<std::wstring>{std_name};
 }
 
+// Returns the name of the new tab button of the window `top` belongs to, or an
+// empty string if it cannot be found.
+std::wstring GetNewTabButtonName(const NodePtr& top,
+                                 const NodePtr& page_tab_list) {
+  const WindowCache* cache = FindWindowCache([&top](const WindowCache& entry) {
+    return entry.top.Get() == top.Get();
+  });
+  HWND hwnd = cache ? cache->hwnd : nullptr;
+  std::erase_if(new_tab_button_names, [](const NewTabButtonName& entry) {
+    return !IsWindow(entry.hwnd);
+  });
+  auto it = std::ranges::find(new_tab_button_names, hwnd,
+                              &NewTabButtonName::hwnd);
+  if (hwnd && it != new_tab_button_names.end()) {
+    return it->name;
+  }
+
+  auto name = GetStdNameFromNewTabButton(page_tab_list);
+  if (!name) {
+    return {};
+  }
+  // Only cache a name that was found, see #191.
+  if (hwnd) {
+    new_tab_button_names.push_back({hwnd, *name});
+  }
+  return std::move(*name);
+}
+
+bool IsNewTabName(std::wstring_view tab_name, std::wstring_view std_name) {
+  return (!std_name.empty() &&
+          tab_name.find(std_name) != std::wstring_view::npos) ||
+         config->GetDisableTabNameMatcher().Contains(tab_name);
+}
+
 // Determine whether it is a new tab page from the name of the current tab page.
 bool IsNameNewTab(const NodePtr& top) {
   if (!top) {
     return false;
   }
 
+  if (auto strip = GetUIATabStrip(top)) {
+    std::wstring_view std_name;
+    for (const auto& button : strip->new_tab_buttons) {
+      if (!button.name.empty()) {
+        std_name = button.name;
+        break;
+      }
+    }
+    return std::ranges::any_of(strip->tabs, [&std_name](const auto& tab) {
+      return tab.selected && IsNewTabName(tab.name, std_name);
+    });
+  }
+
   NodePtr page_tab_list = FindElementWithRole(top, ROLE_SYSTEM_PAGETABLIST);
   if (!page_tab_list) {
     return false;
@@ -305,49 +782,26 @@ bool IsNameNewTab(const NodePtr& top) {
   }
 
   bool is_new_tab = false;
-  const auto names_from_config =
-      StringSplit(config.GetDisableTabName(), L',', L"\"");
-  const auto std_name = GetStdNameFromNewTabButton(page_tab_list);
-  TraversalAccessible(
-      page_tab_pane,
-      [&is_new_tab, &std_name, &names_from_config](const NodePtr& child) {
-        if ((GetAccessibleState(child) & STATE_SYSTEM_SELECTED) == 0) {
-          return false;
-        }
-        GetAccessibleName(
-            child, [&is_new_tab, &std_name, &names_from_config](BSTR bstr) {
-              if (!bstr || is_new_tab) {
-                return;
-              }
-
-              std::wstring_view selected_tab_name(bstr);
-              if (std_name.has_value() &&
-                  selected_tab_name.find(std_name.value()) !=
-                      std::wstring_view::npos) {
-                is_new_tab = true;
-                return;
-              }
-
-              for (const auto& name_from_config : names_from_config) {
-                if (name_from_config.empty()) {
-                  continue;
-                }
-                if (selected_tab_name.find(name_from_config) !=
-                    std::wstring_view::npos) {
-                  is_new_tab = true;
-                  break;
-                }
-              }
-            });
-        return is_new_tab;
-      });
+  const auto std_name = GetNewTabButtonName(top, page_tab_list);
+  TraversalAccessible(page_tab_pane, [&is_new_tab,
+                                      &std_name](const NodePtr& child) {
+    if ((GetAccessibleState(child) & STATE_SYSTEM_SELECTED) == 0) {
+      return false;
+    }
+    GetAccessibleName(child, [&is_new_tab, &std_name](BSTR bstr) {
+      if (bstr) {
+        is_new_tab = IsNewTabName(bstr, std_name);
+      }
+    });
+    return is_new_tab;
+  });
   return is_new_tab;
 }
 
 // Determine whether it is a new tab page from the document value of the tab
 // page.
 bool IsDocNewTab() {
-  const auto cr_command_line = config.GetCommandLine();
+  const auto cr_command_line = config->GetCommandLine();
   if (cr_command_line.find(L"--force-renderer-accessibility") ==
       std::wstring::npos) {
     return false;
@@ -357,13 +811,14 @@ bool IsDocNewTab() {
   HWND hwnd = FindWindowEx(GetForegroundWindow(), nullptr,
                            L"Chrome_RenderWidgetHostHWND", nullptr);
   NodePtr pacc_main_window = nullptr;
+  CountComCall();
   if (S_OK != AccessibleObjectFromWindow(hwnd, OBJID_WINDOW,
                                          IID_PPV_ARGS(&pacc_main_window))) {
     return false;
   }
 
   NodePtr document =
-      FindElementWithRole(pacc_main_window, ROLE_SYSTEM_DOCUMENT,
+      FindElementWithRole(MsaaTree{}, pacc_main_window, ROLE_SYSTEM_DOCUMENT,
                           [](long role) { return role == ROLE_SYSTEM_PANE; });
   if (document) {
     // The `accValue` of document needs to be obtained by adding the startup
@@ -395,6 +850,7 @@ NodePtr GetChromeWidgetWin(HWND hwnd) {
     DebugLog(L"GetChromeWidgetWin failed: class name mismatch, got '{}'", name);
     return nullptr;
   }
+  CountComCall();
   if (S_OK == AccessibleObjectFromWindow(hwnd, OBJID_WINDOW,
                                          IID_PPV_ARGS(&pacc_main_window))) {
     return pacc_main_window;
@@ -403,20 +859,117 @@ NodePtr GetChromeWidgetWin(HWND hwnd) {
 }
 
 NodePtr GetTopContainerView(HWND hwnd) {
+  if (!hwnd) {
+    return nullptr;
+  }
+  if (WindowCache* cache = FindWindowCache([hwnd](const WindowCache& entry) {
+        return entry.hwnd == hwnd;
+      })) {
+    return cache->top;
+  }
+
   NodePtr top_container_view = nullptr;
   NodePtr page_tab_list =
-      FindElementWithRole(GetChromeWidgetWin(hwnd), ROLE_SYSTEM_PAGETABLIST);
+      LocateElement(GetChromeWidgetWin(hwnd), ROLE_SYSTEM_PAGETABLIST);
   if (page_tab_list) {
     top_container_view = GetParentElement(page_tab_list);
   }
   if (!top_container_view) {
     DebugLog(L"GetTopContainerView failed");
+    return nullptr;
+  }
+
+  WindowCache cache;
+  if (GetWindowRect(hwnd, &cache.window_rect)) {
+    cache.hwnd = hwnd;
+    cache.top = top_container_view;
+    cache.expire_tick = GetTickCount64() + kWindowCacheMaxAgeMs;
+    window_caches.push_back(std::move(cache));
   }
   return top_container_view;
 }
 
+bool IsTabStripCached(HWND hwnd) {
+  return FindCachedUIRegionMap(hwnd) != nullptr;
+}
+
+std::optional<TabStripHit> HitCachedTabStrip(HWND hwnd, POINT pt) {
+  const UIRegionMap* map = FindCachedUIRegionMap(hwnd);
+  if (!map) {
+    return std::nullopt;
+  }
+  return HitTabStrip(*map, pt);
+}
+
+std::optional<int> GetCachedTabCount(HWND hwnd) {
+  const UIRegionMap* map = FindCachedUIRegionMap(hwnd);
+  return map ? std::optional<int>(map->tab_count) : std::nullopt;
+}
+
+std::optional<bool> IsInCachedTabStrip(HWND hwnd, POINT pt) {
+  if (!hwnd) {
+    return std::nullopt;
+  }
+  std::erase_if(tab_strip_bounds, [](const TabStripBounds& bounds) {
+    RECT rect;
+    return !GetWindowRect(bounds.hwnd, &rect) ||
+           !EqualRect(&rect, &bounds.window_rect);
+  });
+  auto bounds =
+      std::ranges::find(tab_strip_bounds, hwnd, &TabStripBounds::hwnd);
+  if (bounds == tab_strip_bounds.end()) {
+    return std::nullopt;
+  }
+  return PtInRect(&bounds->tab_strip, pt) != FALSE;
+}
+
+void PrefetchTabStrip(HWND hwnd) {
+  GetUIRegionMap(GetTopContainerView(hwnd));
+}
+
+void InvalidateUIRegions() {
+  for (auto& cache : window_caches) {
+    cache.regions.reset();
+  }
+  ui_region_settle_tick = GetTickCount64() + kUIRegionSettleMs;
+}
+
+AccessibleSnapshotScope::AccessibleSnapshotScope(std::wstring_view handler)
+    : handler_(handler) {
+  if (snapshot_state.depth++ == 0) {
+    snapshot_state.stats = {};
+  }
+}
+
+AccessibleSnapshotScope::~AccessibleSnapshotScope() {
+  SnapshotState& state = snapshot_state;
+  if (--state.depth > 0) {
+    return;
+  }
+  InvalidateAccessibleSnapshot();
+  if (state.stats.com_calls > 0) {
+    DebugLog(L"{}: {} accessibility calls, {} answered by the snapshot",
+             handler_, state.stats.com_calls, state.stats.memo_hits);
+  }
+}
+
+AccessibleCallStats GetAccessibleCallStats() {
+  return snapshot_state.stats;
+}
+
+void InvalidateAccessibleSnapshot() {
+  delete snapshot_state.memo;
+  snapshot_state.memo = nullptr;
+}
+
 // Gets the current number of tabs.
 int GetTabCount(const NodePtr& top) {
+  if (const UIRegionMap* map = FindCachedUIRegionMap(top)) {
+    return map->tab_count;
+  }
+  if (auto strip = GetUIATabStrip(top)) {
+    return static_cast<int>(strip->tabs.size()) + strip->collapsed_groups;
+  }
   NodePtr page_tab_pane = FindPageTabPane(top);
   if (!page_tab_pane) {
     return 0;
@@ -436,71 +989,74 @@ int GetTabCount(const NodePtr& top) {
       }));
 }
 
-std::vector<NodePtr> GetTabs(const NodePtr& top) {
-  std::vector<NodePtr> tabs;
-  NodePtr page_tab_pane = FindPageTabPane(top);
-  if (!page_tab_pane) {
+std::vector<TabInfo> GetTabs(const NodePtr& top) {
+  std::vector<TabInfo> tabs;
+  if (auto strip = GetUIATabStrip(top)) {
+    for (const auto& tab : strip->tabs) {
+      if (NodePtr node = GetUIATabNode(tab.element.Get())) {
+        tabs.push_back({std::move(node), tab.key, tab.selected});
+      }
+    }
     return tabs;
   }
-  TraversalAccessible(page_tab_pane, [&tabs](const NodePtr& child) {
-    if (GetAccessibleRole(child) == ROLE_SYSTEM_PAGETAB) {
-      tabs.push_back(child);
-    }
-    return false;
-  });
+  for (auto& node : CollectTabs(MsaaTree{}, top)) {
+    TabKey key = GetIdentityKey(node);
+    bool selected = (GetAccessibleState(node) & STATE_SYSTEM_SELECTED) != 0;
+    tabs.push_back({std::move(node), key, selected});
+  }
   return tabs;
 }
 
-NodePtr GetSelectedTab(const NodePtr& top) {
-  NodePtr page_tab_pane = FindPageTabPane(top);
-  if (!page_tab_pane) {
-    return nullptr;
+TabKeySet GetTabKeys(const std::vector<TabInfo>& tabs) {
+  TabKeySet keys;
+  keys.reserve(tabs.size());
+  for (const auto& tab : tabs) {
+    keys.insert(tab.key);
   }
-  NodePtr selected = nullptr;
-  TraversalAccessible(page_tab_pane, [&selected](const NodePtr& child) {
-    if (GetAccessibleRole(child) != ROLE_SYSTEM_PAGETAB) {
-      return false;
-    }
-    if ((GetAccessibleState(child) & STATE_SYSTEM_SELECTED) != 0) {
-      selected = child;
-      return true;
+  return keys;
+}
+
+const TabInfo* FindAddedTab(const TabKeySet& before,
+                            const std::vector<TabInfo>& tabs) {
+  const TabInfo* added = nullptr;
+  bool comparable = false;
+  for (const auto& tab : tabs) {
+    if (before.contains(tab.key)) {
+      comparable = true;
+    } else if (!added) {
+      added = &tab;
     }
-    return false;
-  });
-  return selected;
+  }
+  return comparable ? added : nullptr;
 }
 
 NodePtr GetTabAtPoint(const NodePtr& top, POINT pt) {
-  NodePtr page_tab_pane = FindPageTabPane(top);
-  if (!page_tab_pane) {
+  const UIRegionMap* map = GetUIRegionMap(top);
+  if (!map) {
     return nullptr;
   }
-  NodePtr hit = nullptr;
-  TraversalAccessible(page_tab_pane, [&hit, &pt](const NodePtr& child) {
-    if (GetAccessibleRole(child) != ROLE_SYSTEM_PAGETAB) {
-      return false;
-    }
-    GetAccessibleSize(child, [&hit, &pt, &child](RECT rect) {
-      if (PtInRect(&rect, pt)) {
-        hit = child;
-      }
-    });
-    return hit != nullptr;
-  });
-  return hit;
+  const Region* hit = HitRegion(map->tabs, map->horizontal, pt);
+  if (!hit) {
+    return nullptr;
+  }
+  return hit->node ? hit->node : GetUIATabNode(hit->element.Get());
 }
 
 bool SelectTab(const NodePtr& tab) {
   if (!tab) {
     return false;
   }
+  // The selection changes either way.
+  InvalidateAccessibleSnapshot();
   VARIANT self;
   self.vt = VT_I4;
   self.lVal = CHILDID_SELF;
+  CountComCall();
   if (S_OK == tab->accSelect(SELFLAG_TAKEFOCUS | SELFLAG_TAKESELECTION, self)) {
     VARIANT state;
     VariantInit(&state);
     bool selected = false;
+    CountComCall();
     if (S_OK == tab->get_accState(self, &state)) {
       selected = (state.vt == VT_I4) &&
                  ((state.lVal & STATE_SYSTEM_SELECTED) != 0);
@@ -510,33 +1066,54 @@ bool SelectTab(const NodePtr& tab) {
       return true;
     }
   }
+  CountComCall();
   return S_OK == tab->accDoDefaultAction(self);
 }
 
-// Whether the mouse is on a tab
-bool IsOnOneTab(const NodePtr& top, POINT pt) {
-  NodePtr page_tab_pane = FindPageTabPane(top);
-  if (!page_tab_pane) {
-    return false;
+TabInfo GetEventTab(HWND hwnd, LONG id_object, LONG id_child) {
+  NodePtr node;
+  VARIANT child;
+  VariantInit(&child);
+  CountComCall();
+  if (S_OK != AccessibleObjectFromEvent(hwnd, id_object, id_child, &node,
+                                        &child) ||
+      !node) {
+    return {};
   }
+  // Chrome exposes every node as an object of its own, so anything that comes
+  // back as a simple child of another object is not a tab.
+  bool is_object = child.vt == VT_I4 && child.lVal == CHILDID_SELF;
+  VariantClear(&child);
+  if (!is_object || GetAccessibleRole(node) != ROLE_SYSTEM_PAGETAB) {
+    return {};
+  }
+  TabKey key = GetIdentityKey(node);
+  bool selected = IsTabSelected(node);
+  return {std::move(node), key, selected};
+}
 
-  bool flag = false;
-  TraversalAccessible(page_tab_pane, [&flag, &pt](const NodePtr& child) {
-    if (GetAccessibleRole(child) != ROLE_SYSTEM_PAGETAB) {
-      return false;
-    }
-    GetAccessibleSize(child, [&flag, &pt](RECT rect) {
-      if (PtInRect(&rect, pt)) {
-        flag = true;
-      }
-    });
-    return flag;
-  });
-  return flag;
+bool HasEventTabKeys(const std::vector<TabInfo>& tabs) {
+  // Keys hashed from UI Automation runtime IDs never equal the identity of the
+  // MSAA node, so checking one tab is enough.
+  return !tabs.empty() && tabs.front().key == GetIdentityKey(tabs.front().node);
+}
+
+std::optional<int> CountTabsAfter(const NodePtr& tab) {
+  return tab ? CountTabsAfter(MsaaTree{}, tab) : std::nullopt;
+}
+
+bool IsTabSelected(const NodePtr& tab) {
+  return tab && (GetAccessibleState(tab) & STATE_SYSTEM_SELECTED) != 0;
+}
+
+// Whether the mouse is on a tab
+bool IsOnOneTab(const NodePtr& top, POINT pt) {
+  const UIRegionMap* map = GetUIRegionMap(top);
+  return map && HitRegion(map->tabs, map->horizontal, pt);
 }
 
 bool IsOnlyOneTab(const NodePtr& top) {
-  if (!config.IsKeepLastTab()) {
+  if (!config->IsKeepLastTab()) {
     return false;
   }
   auto tab_count = GetTabCount(top);
@@ -545,41 +1122,33 @@ bool IsOnlyOneTab(const NodePtr& top) {
 
 // Whether the mouse is on the tab bar
 bool IsOnTheTabBar(const NodePtr& top, POINT pt) {
-  bool flag = false;
-  NodePtr page_tab_list = FindElementWithRole(top, ROLE_SYSTEM_PAGETABLIST);    
-  if (!page_tab_list) {
+  if (!top) {
     return false;
   }
-  GetAccessibleSize(page_tab_list, [&flag, &pt](RECT rect) {
-    if (PtInRect(&rect, pt)) {
-      flag = true;
-    }
+  const WindowCache* cache = FindWindowCache([&top](const WindowCache& entry) {
+    return entry.top.Get() == top.Get();
   });
-  return flag;
+  if (cache) {
+    if (auto in_strip = IsInCachedTabStrip(cache->hwnd, pt)) {
+      return *in_strip;
+    }
+  }
+  const UIRegionMap* map = GetUIRegionMap(top);
+  return map && PtInRect(&map->tab_strip, pt);
 }
 
 bool IsOnNewTabButton(const NodePtr& top, POINT pt) {
-  NodePtr page_tab_list = FindElementWithRole(top, ROLE_SYSTEM_PAGETABLIST);
-  if (!page_tab_list) {
+  const UIRegionMap* map = GetUIRegionMap(top);
+  if (!map) {
     return false;
   }
-  bool hit = false;
-  TraversalAccessible(page_tab_list, [&hit, &pt](const NodePtr& child) {
-    if (GetAccessibleRole(child) != ROLE_SYSTEM_PUSHBUTTON) {
-      return false;
-    }
-    GetAccessibleSize(child, [&hit, &pt](RECT rect) {
-      if (PtInRect(&rect, pt)) {
-        hit = true;
-      }
-    });
-    return hit;
+  return std::ranges::any_of(map->new_tab_buttons, [&pt](const RECT& rect) {
+    return PtInRect(&rect, pt);
   });
-  return hit;
 }
 
 bool IsOnNewTab(const NodePtr& top) {
-  if (!config.IsNewTabDisable()) {
+  if (!config->IsNewTabDisable()) {
     return false;
   }
   return IsNameNewTab(top) || IsDocNewTab();
@@ -587,35 +1156,7 @@ bool IsOnNewTab(const NodePtr& top) {
 
 // Whether the mouse is on a bookmark.
 bool IsOnBookmark(HWND hwnd, POINT pt) {
-  bool flag = false;
-  auto find_bookmark = [&pt, &flag](this auto&& self,
-                                    const NodePtr& child) -> bool {
-    auto role = GetAccessibleRole(child);
-    if (role == ROLE_SYSTEM_PUSHBUTTON || role == ROLE_SYSTEM_MENUITEM) {
-      bool is_in_rect = false;
-      GetAccessibleSize(child, [&is_in_rect, &pt](RECT rect) {
-        if (PtInRect(&rect, pt)) {
-          is_in_rect = true;
-        }
-      });
-      if (is_in_rect) {
-        GetAccessibleDescription(child, [&flag](BSTR bstr) {
-          std::wstring_view bstr_view(bstr);
-          flag = (bstr_view.find_first_of(L".:") != std::wstring_view::npos) &&
-                 (bstr_view.substr(0, 11) != L"javascript:");
-        });
-        if (flag) {
-          return true;  // Stop traversing if found.
-        }
-      }
-    }
-    // traverse the child nodes.
-    TraversalAccessible(child, self);
-    return flag;
-  };
-  // Start traversing.
-  TraversalAccessible(GetChromeWidgetWin(hwnd), find_bookmark);
-  return flag;
+  return IsBookmarkAt(MsaaTree{}, GetChromeWidgetWin(hwnd), pt);
 }
 
 // Expanded drop-down list in the address bar
@@ -642,66 +1183,19 @@ bool IsOnExpandedList(HWND hwnd, POINT pt) {
 }
 
 bool IsOmniboxFocus(const NodePtr& top) {
-  if (!top) {
-    return false;
-  }
-
-  bool is_focused = false;
-  auto find_focused = [&is_focused](this auto&& self,
-                                    const NodePtr& node) -> bool {
-    if (GetAccessibleRole(node) == ROLE_SYSTEM_TEXT &&
-        (GetAccessibleState(node) & STATE_SYSTEM_FOCUSED)) {
-      is_focused = true;
-      return true;
-    }
-    TraversalAccessible(node, self, false);
-    return is_focused;
-  };
-
-  auto find_toolbar = [&](this auto&& self, const NodePtr& node) -> bool {
-    if (GetAccessibleRole(node) == ROLE_SYSTEM_TOOLBAR) {
-      find_focused(node);
-      if (is_focused) {
-        return true;
-      }
-      return false;
-    }
-    TraversalAccessible(node, self, false);
-
-    return is_focused;
-  };
-  TraversalAccessible(top, find_toolbar, false);
-  return is_focused;
+  return HasFocusedOmnibox(MsaaTree{}, top);
 }
 
 // Whether the mouse is on the close button of a tab.
 // Should be used together with `IsOnOneTab` to search the close button.
 bool IsOnCloseButton(const NodePtr& top, POINT pt) {
-  if (!top) {
-    return false;
-  }
-
-  bool found = false;
-  auto find_hit_button = [&](this auto&& self, const NodePtr& node) -> bool {
-    if (GetAccessibleRole(node) == ROLE_SYSTEM_PUSHBUTTON) {
-      GetAccessibleSize(node, [&](RECT rect) {
-        if (PtInRect(&rect, pt)) {
-          found = true;
-        }
-      });
-      if (found) {
-        return true;
-      }
-    }
-    TraversalAccessible(node, self);
-    return found;
-  };
-  TraversalAccessible(top, find_hit_button, false);
-  return found;
+  const UIRegionMap* map = GetUIRegionMap(top);
+  return map && HitRegion(map->close_buttons, map->horizontal, pt);
 }
 
 bool IsOnFindBarPane(POINT pt) {
   NodePtr root = nullptr;
+  CountComCall();
   if ((S_OK != AccessibleObjectFromWindow(GetFocus(), OBJID_CLIENT,
                                           IID_PPV_ARGS(&root))) ||
       !root) {
@@ -3,17 +3,94 @@
 
 #include <oleacc.h>
 #include <wrl/client.h>
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
+#include "tabstrip.h"
+
 using NodePtr = Microsoft::WRL::ComPtr<IAccessible>;
 
+// Identifies a tab across reads of the tab strip, which its `IAccessible`
+// does not: tabs read through UI Automation come back as a new proxy on every
+// read. Tabs read through UI Automation and through MSAA get different keys.
+// 0 stands for no tab.
+using TabKey = uint64_t;
+using TabKeySet = std::unordered_set<TabKey>;
+
+struct TabInfo {
+  NodePtr node;
+  TabKey key = 0;
+  bool selected = false;
+};
+
+struct AccessibleCallStats {
+  // Calls made into the accessibility objects of the browser.
+  uint32_t com_calls = 0;
+  // Lookups answered by the snapshot instead.
+  uint32_t memo_hits = 0;
+};
+
+// Memoizes the roles, states, locations, parents and children of the nodes
+// visited on this thread, and the results of role searches, until the
+// outermost scope ends. The functions below use the snapshot when one is
+// active, so a handler only has to open a scope. Nested scopes share the
+// outermost one.
+class AccessibleSnapshotScope {
+ public:
+  // `handler` names the scope in the debug log.
+  explicit AccessibleSnapshotScope(std::wstring_view handler);
+  ~AccessibleSnapshotScope();
+  AccessibleSnapshotScope(const AccessibleSnapshotScope&) = delete;
+  AccessibleSnapshotScope& operator=(const AccessibleSnapshotScope&) = delete;
+
+ private:
+  std::wstring_view handler_;
+};
+
+// Counters of the outermost scope active on this thread.
+AccessibleCallStats GetAccessibleCallStats();
+
+// Forgets everything the active snapshot has seen. Call it after acting on the
+// browser in a way that changes the tree, such as selecting a tab or running
+// a command.
+void InvalidateAccessibleSnapshot();
+
 NodePtr GetChromeWidgetWin(HWND hwnd);
 NodePtr GetTopContainerView(HWND hwnd);
 int GetTabCount(const NodePtr& top);
-std::vector<NodePtr> GetTabs(const NodePtr& top);
-NodePtr GetSelectedTab(const NodePtr& top);
+// In tab strip order.
+std::vector<TabInfo> GetTabs(const NodePtr& top);
 NodePtr GetTabAtPoint(const NodePtr& top, POINT pt);
 bool SelectTab(const NodePtr& tab);
+
+// The keys of `tabs`, to diff a later read of the tab strip against.
+TabKeySet GetTabKeys(const std::vector<TabInfo>& tabs);
+
+// The first of `tabs` whose key is not in `before`, or nullptr. Also nullptr
+// when none of `tabs` is in `before`, since the two reads cannot be compared
+// then, e.g. because only one of them went through UI Automation.
+const TabInfo* FindAddedTab(const TabKeySet& before,
+                            const std::vector<TabInfo>& tabs);
+
+// The tab a WinEvent was fired for, with no node if it was fired for anything
+// else. Its key is the one MSAA reads give the tab, so it only compares with
+// a read of the tab strip that did not go through UI Automation.
+TabInfo GetEventTab(HWND hwnd, LONG id_object, LONG id_child);
+
+// Whether `tabs` were read through MSAA, so that their keys compare with the
+// ones of `GetEventTab`.
+bool HasEventTabKeys(const std::vector<TabInfo>& tabs);
+
+// How many tabs follow `tab` in its tab strip, read from its siblings alone,
+// or nothing if it cannot be found there.
+std::optional<int> CountTabsAfter(const NodePtr& tab);
+
+bool IsTabSelected(const NodePtr& tab);
+
 bool IsOnOneTab(const NodePtr& top, POINT pt);
 bool IsOnlyOneTab(const NodePtr& top);
 bool IsOnTheTabBar(const NodePtr& top, POINT pt);
@@ -25,4 +102,29 @@ bool IsOmniboxFocus(const NodePtr& top);
 bool IsOnCloseButton(const NodePtr& top, POINT pt);
 bool IsOnFindBarPane(POINT pt);
 
+// Whether the tab strip of `hwnd` is cached and current, in which case the
+// queries above answer for it without calling into the browser.
+bool IsTabStripCached(HWND hwnd);
+
+// Hit-tests `pt` against the tab strip of `hwnd` if it is cached and current,
+// or returns nullopt. Like `IsInCachedTabStrip`, this never calls into the
+// browser, so the hooks decide from it whether to swallow an event.
+std::optional<TabStripHit> HitCachedTabStrip(HWND hwnd, POINT pt);
+
+// The number of tabs of `hwnd` if its tab strip is cached and current.
+std::optional<int> GetCachedTabCount(HWND hwnd);
+
+// Whether `pt` is on the tab strip of `hwnd` as it was last read, or nullopt
+// if it has not been read since the window last moved or resized. Never calls
+// into the browser, so it is cheap enough for every mouse move.
+std::optional<bool> IsInCachedTabStrip(HWND hwnd, POINT pt);
+
+// Reads the tab strip of `hwnd` into the cache ahead of the events that need
+// it.
+void PrefetchTabStrip(HWND hwnd);
+
+// Drops the cached tab strip geometry. Call it whenever user input may have
+// changed the tab list.
+void InvalidateUIRegions();
+
 #endif  // CHROME_PLUS_SRC_IACCESSIBLE_H_
@@ -0,0 +1,271 @@
+#include "ini.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr char32_t kReplacementCharacter = 0xFFFD;
+
+void AppendCodePoint(std::vector<wchar_t>& text, char32_t code_point) {
+  if constexpr (sizeof(wchar_t) == 2) {
+    if (code_point >= 0x10000) {
+      code_point -= 0x10000;
+      text.push_back(static_cast<wchar_t>(0xD800 + (code_point >> 10)));
+      text.push_back(static_cast<wchar_t>(0xDC00 + (code_point & 0x3FF)));
+      return;
+    }
+  }
+  text.push_back(static_cast<wchar_t>(code_point));
+}
+
+void DecodeUtf16Le(std::span<const uint8_t> bytes, std::vector<wchar_t>& text) {
+  text.reserve(bytes.size() / 2);
+  auto unit_at = [&bytes](size_t i) -> char16_t {
+    return static_cast<char16_t>(bytes[i * 2] | (bytes[i * 2 + 1] << 8));
+  };
+  size_t count = bytes.size() / 2;
+  for (size_t i = 0; i < count; ++i) {
+    char16_t unit = unit_at(i);
+    if constexpr (sizeof(wchar_t) == 2) {
+      text.push_back(static_cast<wchar_t>(unit));
+      continue;
+    }
+    if (unit < 0xD800 || unit > 0xDFFF) {
+      AppendCodePoint(text, unit);
+    } else if (unit < 0xDC00 && i + 1 < count && unit_at(i + 1) >= 0xDC00 &&
+               unit_at(i + 1) <= 0xDFFF) {
+      char32_t high = unit - 0xD800;
+      char32_t low = unit_at(++i) - 0xDC00;
+      AppendCodePoint(text, 0x10000 + (high << 10) + low);
+    } else {
+      AppendCodePoint(text, kReplacementCharacter);
+    }
+  }
+}
+
+void DecodeUtf8(std::span<const uint8_t> bytes, std::vector<wchar_t>& text) {
+  text.reserve(bytes.size());
+  size_t i = 0;
+  while (i < bytes.size()) {
+    uint8_t lead = bytes[i];
+    size_t length = lead < 0x80           ? 1
+                    : (lead >> 5) == 0x6  ? 2
+                    : (lead >> 4) == 0xE  ? 3
+                    : (lead >> 3) == 0x1E ? 4
+                                          : 0;
+    if (length == 0 || i + length > bytes.size()) {
+      AppendCodePoint(text, kReplacementCharacter);
+      ++i;
+      continue;
+    }
+
+    char32_t code_point = length == 1 ? lead : lead & (0x7F >> length);
+    bool valid = true;
+    for (size_t j = 1; j < length; ++j) {
+      if ((bytes[i + j] & 0xC0) != 0x80) {
+        valid = false;
+        break;
+      }
+      code_point = (code_point << 6) | (bytes[i + j] & 0x3F);
+    }
+    if (!valid || code_point > 0x10FFFF ||
+        (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+      AppendCodePoint(text, kReplacementCharacter);
+      ++i;
+      continue;
+    }
+    AppendCodePoint(text, code_point);
+    i += length;
+  }
+}
+
+std::wstring_view Trim(std::wstring_view text) {
+  constexpr std::wstring_view kBlanks = L" \t\r";
+  size_t begin = text.find_first_not_of(kBlanks);
+  if (begin == std::wstring_view::npos) {
+    return {};
+  }
+  size_t end = text.find_last_not_of(kBlanks);
+  return text.substr(begin, end - begin + 1);
+}
+
+std::wstring_view Unquote(std::wstring_view value) {
+  if (value.size() >= 2 && value.front() == value.back() &&
+      (value.front() == L'"' || value.front() == L'\'')) {
+    return value.substr(1, value.size() - 2);
+  }
+  return value;
+}
+
+int CompareNoCase(std::wstring_view a, std::wstring_view b) {
+  size_t size = std::min(a.size(), b.size());
+  for (size_t i = 0; i < size; ++i) {
+    auto ca = std::towlower(static_cast<std::wint_t>(a[i]));
+    auto cb = std::towlower(static_cast<std::wint_t>(b[i]));
+    if (ca != cb) {
+      return ca < cb ? -1 : 1;
+    }
+  }
+  return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+}
+
+}  // namespace
+
+std::optional<IniFile> IniFile::Load(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+  if (file.bad()) {
+    return std::nullopt;
+  }
+  return Parse(bytes);
+}
+
+IniFile IniFile::Parse(std::span<const uint8_t> bytes) {
+  IniFile ini;
+  if (bytes.size() >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+    DecodeUtf16Le(bytes.subspan(2), ini.text_);
+  } else {
+    if (bytes.size() >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB &&
+        bytes[2] == 0xBF) {
+      bytes = bytes.subspan(3);
+    }
+    DecodeUtf8(bytes, ini.text_);
+  }
+  ini.ParseText();
+  return ini;
+}
+
+void IniFile::ParseText() {
+  std::wstring_view text(text_.data(), text_.size());
+  std::wstring_view section;
+  bool in_section = false;
+  while (!text.empty()) {
+    size_t end = text.find(L'\n');
+    std::wstring_view line = Trim(text.substr(0, end));
+    text.remove_prefix(end == std::wstring_view::npos ? text.size() : end + 1);
+
+    if (line.empty() || line.front() == L';') {
+      continue;
+    }
+    if (line.front() == L'[') {
+      size_t close = line.find(L']');
+      in_section = close != std::wstring_view::npos;
+      if (in_section) {
+        section = Trim(line.substr(1, close - 1));
+      }
+      continue;
+    }
+
+    size_t equal = line.find(L'=');
+    if (!in_section || equal == std::wstring_view::npos) {
+      continue;
+    }
+    Entry entry;
+    entry.section = section;
+    entry.key = Trim(line.substr(0, equal));
+    entry.raw_value = Trim(line.substr(equal + 1));
+    entry.value = Unquote(entry.raw_value);
+    entry.order = entries_.size();
+    entries_.push_back(entry);
+  }
+
+  std::ranges::sort(entries_, [](const Entry& a, const Entry& b) {
+    if (int result = CompareNoCase(a.section, b.section)) {
+      return result < 0;
+    }
+    if (int result = CompareNoCase(a.key, b.key)) {
+      return result < 0;
+    }
+    return a.order < b.order;
+  });
+}
+
+std::span<const IniFile::Entry> IniFile::EqualRange(
+    std::wstring_view section,
+    std::wstring_view key) const {
+  auto compare = [&key](const Entry& entry, std::wstring_view section) {
+    if (int result = CompareNoCase(entry.section, section)) {
+      return result;
+    }
+    return key.empty() ? 0 : CompareNoCase(entry.key, key);
+  };
+  auto begin = std::ranges::partition_point(
+      entries_, [&](const Entry& entry) { return compare(entry, section) < 0; });
+  auto end = std::ranges::partition_point(
+      begin, entries_.end(),
+      [&](const Entry& entry) { return compare(entry, section) == 0; });
+  return {begin, end};
+}
+
+std::optional<std::wstring_view> IniFile::GetString(
+    std::wstring_view section,
+    std::wstring_view key) const {
+  if (key.empty()) {
+    return std::nullopt;
+  }
+  auto range = EqualRange(section, key);
+  if (range.empty()) {
+    return std::nullopt;
+  }
+  return range.front().value;
+}
+
+std::wstring_view IniFile::GetString(std::wstring_view section,
+                                     std::wstring_view key,
+                                     std::wstring_view default_value) const {
+  return GetString(section, key).value_or(default_value);
+}
+
+int IniFile::GetInt(std::wstring_view section,
+                    std::wstring_view key,
+                    int default_value) const {
+  auto value = GetString(section, key);
+  if (!value) {
+    return default_value;
+  }
+
+  bool negative = !value->empty() && value->front() == L'-';
+  // Kept in 64 bits and clamped, so that a long run of digits saturates
+  // instead of overflowing.
+  int64_t limit = negative ? -int64_t{std::numeric_limits<int>::min()}
+                           : std::numeric_limits<int>::max();
+  int64_t result = 0;
+  for (wchar_t c : value->substr(negative ? 1 : 0)) {
+    if (c < L'0' || c > L'9') {
+      break;
+    }
+    result = std::min(result * 10 + (c - L'0'), limit);
+  }
+  return static_cast<int>(negative ? -result : result);
+}
+
+std::vector<std::pair<std::wstring_view, std::wstring_view>>
+IniFile::GetSection(std::wstring_view section) const {
+  std::vector<const Entry*> matches;
+  for (const auto& entry : EqualRange(section, {})) {
+    matches.push_back(&entry);
+  }
+  std::ranges::sort(matches, {}, &Entry::order);
+
+  std::vector<std::pair<std::wstring_view, std::wstring_view>> result;
+  result.reserve(matches.size());
+  for (const Entry* entry : matches) {
+    result.emplace_back(entry->key, entry->raw_value);
+  }
+  return result;
+}
@@ -0,0 +1,68 @@
+#ifndef CHROME_PLUS_SRC_INI_H_
+#define CHROME_PLUS_SRC_INI_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// An INI file decoded and parsed in one go. All names and values are views
+// into a single buffer owned by the object. Lookups behave like
+// `GetPrivateProfileStringW`: section and key names are case-insensitive, the
+// first occurrence of a key wins, blanks around names and values are ignored
+// and a value wrapped in a pair of quotes is returned without them.
+class IniFile {
+ public:
+  IniFile() = default;
+
+  // Reads the file at `path`, or returns nothing if it is missing or cannot be
+  // read. An empty `IniFile` returns the default of every lookup.
+  static std::optional<IniFile> Load(const std::filesystem::path& path);
+
+  // Decodes UTF-16LE if `bytes` starts with its BOM, UTF-8 otherwise.
+  static IniFile Parse(std::span<const uint8_t> bytes);
+
+  std::optional<std::wstring_view> GetString(std::wstring_view section,
+                                             std::wstring_view key) const;
+
+  std::wstring_view GetString(std::wstring_view section,
+                              std::wstring_view key,
+                              std::wstring_view default_value) const;
+
+  // Like `GetPrivateProfileIntW`, reads the leading decimal digits of the
+  // value and returns 0 if there are none. Values out of the range of `int`
+  // are clamped to it.
+  int GetInt(std::wstring_view section,
+             std::wstring_view key,
+             int default_value) const;
+
+  // The keys and raw values of `section` in file order, with quotes kept.
+  std::vector<std::pair<std::wstring_view, std::wstring_view>> GetSection(
+      std::wstring_view section) const;
+
+ private:
+  struct Entry {
+    std::wstring_view section;
+    std::wstring_view key;
+    std::wstring_view value;
+    std::wstring_view raw_value;
+    size_t order = 0;
+  };
+
+  void ParseText();
+
+  // Entries whose section (and key, if not empty) match, in table order.
+  std::span<const Entry> EqualRange(std::wstring_view section,
+                                    std::wstring_view key) const;
+
+  // Moving a vector keeps its buffer, so the views stay valid.
+  std::vector<wchar_t> text_;
+  // Sorted by section, key and file order.
+  std::vector<Entry> entries_;
+};
+
+#endif  // CHROME_PLUS_SRC_INI_H_
@@ -0,0 +1,68 @@
+#ifndef CHROME_PLUS_SRC_INPUTSEQUENCE_H_
+#define CHROME_PLUS_SRC_INPUTSEQUENCE_H_
+
+#include <windows.h>
+
+#include <array>
+#include <cstddef>
+
+// Builds the input events for synthesized key presses at compile time. Only
+// the `INPUT` types are used, so that a stand-in for them is all the builder
+// needs outside Windows.
+
+// The down or up event of `key`, a virtual key or one of the mouse buttons
+// `VK_LBUTTON`, `VK_RBUTTON` and `VK_MBUTTON`. The left and right buttons are
+// the primary and secondary buttons, which the system setting may swap.
+constexpr INPUT MakeKeyInput(WORD key,
+                             bool up,
+                             bool swap_buttons,
+                             ULONG_PTR extra_info) {
+  INPUT input = {};
+  switch (key) {
+    case VK_LBUTTON:
+    case VK_RBUTTON: {
+      bool left = (key == VK_LBUTTON) != swap_buttons;
+      input.type = INPUT_MOUSE;
+      input.mi = {};
+      if (left) {
+        input.mi.dwFlags = up ? MOUSEEVENTF_LEFTUP : MOUSEEVENTF_LEFTDOWN;
+      } else {
+        input.mi.dwFlags = up ? MOUSEEVENTF_RIGHTUP : MOUSEEVENTF_RIGHTDOWN;
+      }
+      input.mi.dwExtraInfo = extra_info;
+      break;
+    }
+    case VK_MBUTTON:
+      input.type = INPUT_MOUSE;
+      input.mi = {};
+      input.mi.dwFlags = up ? MOUSEEVENTF_MIDDLEUP : MOUSEEVENTF_MIDDLEDOWN;
+      input.mi.dwExtraInfo = extra_info;
+      break;
+    default:
+      input.type = INPUT_KEYBOARD;
+      input.ki = {};
+      input.ki.wVk = key;
+      input.ki.dwFlags = KEYEVENTF_EXTENDEDKEY | (up ? KEYEVENTF_KEYUP : 0);
+      input.ki.dwExtraInfo = extra_info;
+      break;
+  }
+  return input;
+}
+
+// Presses `keys` in order, then releases them in the same order.
+template <typename... Keys>
+constexpr std::array<INPUT, 2 * sizeof...(Keys)> MakeKeyPresses(
+    bool swap_buttons,
+    ULONG_PTR extra_info,
+    Keys... keys) {
+  std::array<INPUT, 2 * sizeof...(Keys)> inputs = {};
+  size_t i = 0;
+  for (bool up : {false, true}) {
+    for (WORD key : {static_cast<WORD>(keys)...}) {
+      inputs[i++] = MakeKeyInput(key, up, swap_buttons, extra_info);
+    }
+  }
+  return inputs;
+}
+
+#endif  // CHROME_PLUS_SRC_INPUTSEQUENCE_H_
@@ -0,0 +1,81 @@
+#ifndef CHROME_PLUS_SRC_KEYBINDINGS_H_
+#define CHROME_PLUS_SRC_KEYBINDINGS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Actions that can be bound to a key pressed inside the browser window.
+enum class KeyAction : uint8_t {
+  kNone,
+  kTranslate,
+  kSwitchToPrev,
+  kSwitchToNext,
+};
+
+// Whether `action` changes the selected tab.
+inline constexpr bool IsTabAction(KeyAction action) {
+  return action == KeyAction::kSwitchToPrev ||
+         action == KeyAction::kSwitchToNext;
+}
+
+// The modifier flags of a hotkey, with the values of the `MOD_*` flags of
+// `RegisterHotKey`.
+inline constexpr uint32_t kModifierAlt = 0x0001;
+inline constexpr uint32_t kModifierControl = 0x0002;
+inline constexpr uint32_t kModifierShift = 0x0004;
+inline constexpr uint32_t kModifierWin = 0x0008;
+inline constexpr uint32_t kModifierNoRepeat = 0x4000;
+
+// Keyboard bindings compiled once from the config and indexed by virtual key,
+// so that the keyboard hook can reject unbound keys without any parsing.
+class KeyBindingTable {
+ public:
+  // `hotkey` is a value returned by `ParseHotkeys`: the modifier flags in the
+  // low word and the virtual key in the high word.
+  void Add(uint32_t hotkey, KeyAction action) {
+    uint32_t vk = hotkey >> 16;
+    if (vk == 0 || vk >= slots_.size()) {
+      return;
+    }
+    auto& slot = slots_[vk];
+    if (slot.count >= slot.bindings.size()) {
+      return;
+    }
+    // `kModifierNoRepeat` only matters for `RegisterHotKey`.
+    slot.bindings[slot.count++] = {(hotkey & 0xFFFF) & ~kModifierNoRepeat,
+                                   action};
+  }
+
+  // Returns the first action bound to `vk` for which `are_pressed(modifiers)`
+  // is true. Unbound keys return without calling it.
+  template <typename ArePressed>
+  KeyAction Match(size_t vk, ArePressed&& are_pressed) const {
+    if (vk >= slots_.size()) {
+      return KeyAction::kNone;
+    }
+    const auto& slot = slots_[vk];
+    for (uint8_t i = 0; i < slot.count; ++i) {
+      const auto& binding = slot.bindings[i];
+      if (are_pressed(binding.modifiers)) {
+        return binding.action;
+      }
+    }
+    return KeyAction::kNone;
+  }
+
+ private:
+  struct Binding {
+    uint32_t modifiers = 0;
+    KeyAction action = KeyAction::kNone;
+  };
+
+  struct Slot {
+    uint8_t count = 0;
+    std::array<Binding, 3> bindings{};
+  };
+
+  std::array<Slot, 256> slots_{};
+};
+
+#endif  // CHROME_PLUS_SRC_KEYBINDINGS_H_
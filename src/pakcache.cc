@@ -0,0 +1,163 @@
+#include "pakcache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "hash.h"
+#include "pakfile.h"
+#include "version.h"
+
+namespace {
+
+constexpr char kPakCacheMagic[8] = {'C', 'P', 'P', 'A', 'K', 'C', 'A', 'C'};
+constexpr uint32_t kPakCacheFormat = 3;
+// Larger entries would not come from `resources.pak`; treat them as corrupt.
+constexpr uint32_t kMaxEntrySize = 64 * 1024 * 1024;
+
+template <typename T>
+bool ReadValue(std::ifstream& file, T& value) {
+  return static_cast<bool>(
+      file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+template <typename T>
+void WriteValue(std::ofstream& file, const T& value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}  // namespace
+
+bool LoadPakCache(const std::filesystem::path& path,
+                  const PakCacheKey& key,
+                  std::vector<PakCacheEntry>& entries) {
+  entries.clear();
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  char magic[sizeof(kPakCacheMagic)];
+  uint32_t format = 0;
+  if (!file.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kPakCacheMagic, sizeof(magic)) != 0 ||
+      !ReadValue(file, format) || format != kPakCacheFormat) {
+    return false;
+  }
+
+  constexpr std::string_view kVersion = RELEASE_VER_STR;
+  uint32_t version_size = 0;
+  if (!ReadValue(file, version_size) || version_size != kVersion.size()) {
+    return false;
+  }
+  std::string version(version_size, '\0');
+  if (!file.read(version.data(), version_size) || version != kVersion) {
+    return false;
+  }
+
+  PakCacheKey cached_key;
+  if (!ReadValue(file, cached_key.file_size) ||
+      !ReadValue(file, cached_key.last_write_time) ||
+      !ReadValue(file, cached_key.index_hash) ||
+      !ReadValue(file, cached_key.rules_hash) ||
+      cached_key.file_size != key.file_size ||
+      cached_key.last_write_time != key.last_write_time ||
+      cached_key.index_hash != key.index_hash ||
+      cached_key.rules_hash != key.rules_hash) {
+    return false;
+  }
+
+  uint32_t count = 0;
+  if (!ReadValue(file, count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    PakCacheEntry entry;
+    uint32_t size = 0;
+    if (!ReadValue(file, entry.resource_id) ||
+        !ReadValue(file, entry.original_hash) ||
+        !ReadValue(file, entry.data_hash) || !ReadValue(file, size) ||
+        size > kMaxEntrySize || size > key.file_size) {
+      entries.clear();
+      return false;
+    }
+    entry.data.resize(size);
+    if (!file.read(reinterpret_cast<char*>(entry.data.data()), size)) {
+      entries.clear();
+      return false;
+    }
+    entries.emplace_back(std::move(entry));
+  }
+  return true;
+}
+
+bool SavePakCache(const std::filesystem::path& path,
+                  const PakCacheKey& key,
+                  const std::vector<PakCacheEntry>& entries) {
+  auto temp_path = path;
+  temp_path += ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      return false;
+    }
+
+    constexpr std::string_view kVersion = RELEASE_VER_STR;
+    file.write(kPakCacheMagic, sizeof(kPakCacheMagic));
+    WriteValue(file, kPakCacheFormat);
+    WriteValue(file, static_cast<uint32_t>(kVersion.size()));
+    file.write(kVersion.data(), kVersion.size());
+    WriteValue(file, key.file_size);
+    WriteValue(file, key.last_write_time);
+    WriteValue(file, key.index_hash);
+    WriteValue(file, key.rules_hash);
+    WriteValue(file, static_cast<uint32_t>(entries.size()));
+    for (const auto& entry : entries) {
+      WriteValue(file, entry.resource_id);
+      WriteValue(file, entry.original_hash);
+      WriteValue(file, entry.data_hash);
+      WriteValue(file, static_cast<uint32_t>(entry.data.size()));
+      file.write(reinterpret_cast<const char*>(entry.data.data()),
+                 entry.data.size());
+    }
+    if (!file.flush()) {
+      file.close();
+      std::error_code ec;
+      std::filesystem::remove(temp_path, ec);
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(temp_path, ec);
+    return false;
+  }
+  return true;
+}
+
+bool ApplyPakCache(std::span<uint8_t> pak,
+                   const std::vector<PakCacheEntry>& entries) {
+  std::vector<std::span<uint8_t>> targets;
+  targets.reserve(entries.size());
+  for (const auto& entry : entries) {
+    auto target = GetPakEntry(pak.data(), pak.size(), entry.resource_id);
+    if (target.empty() || target.size() != entry.data.size() ||
+        HashBytes(target) != entry.original_hash ||
+        HashBytes(entry.data) != entry.data_hash) {
+      return false;
+    }
+    targets.push_back(target);
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    std::memcpy(targets[i].data(), entries[i].data.data(), targets[i].size());
+  }
+  return true;
+}
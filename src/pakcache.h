@@ -0,0 +1,47 @@
+#ifndef CHROME_PLUS_SRC_PAKCACHE_H_
+#define CHROME_PLUS_SRC_PAKCACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+// Identifies the `resources.pak` a cache was built from.
+struct PakCacheKey {
+  uint64_t file_size = 0;
+  uint64_t last_write_time = 0;
+  uint64_t index_hash = 0;
+  // Hash of the patch rules the entries were built with.
+  uint64_t rules_hash = 0;
+};
+
+// A resource as it looks after patching. `original_hash` is the hash of the
+// bytes it replaces, checked before they are overwritten. `data_hash` is the
+// hash of `data`, so that a cache damaged on disk is never copied in.
+struct PakCacheEntry {
+  uint16_t resource_id = 0;
+  uint64_t original_hash = 0;
+  uint64_t data_hash = 0;
+  std::vector<uint8_t> data;
+};
+
+// Reads the cached entries stored at `path`. Returns false if there is no
+// cache or it was written for another pak file or Chrome++ version.
+bool LoadPakCache(const std::filesystem::path& path,
+                  const PakCacheKey& key,
+                  std::vector<PakCacheEntry>& entries);
+
+// Replaces the cache at `path` in one step, so that a crash never leaves a
+// truncated file behind. Returns false, keeping the old cache, on error.
+bool SavePakCache(const std::filesystem::path& path,
+                  const PakCacheKey& key,
+                  const std::vector<PakCacheEntry>& entries);
+
+// Overwrites the cached entries in the pak file held by `pak`, once all of
+// them are verified to still replace the bytes they were built from and to
+// hold the bytes they were saved with. Returns false, leaving `pak`
+// untouched, if any of them does not.
+bool ApplyPakCache(std::span<uint8_t> pak,
+                   const std::vector<PakCacheEntry>& entries);
+
+#endif  // CHROME_PLUS_SRC_PAKCACHE_H_
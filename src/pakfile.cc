@@ -1,21 +1,36 @@
 #include "pakfile.h"
 
-#include <windows.h>
-
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <ranges>
 #include <span>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#if defined(_MSC_VER)
 #pragma warning(disable : 4334)
 #pragma warning(disable : 4267)
 #pragma warning(disable : 4838)
+#endif
+
+#include "fastsearch.h"
 
 extern "C" {
-#include "..\mini_gzip\mini_gzip.h"
+// Only the declarations of the streaming API; the code lives in `mini_gzip`.
+#define MINIZ_HEADER_FILE_ONLY
+#include "../mini_gzip/miniz.c"
+#include "../mini_gzip/mini_gzip.h"
 void* gzip_compress(uint8_t* data, size_t len, size_t* out_len);
 int mini_gz_start(struct mini_gzip* gz_ptr, const void* mem, size_t mem_len);
 int mini_gz_unpack(struct mini_gzip* gz_ptr, void* mem_out, size_t mem_out_len);
@@ -50,138 +65,460 @@ struct PakAlias {
 };
 #pragma pack(pop)
 
-bool CheckHeader(uint8_t* buffer, PakEntry*& pak_entry, PakEntry*& end_entry) {
-  uint32_t version = *reinterpret_cast<uint32_t*>(buffer);
+template <typename T>
+T Load(std::span<const uint8_t> data, size_t offset) {
+  T value;
+  std::memcpy(&value, data.data() + offset, sizeof(T));
+  return value;
+}
 
-  if (version != kPack4FileVersion && version != kPack5FileVersion)
-    return false;
+// A gzip compressed resource, in entry table order.
+struct GzipEntry {
+  uint16_t resource_id;
+  size_t table_index;
+  std::span<const uint8_t> data;
+};
 
-  if (version == kPack4FileVersion) {
-    auto* pak_header = reinterpret_cast<Pak4Header*>(buffer + sizeof(uint32_t));
-    if (pak_header->encoding != 1)
-      return false;
+struct InflatedEntry {
+  size_t index = 0;
+  std::unique_ptr<uint8_t[]> data;
+  uint32_t size = 0;
+};
+
+// Upper bound for the scanning threads, including the calling one.
+constexpr unsigned kMaxScanThreads = 16;
 
-    pak_entry = reinterpret_cast<PakEntry*>(buffer + sizeof(uint32_t) +
-                                            sizeof(Pak4Header));
-    end_entry = pak_entry + pak_header->num_entries;
+// Entries are searched in chunks of this many inflated bytes.
+constexpr size_t kInflateChunkSize = 16 * 1024;
+
+std::vector<GzipEntry> CollectGzipEntries(const PakReader& reader) {
+  std::vector<GzipEntry> entries;
+  using GzipMagic = Searcher<"\x1F\x8B\x08">;
+  for (size_t i = 0; i < reader.size(); ++i) {
+    auto [resource_id, data] = reader.entry(i);
+    if (data.size() < 10 * 1024) {
+      continue;
+    }
+    if (!GzipMagic::IsPrefixOf(data.data(), data.size())) {
+      // Not a GZIP file, skipping
+      continue;
+    }
+    entries.push_back({resource_id, i, data});
   }
+  return entries;
+}
 
-  if (version == kPack5FileVersion) {
-    auto* pak_header = reinterpret_cast<Pak5Header*>(buffer + sizeof(uint32_t));
-    if (pak_header->encoding != 1)
-      return false;
+bool InflateEntry(const GzipEntry& entry, InflatedEntry& inflated) {
+  const auto& data = entry.data;
+  uint32_t original_size = Load<uint32_t>(data, data.size() - 4);
 
-    pak_entry = reinterpret_cast<PakEntry*>(buffer + sizeof(uint32_t) +
-                                            sizeof(Pak5Header));
-    end_entry = pak_entry + pak_header->resource_count;
+  auto unpack_buffer = std::make_unique_for_overwrite<uint8_t[]>(original_size);
+  if (!unpack_buffer) {
+    return false;
   }
 
-  // In order to save the "next item" of the last item,
-  // the id of this special item must be 0
-  if (!end_entry || end_entry->resource_id != 0) {
+  struct mini_gzip gz;
+  mini_gz_start(&gz, data.data(), data.size());
+  uint32_t unpack_len = mini_gz_unpack(&gz, unpack_buffer.get(), original_size);
+  if (original_size != unpack_len) {
     return false;
   }
 
+  inflated.data = std::move(unpack_buffer);
+  inflated.size = unpack_len;
   return true;
 }
 
-[[maybe_unused]] void PakFind(uint8_t* buffer,
-                              uint8_t* pos,
-                              std::function<void(uint8_t*, uint32_t)> f) {
-  PakEntry* pak_entry = nullptr;
-  PakEntry* end_entry = nullptr;
+// Inflates `entry` chunk by chunk into `window` until one of `markers` shows
+// up, so that entries without a marker never have to be inflated in full. The
+// last `overlap` bytes of a chunk are kept in front of the next one to catch
+// markers split across chunks. Returns false if there is no marker or the data
+// is corrupt.
+bool ContainsMarker(const GzipEntry& entry,
+                    std::span<const std::string_view> markers,
+                    size_t overlap,
+                    std::vector<uint8_t>& window) {
+  struct mini_gzip gz;
+  if (mini_gz_start(&gz, entry.data.data(), entry.data.size()) != 0) {
+    return false;
+  }
 
-  if (!CheckHeader(buffer, pak_entry, end_entry)) {
-    return;
+  mz_stream stream = {};
+  stream.next_in = gz.data_ptr;
+  stream.avail_in = static_cast<unsigned int>(gz.data_len);
+  if (mz_inflateInit2(&stream, -MZ_DEFAULT_WINDOW_BITS) != MZ_OK) {
+    return false;
   }
 
-  do {
-    PakEntry* next_entry = pak_entry + 1;
-    if (pos >= buffer + pak_entry->file_offset &&
-        pos <= buffer + next_entry->file_offset) {
-      f(buffer + pak_entry->file_offset,
-        next_entry->file_offset - pak_entry->file_offset);
+  window.resize(overlap + kInflateChunkSize);
+  size_t kept = 0;
+  int status = MZ_OK;
+  bool found = false;
+  while (!found && status == MZ_OK) {
+    stream.next_out = window.data() + kept;
+    stream.avail_out = static_cast<unsigned int>(kInflateChunkSize);
+    status = mz_inflate(&stream, MZ_NO_FLUSH);
+    if (status != MZ_OK && status != MZ_STREAM_END) {
       break;
     }
 
-    pak_entry = next_entry;
-  } while (pak_entry->resource_id != 0);
+    size_t size = kept + kInflateChunkSize - stream.avail_out;
+    found = std::ranges::any_of(markers, [&](std::string_view marker) {
+      return FastSearch(window.data(), static_cast<int>(size),
+                        reinterpret_cast<const uint8_t*>(marker.data()),
+                        static_cast<int>(marker.size())) != nullptr;
+    });
+
+    kept = std::min(overlap, size);
+    std::memmove(window.data(), window.data() + size - kept, kept);
+  }
+  mz_inflateEnd(&stream);
+  return found;
 }
+
+// Compresses `data` and stores it in place of `entry_data`. The gap left by a
+// smaller result is padded with the gzip FEXTRA field, whose length is 16 bits.
+// Returns false, leaving `entry_data` untouched, if the result does not fit.
+bool WriteBackEntry(std::span<uint8_t> entry_data, std::string_view data) {
+  size_t old_size = entry_data.size();
+
+  size_t compress_size = 0;
+  // `gzip_compress` is written in C style, so we free it using `std::free`
+  std::unique_ptr<void, decltype(&std::free)> compress_buffer_ptr(
+      gzip_compress(reinterpret_cast<uint8_t*>(const_cast<char*>(data.data())),
+                    data.size(), &compress_size),
+      std::free);
+
+  auto* compress_buffer = static_cast<uint8_t*>(compress_buffer_ptr.get());
+  if (!compress_buffer || compress_size < 10 || compress_size + 2 > old_size ||
+      old_size - compress_size - 2 > 0xFFFF) {
+    return false;
+  }
+
+  std::span<uint8_t> src_span(compress_buffer, compress_size);
+  std::ranges::copy(src_span.subspan(0, 10), entry_data.begin());
+  entry_data[3] = 0x04;
+  uint16_t extra_length = static_cast<uint16_t>(old_size - compress_size - 2);
+  entry_data[10] = static_cast<uint8_t>(extra_length);
+  entry_data[11] = static_cast<uint8_t>(extra_length >> 8);
+  std::ranges::fill(entry_data.subspan(12, extra_length), 0);
+  std::ranges::copy(src_span.subspan(10),
+                    entry_data.begin() + 12 + extra_length);
+  return true;
+}
+
+// Returns the entries whose inflated data contains any of `markers`, inflated
+// and in table order.
+std::vector<InflatedEntry> InflateMarkedEntries(
+    const std::vector<GzipEntry>& entries,
+    std::span<const std::string_view> markers) {
+  if (entries.empty() || markers.empty()) {
+    return {};
+  }
+
+  std::atomic<size_t> next_index = 0;
+  std::mutex matches_mutex;
+  std::vector<InflatedEntry> matches;
+
+  size_t longest_marker = 0;
+  for (const auto& marker : markers) {
+    longest_marker = std::max(longest_marker, marker.size());
+  }
+  size_t overlap = longest_marker > 0 ? longest_marker - 1 : 0;
+
+  auto scan = [&]() {
+    std::vector<uint8_t> window;
+    while (true) {
+      size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+      if (index >= entries.size()) {
+        return;
+      }
+      if (!ContainsMarker(entries[index], markers, overlap, window)) {
+        continue;
+      }
+
+      InflatedEntry inflated;
+      if (!InflateEntry(entries[index], inflated)) {
+        continue;
+      }
+      inflated.index = index;
+      std::lock_guard<std::mutex> lock(matches_mutex);
+      matches.emplace_back(std::move(inflated));
+    }
+  };
+
+  unsigned thread_count = std::clamp(std::thread::hardware_concurrency(), 1u,
+                                     kMaxScanThreads);
+  thread_count = std::min<unsigned>(thread_count,
+                                    static_cast<unsigned>(entries.size()));
+  std::vector<std::thread> workers;
+  workers.reserve(thread_count - 1);
+  for (unsigned i = 1; i < thread_count; ++i) {
+    workers.emplace_back(scan);
+  }
+  scan();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // Visiting the matches in table order keeps the result independent of
+  // thread timing.
+  std::ranges::sort(matches, {}, &InflatedEntry::index);
+  return matches;
+}
+
 }  // namespace
 
-void TraversalGZIPFile(uint8_t* buffer,
-                       std::function<bool(uint8_t*, uint32_t, size_t&)>&& f) {
-  PakEntry* pak_entry = nullptr;
-  PakEntry* end_entry = nullptr;
+PakReader::PakReader(std::span<const uint8_t> data) : data_(data) {
+  if (data.size() < sizeof(uint32_t)) {
+    return;
+  }
 
-  if (!CheckHeader(buffer, pak_entry, end_entry)) {
+  uint32_t encoding = 0;
+  size_t entry_count = 0;
+  size_t alias_count = 0;
+  size_t table_offset = 0;
+  uint32_t version = Load<uint32_t>(data, 0);
+  if (version == kPack4FileVersion) {
+    table_offset = sizeof(uint32_t) + sizeof(Pak4Header);
+    if (data.size() < table_offset) {
+      return;
+    }
+    auto header = Load<Pak4Header>(data, sizeof(uint32_t));
+    encoding = header.encoding;
+    entry_count = header.num_entries;
+  } else if (version == kPack5FileVersion) {
+    table_offset = sizeof(uint32_t) + sizeof(Pak5Header);
+    if (data.size() < table_offset) {
+      return;
+    }
+    auto header = Load<Pak5Header>(data, sizeof(uint32_t));
+    encoding = header.encoding;
+    entry_count = header.resource_count;
+    alias_count = header.alias_count;
+  } else {
     return;
   }
 
-  do {
-    PakEntry* next_entry = pak_entry + 1;
-    size_t old_size = next_entry->file_offset - pak_entry->file_offset;
+  // The entry table ends with an extra entry with id 0, whose offset is the
+  // end of the last resource.
+  size_t max_entries = (data.size() - table_offset) / sizeof(PakEntry);
+  if (entry_count >= max_entries) {
+    return;
+  }
+  size_t alias_offset = table_offset + (entry_count + 1) * sizeof(PakEntry);
+  size_t index_size = alias_offset + alias_count * sizeof(PakAlias);
+  if (index_size > data.size()) {
+    return;
+  }
+  auto sentinel =
+      Load<PakEntry>(data, table_offset + entry_count * sizeof(PakEntry));
+  if (sentinel.resource_id != 0) {
+    return;
+  }
 
-    if (old_size < 10 * 1024) {
-      pak_entry = next_entry;
-      continue;
+  // Resources are stored back to back after the index, in table order.
+  size_t previous_offset = index_size;
+  for (size_t i = 0; i <= entry_count; ++i) {
+    auto pak_entry = Load<PakEntry>(data, table_offset + i * sizeof(PakEntry));
+    if (pak_entry.file_offset < previous_offset ||
+        pak_entry.file_offset > data.size()) {
+      return;
     }
+    previous_offset = pak_entry.file_offset;
+    if (i > 0 && i < entry_count &&
+        pak_entry.resource_id <=
+            Load<PakEntry>(data, table_offset + (i - 1) * sizeof(PakEntry))
+                .resource_id) {
+      sorted_ = false;
+    }
+  }
+  for (size_t i = 0; i < alias_count; ++i) {
+    auto alias = Load<PakAlias>(data, alias_offset + i * sizeof(PakAlias));
+    if (alias.entry_index >= entry_count) {
+      return;
+    }
+    if (i > 0 &&
+        alias.resource_id <=
+            Load<PakAlias>(data, alias_offset + (i - 1) * sizeof(PakAlias))
+                .resource_id) {
+      sorted_ = false;
+    }
+  }
 
-    constexpr uint8_t kGzipMagic[] = {0x1F, 0x8B, 0x08};
-    std::span<uint8_t> entry_data(buffer + pak_entry->file_offset, old_size);
-    if (entry_data.size() < sizeof(kGzipMagic) ||
-        !std::ranges::equal(entry_data.subspan(0, sizeof(kGzipMagic)),
-                            kGzipMagic)) {
-      // Not a GZIP file, skipping
-      pak_entry = next_entry;
-      continue;
+  valid_ = true;
+  encoding_ = encoding;
+  entry_count_ = entry_count;
+  alias_count_ = alias_count;
+  table_offset_ = table_offset;
+  alias_offset_ = alias_offset;
+  index_size_ = index_size;
+}
+
+PakReader::Entry PakReader::entry(size_t index) const {
+  size_t offset = table_offset_ + index * sizeof(PakEntry);
+  auto pak_entry = Load<PakEntry>(data_, offset);
+  auto next_entry = Load<PakEntry>(data_, offset + sizeof(PakEntry));
+  return {pak_entry.resource_id,
+          data_.subspan(pak_entry.file_offset,
+                        next_entry.file_offset - pak_entry.file_offset)};
+}
+
+std::optional<PakReader::Entry> PakReader::Find(uint16_t resource_id) const {
+  if (auto index = FindEntryIndex(resource_id)) {
+    return entry(*index);
+  }
+
+  auto alias_at = [this](size_t i) {
+    return Load<PakAlias>(data_, alias_offset_ + i * sizeof(PakAlias));
+  };
+  auto aliases = std::views::iota(size_t{0}, alias_count_);
+  if (sorted_) {
+    auto id_at = [&](size_t i) { return alias_at(i).resource_id; };
+    auto it = std::ranges::lower_bound(aliases, resource_id, {}, id_at);
+    if (it != aliases.end() && alias_at(*it).resource_id == resource_id) {
+      return entry(alias_at(*it).entry_index);
     }
+    return std::nullopt;
+  }
+  for (size_t i : aliases) {
+    if (alias_at(i).resource_id == resource_id) {
+      return entry(alias_at(i).entry_index);
+    }
+  }
+  return std::nullopt;
+}
 
-    uint32_t original_size =
-        *reinterpret_cast<uint32_t*>(buffer + next_entry->file_offset - 4);
+std::optional<size_t> PakReader::FindEntryIndex(uint16_t resource_id) const {
+  auto id_at = [this](size_t i) {
+    return Load<PakEntry>(data_, table_offset_ + i * sizeof(PakEntry))
+        .resource_id;
+  };
+  auto indices = std::views::iota(size_t{0}, entry_count_);
+  if (sorted_) {
+    auto it = std::ranges::lower_bound(indices, resource_id, {}, id_at);
+    if (it != indices.end() && id_at(*it) == resource_id) {
+      return *it;
+    }
+    return std::nullopt;
+  }
+  for (size_t i : indices) {
+    if (id_at(i) == resource_id) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
 
-    auto unpack_buffer =
-        std::make_unique_for_overwrite<uint8_t[]>(original_size);
+void TraversalGZIPFile(
+    uint8_t* buffer,
+    size_t size,
+    std::span<const std::string_view> markers,
+    std::function<void(uint16_t,
+                       std::string_view,
+                       const std::function<bool(std::string_view)>&)>&& f) {
+  PakReader reader({buffer, size});
+  if (markers.empty() || !reader.IsValid() || reader.encoding() != 1) {
+    return;
+  }
+  const std::vector<GzipEntry> entries = CollectGzipEntries(reader);
+  const std::vector<InflatedEntry> matches =
+      InflateMarkedEntries(entries, markers);
+  for (const auto& match : matches) {
+    const GzipEntry& entry = entries[match.index];
+    std::span<uint8_t> entry_data(buffer + reader.OffsetOf(entry.data),
+                                  entry.data.size());
+    f(entry.resource_id,
+      {reinterpret_cast<const char*>(match.data.get()), match.size},
+      [entry_data](std::string_view patched) {
+        return WriteBackEntry(entry_data, patched);
+      });
+  }
+}
 
-    if (!unpack_buffer) {
-      pak_entry = next_entry;
+bool RebuildGZIPFile(
+    std::span<const uint8_t> pak,
+    std::span<const std::string_view> markers,
+    std::function<bool(uint16_t, std::string_view, std::string&)>&& f,
+    std::vector<uint8_t>& output) {
+  PakReader reader(pak);
+  if (!reader.IsValid() || reader.encoding() != 1) {
+    return false;
+  }
+  const std::vector<GzipEntry> entries = CollectGzipEntries(reader);
+  const std::vector<InflatedEntry> matches =
+      InflateMarkedEntries(entries, markers);
+
+  // Recompressed data, by index in the entry table.
+  std::map<size_t, std::vector<uint8_t>> replacements;
+  for (const auto& match : matches) {
+    const GzipEntry& entry = entries[match.index];
+    std::string patched;
+    if (!f(entry.resource_id,
+           {reinterpret_cast<const char*>(match.data.get()), match.size},
+           patched)) {
       continue;
     }
 
-    struct mini_gzip gz;
-    mini_gz_start(&gz, buffer + pak_entry->file_offset, old_size);
-    uint32_t unpack_len =
-        mini_gz_unpack(&gz, unpack_buffer.get(), original_size);
-
-    if (original_size == unpack_len) {
-      size_t new_len = old_size;
-      bool changed = f(unpack_buffer.get(), unpack_len, new_len);
-
-      if (changed) {
-        size_t compress_size = 0;
-        // `gzip_compress` is written in C style, so we free it using
-        // `std::free`
-        std::unique_ptr<void, decltype(&std::free)> compress_buffer_ptr(
-            gzip_compress(unpack_buffer.get(), new_len, &compress_size),
-            std::free);
-
-        auto* compress_buffer =
-            static_cast<uint8_t*>(compress_buffer_ptr.get());
-
-        if (compress_buffer && compress_size < old_size) {
-          std::span<uint8_t> src_span(compress_buffer, compress_size);
-          std::ranges::copy(src_span.subspan(0, 10), entry_data.begin());
-          entry_data[3] = 0x04;
-          uint16_t extra_length =
-              static_cast<uint16_t>(old_size - compress_size - 2);
-          auto extra_len_dest = reinterpret_cast<uint16_t*>(&entry_data[10]);
-          *extra_len_dest = extra_length;
-          std::ranges::fill(entry_data.subspan(12, extra_length), 0);
-          std::ranges::copy(src_span.subspan(10),
-                            entry_data.begin() + 12 + extra_length);
-        }
-      }
+    size_t compress_size = 0;
+    // `gzip_compress` is written in C style, so we free it using `std::free`
+    std::unique_ptr<void, decltype(&std::free)> compress_buffer_ptr(
+        gzip_compress(reinterpret_cast<uint8_t*>(patched.data()),
+                      patched.size(), &compress_size),
+        std::free);
+    if (!compress_buffer_ptr) {
+      return false;
     }
-    pak_entry = next_entry;
-  } while (pak_entry->resource_id != 0);
+    auto* compress_buffer = static_cast<uint8_t*>(compress_buffer_ptr.get());
+    replacements[entry.table_index].assign(compress_buffer,
+                                           compress_buffer + compress_size);
+  }
+
+  // The index is copied as is, including the aliases, which refer to entries
+  // by position. Only the offsets change.
+  auto index = reader.index();
+  output.assign(index.begin(), index.end());
+  auto write_offset = [&](size_t i) {
+    if (output.size() > std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+    auto offset = static_cast<uint32_t>(output.size());
+    std::memcpy(output.data() + reader.table_offset() + i * sizeof(PakEntry) +
+                    offsetof(PakEntry, file_offset),
+                &offset, sizeof(offset));
+    return true;
+  };
+  for (size_t i = 0; i < reader.size(); ++i) {
+    if (!write_offset(i)) {
+      return false;
+    }
+    auto replacement = replacements.find(i);
+    std::span<const uint8_t> data = replacement != replacements.end()
+                                        ? std::span(replacement->second)
+                                        : reader.entry(i).data;
+    output.insert(output.end(), data.begin(), data.end());
+  }
+  return write_offset(reader.size());
+}
+
+std::span<const uint8_t> GetPakIndex(const uint8_t* buffer, size_t size) {
+  if (!buffer) {
+    return {};
+  }
+  PakReader reader({buffer, size});
+  return reader.IsValid() ? reader.index() : std::span<const uint8_t>();
+}
+
+std::span<uint8_t> GetPakEntry(uint8_t* buffer,
+                               size_t size,
+                               uint16_t resource_id) {
+  if (!buffer) {
+    return {};
+  }
+  PakReader reader({buffer, size});
+  auto entry = reader.Find(resource_id);
+  if (!entry) {
+    return {};
+  }
+  return {buffer + reader.OffsetOf(entry->data), entry->data.size()};
 }
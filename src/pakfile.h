@@ -1,9 +1,107 @@
 ﻿#ifndef CHROME_PLUS_SRC_PAKFILE_H_
 #define CHROME_PLUS_SRC_PAKFILE_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
-void TraversalGZIPFile(uint8_t* buffer,
-                       std::function<bool(uint8_t*, uint32_t, size_t&)>&& f);
+// Read-only view of a version 4 or 5 pak file. The header, entry table and
+// alias table are validated against the size of the view once, so a
+// truncated or corrupt file yields an invalid reader instead of reads past the
+// end.
+class PakReader {
+ public:
+  struct Entry {
+    uint16_t resource_id = 0;
+    std::span<const uint8_t> data;
+  };
+
+  explicit PakReader(std::span<const uint8_t> data);
+
+  bool IsValid() const { return valid_; }
+
+  // 1 for UTF-8, which is what `resources.pak` uses.
+  uint32_t encoding() const { return encoding_; }
+
+  // The header, entry table and alias table.
+  std::span<const uint8_t> index() const { return data_.first(index_size_); }
+
+  // Offset of the entry table from the start of the file.
+  size_t table_offset() const { return table_offset_; }
+
+  size_t size() const { return entry_count_; }
+
+  // The entry at `index` in table order. `index` must be less than `size()`.
+  Entry entry(size_t index) const;
+
+  // All entries in table order, without copying their data.
+  auto entries() const {
+    return std::views::iota(size_t{0}, entry_count_) |
+           std::views::transform([this](size_t i) { return entry(i); });
+  }
+
+  // Looks `resource_id` up in the sorted entry table, then in the aliases.
+  std::optional<Entry> Find(uint16_t resource_id) const;
+
+  // Offset of `data`, which must come from this reader, from the start of the
+  // file.
+  size_t OffsetOf(std::span<const uint8_t> data) const {
+    return static_cast<size_t>(data.data() - data_.data());
+  }
+
+ private:
+  std::optional<size_t> FindEntryIndex(uint16_t resource_id) const;
+
+  std::span<const uint8_t> data_;
+  bool valid_ = false;
+  bool sorted_ = true;
+  uint32_t encoding_ = 0;
+  size_t entry_count_ = 0;
+  size_t alias_count_ = 0;
+  size_t table_offset_ = 0;
+  size_t alias_offset_ = 0;
+  size_t index_size_ = 0;
+};
+
+// Calls `f(resource_id, data, write_back)` for every gzip entry whose inflated
+// data contains any of `markers`, in table order. Entries are inflated on
+// several threads, but `f` always runs on the calling thread.
+// `write_back(patched)` compresses `patched` and writes it in place of the
+// entry. It returns false and leaves the entry untouched if the result does
+// not fit, so `f` may try again with a smaller `patched`.
+void TraversalGZIPFile(
+    uint8_t* buffer,
+    size_t size,
+    std::span<const std::string_view> markers,
+    std::function<void(uint16_t,
+                       std::string_view,
+                       const std::function<bool(std::string_view)>&)>&& f);
+
+// Like `TraversalGZIPFile`, but writes a patched copy of `pak` to `output`
+// instead of patching in place. `f(resource_id, data, patched)` returns true
+// to replace an entry with `patched`. Since the offset table is rewritten, the
+// recompressed entry may be larger than the original. Returns false if `pak`
+// is not a valid pak file or the result does not fit in 32-bit offsets.
+bool RebuildGZIPFile(
+    std::span<const uint8_t> pak,
+    std::span<const std::string_view> markers,
+    std::function<bool(uint16_t, std::string_view, std::string&)>&& f,
+    std::vector<uint8_t>& output);
+
+// Returns the header and entry table of the pak file, or an empty span if
+// `buffer` does not hold a complete one.
+std::span<const uint8_t> GetPakIndex(const uint8_t* buffer, size_t size);
+
+// Returns the raw bytes of the resource `resource_id`, or an empty span if it
+// does not exist or lies outside of `size`.
+std::span<uint8_t> GetPakEntry(uint8_t* buffer,
+                               size_t size,
+                               uint16_t resource_id);
 
 #endif  // CHROME_PLUS_SRC_PAKFILE_H_
@@ -2,17 +2,27 @@
 
 #include <windows.h>
 
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "detours.h"
 
+#include "config.h"
+#include "hash.h"
+#include "pakcache.h"
 #include "pakfile.h"
+#include "pakrules.h"
 #include "utils.h"
-#include "version.h"
 
 namespace {
 
-static DWORD resources_pak_size = 0;
+static uint64_t resources_pak_size = 0;
+static uint64_t resources_pak_write_time = 0;
 static HANDLE resources_pak_map = nullptr;
 static HANDLE resources_pak_file = nullptr;
 
@@ -20,6 +30,104 @@ static auto RawCreateFile = CreateFileW;
 static auto RawCreateFileMapping = CreateFileMappingW;
 static auto RawMapViewOfFile = MapViewOfFile;
 
+// The about page rules come first, followed by the rules from the
+// `[pak_patch]` section of the ini file.
+const PakPatcher& GetPakPatcher() {
+  // The hooks may run on any thread.
+  static const PakPatcher patcher = [] {
+    ConfigReadScope config_scope;
+    std::vector<PakPatchRule> rules = GetAboutPagePatchRules();
+    const auto& extra_rules = config->GetPakPatchRules();
+    rules.insert(rules.end(), extra_rules.begin(), extra_rules.end());
+    return PakPatcher(std::move(rules));
+  }();
+  return patcher;
+}
+
+std::filesystem::path GetPakCachePath() {
+  std::filesystem::path path = GetAppDir();
+  path /= L"chrome++.pakcache";
+  return path;
+}
+
+uint64_t HashRules(const std::vector<PakPatchRule>& rules) {
+  std::string text;
+  for (const auto& rule : rules) {
+    for (const auto* field : {&rule.marker, &rule.search, &rule.replace}) {
+      text += *field;
+      text += '\0';
+    }
+  }
+  return HashBytes(
+      {reinterpret_cast<const uint8_t*>(text.data()), text.size()});
+}
+
+// Applies the patch rules to an inflated resource and writes the result back.
+// Returns false if none of them matched or the result does not fit even after
+// minifying it.
+bool PatchResource(
+    std::string_view data,
+    const std::function<bool(std::string_view)>& write_back) {
+  std::string html;
+  if (!GetPakPatcher().Apply(data, html)) {
+    return false;
+  }
+  if (write_back(html)) {
+    return true;
+  }
+
+  // Compress the HTML to make room for the patch information.
+  compression_html(html);
+  return write_back(html);
+}
+
+void PatchResources(uint8_t* buffer) {
+  auto index = GetPakIndex(buffer, resources_pak_size);
+  if (index.empty()) {
+    return;
+  }
+
+  // A warm start only checks the recorded entries and copies them over, so
+  // nothing has to be inflated.
+  const PakPatcher& patcher = GetPakPatcher();
+  PakCacheKey key = {resources_pak_size, resources_pak_write_time,
+                     HashBytes(index), HashRules(patcher.rules())};
+  std::vector<PakCacheEntry> entries;
+  const auto cache_path = GetPakCachePath();
+  if (LoadPakCache(cache_path, key, entries) &&
+      ApplyPakCache(std::span(buffer, resources_pak_size), entries)) {
+    return;
+  }
+
+  entries.clear();
+  TraversalGZIPFile(
+      buffer, resources_pak_size, patcher.markers(),
+      [&](uint16_t resource_id, std::string_view data,
+          const std::function<bool(std::string_view)>& write_back) {
+        auto original = GetPakEntry(buffer, resources_pak_size, resource_id);
+        if (original.empty()) {
+          return;
+        }
+        // Hashed before `write_back` overwrites the original bytes.
+        uint64_t original_hash = HashBytes(original);
+        if (!PatchResource(data, write_back)) {
+          return;
+        }
+        // Only entries that were written are cached, so a warm start never
+        // copies unpatched bytes over as if they were patched.
+        entries.push_back({resource_id, original_hash, 0, {}});
+      });
+
+  for (auto& entry : entries) {
+    auto patched = GetPakEntry(buffer, resources_pak_size, entry.resource_id);
+    entry.data.assign(patched.begin(), patched.end());
+    entry.data_hash = HashBytes(entry.data);
+  }
+  if (!SavePakCache(cache_path, key, entries)) {
+    DebugLog(L"SavePakCache failed: {}", cache_path.wstring());
+  }
+}
+
 HANDLE WINAPI MyMapViewOfFile(_In_ HANDLE hFileMappingObject,
                               _In_ DWORD dwDesiredAccess,
                               _In_ DWORD dwFileOffsetHigh,
@@ -43,48 +151,7 @@ HANDLE WINAPI MyMapViewOfFile(_In_ HANDLE hFileMappingObject,
     }
 
     if (buffer) {
-      // Traverse the gzip file.
-      TraversalGZIPFile(static_cast<BYTE*>(buffer), [=](uint8_t* begin,
-                                                        uint32_t size,
-                                                        size_t& new_len) {
-        bool changed = false;
-
-        BYTE search_start[] = R"(</settings-about-page>)";
-        uint8_t* pos =
-            memmem(begin, size, search_start, sizeof(search_start) - 1);
-        if (pos) {
-          // Compress the HTML for writing patch information.
-          std::string html(reinterpret_cast<char*>(begin), size);
-          compression_html(html);
-
-          // RemoveUpdateError
-          // if (IsNeedPortable())
-          {
-            ReplaceStringInPlace(html, R"(hidden="[[!showUpdateStatus_]]")",
-                                 R"(hidden="true")");
-            ReplaceStringInPlace(
-                html, R"(hidden="[[!shouldShowIcons_(showUpdateStatus_)]]")",
-                R"(hidden="true")");
-          }
-
-          const char prouct_title[] =
-              R"({aboutBrowserVersion}</div><div class="secondary"><a target="_blank" href="https://github.com/Bush2021/chrome_plus">Chrome++</a> )" RELEASE_VER_STR
-              R"( modified version</div>)";
-          ReplaceStringInPlace(html, R"({aboutBrowserVersion}</div>)",
-                               prouct_title);
-
-          if (html.length() <= size) {
-            // Write modifications.
-            memcpy(begin, html.c_str(), html.length());
-
-            // Modify length.
-            new_len = static_cast<uint32_t>(html.length());
-            changed = true;
-          }
-        }
-
-        return changed;
-      });
+      PatchResources(static_cast<uint8_t*>(buffer));
     }
 
     return buffer;
@@ -145,7 +212,15 @@ HANDLE WINAPI MyCreateFile(_In_ LPCTSTR lpFileName,
 
   if (std::wstring(lpFileName).ends_with(L"resources.pak")) {
     resources_pak_file = file;
-    resources_pak_size = GetFileSize(resources_pak_file, nullptr);
+    LARGE_INTEGER file_size;
+    FILETIME write_time;
+    if (GetFileSizeEx(file, &file_size) &&
+        GetFileTime(file, nullptr, nullptr, &write_time)) {
+      resources_pak_size = static_cast<uint64_t>(file_size.QuadPart);
+      resources_pak_write_time =
+          (static_cast<uint64_t>(write_time.dwHighDateTime) << 32) |
+          write_time.dwLowDateTime;
+    }
 
     DetourTransactionBegin();
     DetourUpdateThread(GetCurrentThread());
@@ -173,6 +248,11 @@ HANDLE WINAPI MyCreateFile(_In_ LPCTSTR lpFileName,
 }  // namespace
 
 void PakPatch() {
+  // A pak that was patched ahead of time with pak_tool needs no hooks.
+  if (!config->IsPakPatch()) {
+    return;
+  }
+
   DetourTransactionBegin();
   DetourUpdateThread(GetCurrentThread());
   DetourAttach(reinterpret_cast<LPVOID*>(&RawCreateFile),
@@ -0,0 +1,181 @@
+#include "pakrules.h"
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "version.h"
+
+namespace {
+
+constexpr std::string_view kAboutPageMarker = "</settings-about-page>";
+
+void SkipBlanks(std::string_view& value) {
+  size_t blanks = value.find_first_not_of(" \t");
+  value.remove_prefix(blanks == std::string_view::npos ? value.size() : blanks);
+}
+
+// Reads one quoted field from the front of `value` and removes it, along with
+// the comma that follows.
+std::optional<std::string> ConsumeQuotedField(std::string_view& value) {
+  SkipBlanks(value);
+  if (value.empty() || value.front() != '"') {
+    return std::nullopt;
+  }
+  std::string field;
+  size_t i = 1;
+  while (true) {
+    if (i >= value.size()) {
+      return std::nullopt;
+    }
+    if (value[i] != '"') {
+      field += value[i++];
+      continue;
+    }
+    if (i + 1 < value.size() && value[i + 1] == '"') {
+      field += '"';
+      i += 2;
+      continue;
+    }
+    ++i;
+    break;
+  }
+
+  value.remove_prefix(i);
+  SkipBlanks(value);
+  if (!value.empty() && value.front() == ',') {
+    value.remove_prefix(1);
+  }
+  return field;
+}
+
+// Compression html.
+std::string& ltrim(std::string& s) {
+  auto it = std::ranges::find_if_not(
+      s, [](unsigned char c) { return std::isspace(c); });
+  s.erase(s.begin(), it);
+  return s;
+}
+
+std::string& rtrim(std::string& s) {
+  auto reversed_view = s | std::views::reverse;
+  auto it = std::ranges::find_if_not(
+      reversed_view, [](unsigned char c) { return std::isspace(c); });
+  s.erase(it.base(), s.end());
+  return s;
+}
+
+std::string& trim(std::string& s) {
+  return ltrim(rtrim(s));
+}
+
+}  // namespace
+
+std::vector<PakPatchRule> GetAboutPagePatchRules() {
+  const std::string marker(kAboutPageMarker);
+  return {
+      // RemoveUpdateError
+      {marker, R"(hidden="[[!showUpdateStatus_]]")", R"(hidden="true")"},
+      {marker, R"(hidden="[[!shouldShowIcons_(showUpdateStatus_)]]")",
+       R"(hidden="true")"},
+      {marker, R"({aboutBrowserVersion}</div>)",
+       R"({aboutBrowserVersion}</div><div class="secondary"><a target="_blank" href="https://github.com/Bush2021/chrome_plus">Chrome++</a> )" RELEASE_VER_STR
+       R"( modified version</div>)"},
+  };
+}
+
+std::optional<PakPatchRule> ParsePakPatchRule(std::string_view value) {
+  auto marker = ConsumeQuotedField(value);
+  auto search = marker ? ConsumeQuotedField(value) : std::nullopt;
+  auto replace = search ? ConsumeQuotedField(value) : std::nullopt;
+  if (!replace || !value.empty() || marker->empty() || search->empty()) {
+    return std::nullopt;
+  }
+  return PakPatchRule{std::move(*marker), std::move(*search),
+                      std::move(*replace)};
+}
+
+PakPatcher::PakPatcher(std::vector<PakPatchRule> rules)
+    : rules_(std::move(rules)) {
+  std::erase_if(rules_, [](const PakPatchRule& rule) {
+    return rule.marker.empty() || rule.search.empty();
+  });
+
+  for (const auto& rule : rules_) {
+    auto it = std::ranges::find(markers_, rule.marker);
+    rule_markers_.push_back(it - markers_.begin());
+    if (it == markers_.end()) {
+      markers_.push_back(rule.marker);
+    }
+  }
+  for (auto marker : markers_) {
+    matcher_.Add(marker);
+  }
+  for (const auto& rule : rules_) {
+    matcher_.Add(rule.search);
+  }
+  matcher_.Build();
+}
+
+bool PakPatcher::Apply(std::string_view input, std::string& output) const {
+  if (rules_.empty()) {
+    return false;
+  }
+
+  struct Replacement {
+    size_t begin;
+    size_t rule;
+  };
+  std::vector<bool> has_marker(markers_.size());
+  std::vector<Replacement> replacements;
+  matcher_.Match(input, [&](size_t id, size_t end) {
+    if (id < markers_.size()) {
+      has_marker[id] = true;
+    } else {
+      replacements.push_back({end - matcher_.length(id), id - markers_.size()});
+    }
+  });
+
+  // Whether a rule applies is only known once the whole input was scanned.
+  std::erase_if(replacements, [&](const Replacement& replacement) {
+    return !has_marker[rule_markers_[replacement.rule]];
+  });
+  if (replacements.empty()) {
+    return false;
+  }
+  std::ranges::sort(replacements, [](const auto& a, const auto& b) {
+    return std::pair(a.begin, a.rule) < std::pair(b.begin, b.rule);
+  });
+
+  std::string result;
+  result.reserve(input.size());
+  size_t pos = 0;
+  for (const auto& [begin, rule] : replacements) {
+    if (begin < pos) {
+      continue;
+    }
+    const PakPatchRule& patch = rules_[rule];
+    result.append(input.substr(pos, begin - pos));
+    result.append(patch.replace);
+    pos = begin + patch.search.size();
+  }
+  result.append(input.substr(pos));
+  output = std::move(result);
+  return true;
+}
+
+void compression_html(std::string& html) {
+  std::string compressed;
+  compressed.reserve(html.size());
+  for (auto part : std::views::split(html, '\n')) {
+    std::string line(part.begin(), part.end());
+    compressed += "\n";
+    compressed += trim(line);
+  }
+  html = std::move(compressed);
+}
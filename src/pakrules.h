@@ -0,0 +1,59 @@
+#ifndef CHROME_PLUS_SRC_PAKRULES_H_
+#define CHROME_PLUS_SRC_PAKRULES_H_
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ahocorasick.h"
+
+// Replaces `search` with `replace` in every resource that contains `marker`.
+struct PakPatchRule {
+  std::string marker;
+  std::string search;
+  std::string replace;
+};
+
+// The built-in rules, which hide the update status on the about page and show
+// the Chrome++ version there.
+std::vector<PakPatchRule> GetAboutPagePatchRules();
+
+// Parses a `[pak_patch]` value of the form `"marker","search","replace"`. A
+// quote inside a field is written twice, as in CSV.
+std::optional<PakPatchRule> ParsePakPatchRule(std::string_view value);
+
+// Applies a set of rules to a resource with one scan for all markers and
+// search strings, followed by one pass that writes the output.
+class PakPatcher {
+ public:
+  explicit PakPatcher(std::vector<PakPatchRule> rules);
+  PakPatcher(const PakPatcher&) = delete;
+  PakPatcher& operator=(const PakPatcher&) = delete;
+
+  const std::vector<PakPatchRule>& rules() const { return rules_; }
+
+  // The distinct markers of all rules, in the order they first appear.
+  std::span<const std::string_view> markers() const { return markers_; }
+
+  // Writes `input` to `output` with the replacements of every rule whose
+  // marker occurs in `input`. Where matches overlap, the leftmost one wins,
+  // then the rule listed first. Replacements never see each other's output.
+  // Returns false, leaving `output` untouched, if nothing was replaced.
+  bool Apply(std::string_view input, std::string& output) const;
+
+ private:
+  std::vector<PakPatchRule> rules_;
+  std::vector<std::string_view> markers_;
+  // Index into `markers_` for each rule.
+  std::vector<size_t> rule_markers_;
+  // Pattern ids below `markers_.size()` are markers, the rest are the search
+  // strings of `rules_` in order.
+  AhoCorasick<char> matcher_;
+};
+
+// HTML compression functions
+void compression_html(std::string& html);
+
+#endif  // CHROME_PLUS_SRC_PAKRULES_H_
@@ -208,12 +208,12 @@ void InjectConfigPaths(std::vector<std::wstring>& args,
                        bool has_user_data_dir,
                        bool has_disk_cache_dir) {
   if (!has_user_data_dir) {
-    if (auto userdata = config.GetUserDataDir(); !userdata.empty()) {
+    if (auto userdata = config->GetUserDataDir(); !userdata.empty()) {
       args.emplace_back(L"--user-data-dir=" + userdata);
     }
   }
   if (!has_disk_cache_dir) {
-    if (auto diskcache = config.GetDiskCacheDir(); !diskcache.empty()) {
+    if (auto diskcache = config->GetDiskCacheDir(); !diskcache.empty()) {
       args.emplace_back(L"--disk-cache-dir=" + diskcache);
     }
   }
@@ -250,7 +250,7 @@ std::wstring GetCommand(LPWSTR param) {
   auto args = ParseCommandLineArgs(command_line);
   auto [main_args, trailing_args] = SeparateSentinelArgs(std::move(args));
 
-  const auto& config_args = config.GetCommandLine();
+  const auto& config_args = config->GetCommandLine();
   DebugLog(L"config_args: {}", config_args);
   auto parsed_config_args = ParseConfiguredArgs(config_args);
   main_args.insert(main_args.end(), parsed_config_args.begin(),
@@ -0,0 +1,195 @@
+#ifndef CHROME_PLUS_SRC_SNAPSHOT_H_
+#define CHROME_PLUS_SRC_SNAPSHOT_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Publishes immutable snapshots of a `T` from one writer thread to any number
+// of reader threads, RCU style.
+//
+// Snapshots are reclaimed with epochs. A reader stores the global epoch in its
+// slot when it pins a snapshot and clears it when it unpins. A snapshot
+// replaced while the global epoch was `e` can only be held by readers that
+// pinned at `e` or before, so it is freed once every busy slot is past `e`.
+// Readers never wait for the writer; the writer never waits for readers
+// either, it just tries again later.
+//
+// A thread claims a slot on its first pin and releases it when it exits. A
+// thread that finds no free slot, or reads without a pin, gets the latest
+// snapshot unpinned. Once the writer has started, a read like that keeps every
+// retired snapshot alive for good, since there is no telling which one it is
+// still using.
+//
+// A thread may only use one store at a time.
+template <typename T>
+class SnapshotStore {
+ public:
+  static constexpr size_t kMaxReaders = 64;
+
+  // Takes ownership of `initial`.
+  explicit SnapshotStore(const T* initial) : current_(initial) {}
+
+  // Every other thread that pinned a snapshot must have exited, since their
+  // slots are released when they do.
+  ~SnapshotStore() {
+    ReaderState& state = reader_state;
+    if (state.store == this) {
+      state = {};
+    }
+    for (const auto& retired : retired_) {
+      delete retired.snapshot;
+    }
+    delete current_.load();
+  }
+
+  SnapshotStore(const SnapshotStore&) = delete;
+  SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+  // Pins the current snapshot for the calling thread until the matching
+  // `Unpin`. Nested pins share the outermost one. Never blocks.
+  void Pin() {
+    ReaderState& state = reader_state;
+    if (state.store != this) {
+      state = {};
+      state.store = this;
+    }
+    if (state.depth++ > 0) {
+      return;
+    }
+    if (!state.slot) {
+      state.slot = ClaimSlot();
+    }
+    if (!state.slot) {
+      state.pinned = LoadUnpinned();
+      return;
+    }
+    state.slot->epoch.store(epoch_.load());
+    state.pinned = current_.load();
+  }
+
+  void Unpin() {
+    ReaderState& state = reader_state;
+    if (--state.depth > 0) {
+      return;
+    }
+    state.pinned = nullptr;
+    if (state.slot) {
+      state.slot->epoch.store(0, std::memory_order_release);
+    }
+  }
+
+  // The snapshot pinned by the calling thread, or the latest one outside of a
+  // pin.
+  const T& Current() {
+    const ReaderState& state = reader_state;
+    if (state.store == this && state.pinned) {
+      return *state.pinned;
+    }
+    return *LoadUnpinned();
+  }
+
+  // Whether a read without a pin was seen since the writer started.
+  bool HasUnpinnedReads() const { return unpinned_reads_.load(); }
+
+  // The rest is for the writer thread only.
+
+  // Called once before the first `Publish`. Unpinned reads before this point
+  // are harmless, since nothing can have been retired yet.
+  void StartWriter() { writing_.store(true); }
+
+  // Replaces the current snapshot with `snapshot`, taking ownership of it.
+  void Publish(const T* snapshot) {
+    const T* old = current_.exchange(snapshot);
+    retired_.push_back({old, epoch_.fetch_add(1)});
+    Reclaim();
+  }
+
+  // Frees the retired snapshots no reader can still be using.
+  void Reclaim() {
+    if (retired_.empty() || unpinned_reads_.load()) {
+      return;
+    }
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (const auto& slot : readers_) {
+      uint64_t epoch = slot.epoch.load();
+      if (epoch != 0) {
+        oldest = std::min(oldest, epoch);
+      }
+    }
+    std::erase_if(retired_, [oldest](const Retired& retired) {
+      if (retired.epoch >= oldest) {
+        return false;
+      }
+      delete retired.snapshot;
+      return true;
+    });
+  }
+
+  size_t retired_count() const { return retired_.size(); }
+
+ private:
+  struct alignas(64) ReaderSlot {
+    std::atomic<bool> claimed = false;
+    // The epoch the owner pinned at, 0 outside of a pin.
+    std::atomic<uint64_t> epoch = 0;
+  };
+
+  struct Retired {
+    const T* snapshot;
+    uint64_t epoch;
+  };
+
+  struct ReaderState {
+    ~ReaderState() {
+      if (slot) {
+        slot->epoch.store(0, std::memory_order_relaxed);
+        slot->claimed.store(false, std::memory_order_release);
+      }
+    }
+
+    SnapshotStore* store = nullptr;
+    ReaderSlot* slot = nullptr;
+    const T* pinned = nullptr;
+    int depth = 0;
+  };
+
+  ReaderSlot* ClaimSlot() {
+    for (auto& slot : readers_) {
+      if (!slot.claimed.load(std::memory_order_relaxed) &&
+          !slot.claimed.exchange(true)) {
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  // The flag is raised before the pointer is loaded, so a writer that finds it
+  // clear after replacing a snapshot knows no unpinned reader got the old one.
+  const T* LoadUnpinned() {
+    if (writing_.load() && !unpinned_reads_.load(std::memory_order_relaxed)) {
+      unpinned_reads_.store(true);
+    }
+    return current_.load();
+  }
+
+  static thread_local ReaderState reader_state;
+
+  std::atomic<const T*> current_;
+  std::atomic<uint64_t> epoch_ = 1;
+  std::array<ReaderSlot, kMaxReaders> readers_;
+  std::atomic<bool> unpinned_reads_ = false;
+  std::atomic<bool> writing_ = false;
+  // Only touched by the writer thread.
+  std::vector<Retired> retired_;
+};
+
+template <typename T>
+thread_local typename SnapshotStore<T>::ReaderState
+    SnapshotStore<T>::reader_state;
+
+#endif  // CHROME_PLUS_SRC_SNAPSHOT_H_
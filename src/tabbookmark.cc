@@ -1,222 +1,118 @@
 #include "tabbookmark.h"
 
 #include <windows.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "commandqueue.h"
 #include "config.h"
+#include "hookstats.h"
 #include "hotkey.h"
 #include "iaccessible.h"
+#include "tabhooks.h"
+#include "uitask.h"
 #include "utils.h"
 
 namespace {
 
+static_assert(kWmNcMouseMove == WM_NCMOUSEMOVE);
+static_assert(kWmKeyDown == WM_KEYDOWN);
+static_assert(kWmKeyUp == WM_KEYUP);
+static_assert(kWmMouseMove == WM_MOUSEMOVE);
+static_assert(kWmLButtonDown == WM_LBUTTONDOWN);
+static_assert(kWmLButtonUp == WM_LBUTTONUP);
+static_assert(kWmLButtonDblClk == WM_LBUTTONDBLCLK);
+static_assert(kWmRButtonDown == WM_RBUTTONDOWN);
+static_assert(kWmRButtonUp == WM_RBUTTONUP);
+static_assert(kWmMButtonDown == WM_MBUTTONDOWN);
+static_assert(kWmMButtonUp == WM_MBUTTONUP);
+static_assert(kWmMouseWheel == WM_MOUSEWHEEL);
+static_assert(kVkLButton == VK_LBUTTON);
+static_assert(kVkRButton == VK_RBUTTON);
+static_assert(kVkMButton == VK_MBUTTON);
+static_assert(kVkReturn == VK_RETURN);
+static_assert(kVkShift == VK_SHIFT);
+static_assert(kVkControl == VK_CONTROL);
+static_assert(kVkMenu == VK_MENU);
+static_assert(kVkRight == VK_RIGHT);
+static_assert(kVkF4 == VK_F4);
+static_assert(kWheelDelta == WHEEL_DELTA);
+
 HHOOK mouse_hook = nullptr;
-static POINT lbutton_down_point = {-1, -1};
-static bool lbutton_down_on_tab_bar = false;
-static bool last_on_tab_bar = false;
 
 struct DragNewTabState {
   int mode = 0;
   HWND hwnd = nullptr;
   POINT drop_point = {-1, -1};
   int start_tab_count = 0;
-  NodePtr start_selected_tab = nullptr;
+  TabKey start_selected_key = 0;
   int start_selected_index = -1;
-  std::vector<NodePtr> start_tabs;
+  TabKeySet start_tab_keys;
+  // Whether `start_tab_keys` compare with the keys of `GetEventTab`, so that
+  // an event tells by itself whether its tab is new.
+  bool event_tab_keys = false;
   int check_attempts = 0;
-  bool armed = false;
   bool pending = false;
 };
 
 DragNewTabState drag_new_tab_state;
 UINT_PTR drag_new_tab_timer = 0;
 UINT_PTR drag_new_tab_restore_timer = 0;
-NodePtr drag_new_tab_restore_tab = nullptr;
+bool drag_new_tab_restoring = false;
 int drag_new_tab_restore_attempts = 0;
+// Listens for the tabs Chrome creates and selects while a drop is checked or
+// the selection is restored. Without it, the tab strip is polled instead.
+HWINEVENTHOOK drag_new_tab_event_hook = nullptr;
 
 constexpr UINT kDragNewTabCheckIntervalMs = 80;
 constexpr int kDragNewTabMaxAttempts = 12;
 constexpr int kDragNewTabRestoreAttempts = 4;
 
-#define KEY_PRESSED 0x8000
-bool IsPressed(int key) {
-  return key && (::GetKeyState(key) & KEY_PRESSED) != 0;
-}
-
-bool HasValidLButtonDownPoint() {
-  return lbutton_down_point.x >= 0 && lbutton_down_point.y >= 0;
-}
-
-bool HandleDrag(PMOUSEHOOKSTRUCT pmouse) {
-  if (!HasValidLButtonDownPoint()) {
-    return false;
-  }
-  static int dragThresholdX = GetSystemMetrics(SM_CXDRAG);
-  static int dragThresholdY = GetSystemMetrics(SM_CYDRAG);
-  int dx = pmouse->pt.x - lbutton_down_point.x;
-  int dy = pmouse->pt.y - lbutton_down_point.y;
-  return (abs(dx) > dragThresholdX || abs(dy) > dragThresholdY);
-}
-
-// Compared with `IsOnlyOneTab`, this function additionally implements tick
-// fault tolerance to prevent users from directly closing the window when
-// they click too fast.
-bool IsNeedKeep(const NodePtr& top_container_view) {
-  if (!config.IsKeepLastTab()) {
-    return false;
-  }
-
-  auto tab_count = GetTabCount(top_container_view);
-  bool keep_tab = (tab_count == 1);
-
-  static auto last_closing_tab_tick = GetTickCount64();
-  auto tick = GetTickCount64() - last_closing_tab_tick;
-  last_closing_tab_tick = GetTickCount64();
-
-  if (tick > 50 && tick <= 250 && tab_count == 2) {
-    keep_tab = true;
-  }
-
-  return keep_tab;
-}
-
-// When `top_container_view` is not found, the find-in-page bar may be open
-// and focused. Use `IsOnFindBarPane` to check if the click occurred on the
-// bar. If so, return nullptr to avoid interfering with find operations
-// (#157). Otherwise, close the bar and retry finding `top_container_view`
-// to fix issues where double-click and right-click close actions fail when
-// the bar is open (#187). Closing the bar typically has no side effects,
-// except that clicks on other tabs or bookmarks will also dismiss the bar
-// when it is open.
-NodePtr HandleFindBar(HWND hwnd, POINT pt) {
-  NodePtr top_container_view = GetTopContainerView(hwnd);
-  if (!top_container_view) {
-    if (IsOnFindBarPane(pt)) {
-      return nullptr;
-    }
-    ExecuteCommand(IDC_CLOSE_FIND_OR_STOP, hwnd);
-    top_container_view = GetTopContainerView(hwnd);
-    if (!top_container_view) {
-      return nullptr;
-    }
-  }
-  return top_container_view;
-}
-
-// Use the mouse wheel to switch tabs
-bool HandleMouseWheel(LPARAM lParam, PMOUSEHOOKSTRUCT pmouse) {
-  if (!config.IsWheelTab() && !config.IsWheelTabWhenPressRightButton()) {
-    return false;
-  }
-
-  HWND hwnd = GetFocus();
-  NodePtr top_container_view = GetTopContainerView(hwnd);
-
-  PMOUSEHOOKSTRUCTEX pwheel = reinterpret_cast<PMOUSEHOOKSTRUCTEX>(lParam);
-  int zDelta = GET_WHEEL_DELTA_WPARAM(pwheel->mouseData);
-
-  auto switch_tabs = [&]() {
-    hwnd = GetTopWnd(hwnd);
-    if (zDelta > 0) {
-      ExecuteCommand(IDC_SELECT_PREVIOUS_TAB, hwnd);
-    } else {
-      ExecuteCommand(IDC_SELECT_NEXT_TAB, hwnd);
-    }
-    return true;
-  };
-
-  // If the mouse wheel is used to switch tabs when the mouse is on the tab bar.
-  if (config.IsWheelTab() && IsOnTheTabBar(top_container_view, pmouse->pt)) {
-    return switch_tabs();
-  }
-
-  // If it is used to switch tabs when the right button is held.
-  if (config.IsWheelTabWhenPressRightButton() && IsPressed(VK_RBUTTON)) {
-    return switch_tabs();
-  }
-
-  return false;
-}
-
-// Double-click to close tab.
-bool HandleDoubleClick(PMOUSEHOOKSTRUCT pmouse) {
-  if (!config.IsDoubleClickClose()) {
-    return false;
-  }
-
-  POINT pt = pmouse->pt;
-  HWND hwnd = WindowFromPoint(pt);
-  NodePtr top_container_view = HandleFindBar(hwnd, pt);
-  if (!top_container_view) {
-    return false;
-  }
-
-  bool is_on_one_tab = IsOnOneTab(top_container_view, pt);
-  bool is_on_close_button = IsOnCloseButton(top_container_view, pt);
-  if (!is_on_one_tab || is_on_close_button) {
-    return false;
-  }
-
-  if (IsOnlyOneTab(top_container_view)) {
-    ExecuteCommand(IDC_NEW_TAB, hwnd);
-    ExecuteCommand(IDC_WINDOW_CLOSE_OTHER_TABS, hwnd);
-  } else {
-    ExecuteCommand(IDC_CLOSE_TAB, hwnd);
+// The handler a mouse message goes to, for the latency statistics.
+HookHandler GetMouseHookHandler(WPARAM message) {
+  switch (message) {
+    case WM_MOUSEMOVE:
+    case WM_NCMOUSEMOVE:
+      return HookHandler::kMouseMove;
+    case WM_LBUTTONDOWN:
+    case WM_RBUTTONDOWN:
+    case WM_MBUTTONDOWN:
+      return HookHandler::kButtonDown;
+    case WM_LBUTTONUP:
+      return HookHandler::kLButtonUp;
+    case WM_RBUTTONUP:
+      return HookHandler::kRButtonUp;
+    case WM_MBUTTONUP:
+      return HookHandler::kMButtonUp;
+    case WM_LBUTTONDBLCLK:
+      return HookHandler::kDoubleClick;
+    case WM_MOUSEWHEEL:
+      return HookHandler::kMouseWheel;
+    default:
+      return HookHandler::kOther;
   }
-  return true;
 }
 
-// Right-click to close tab (Hold Shift to show the original menu).
-bool HandleRightClick(PMOUSEHOOKSTRUCT pmouse) {
-  if (IsPressed(VK_SHIFT) || !config.IsRightClickClose()) {
-    return false;
-  }
-
-  POINT pt = pmouse->pt;
-  HWND hwnd = WindowFromPoint(pt);
-  NodePtr top_container_view = HandleFindBar(hwnd, pt);
-  if (!top_container_view) {
-    return false;
-  }
-
-  if (IsOnOneTab(top_container_view, pt)) {
-    if (IsNeedKeep(top_container_view)) {
-      ExecuteCommand(IDC_NEW_TAB, hwnd);
-      ExecuteCommand(IDC_WINDOW_CLOSE_OTHER_TABS, hwnd);
-    } else {
-      // Attempt new SendKey function which includes a `dwExtraInfo`
-      // value (GetMagicCode()).
-      SendKey(VK_MBUTTON);
-    }
-    return true;
-  }
-  return false;
+const TabInfo* GetSelectedTab(const std::vector<TabInfo>& tabs) {
+  auto it = std::ranges::find_if(tabs, &TabInfo::selected);
+  return it == tabs.end() ? nullptr : &*it;
 }
 
-// Preserve the last tab when the middle button is clicked on the tab.
-bool HandleMiddleClick(PMOUSEHOOKSTRUCT pmouse) {
-  POINT pt = pmouse->pt;
-  HWND hwnd = WindowFromPoint(pt);
-  NodePtr top_container_view = HandleFindBar(hwnd, pt);
-  if (!top_container_view) {
-    return false;
-  }
-
-  bool is_on_one_tab = IsOnOneTab(top_container_view, pt);
-  bool keep_tab = IsNeedKeep(top_container_view);
-
-  if (is_on_one_tab && keep_tab) {
-    ExecuteCommand(IDC_NEW_TAB, hwnd);
-    ExecuteCommand(IDC_WINDOW_CLOSE_OTHER_TABS, hwnd);
-    return true;
+// Unhooks the WinEvents once neither a drop nor a restore waits for them.
+void UpdateDragNewTabEventHook() {
+  if (drag_new_tab_state.pending || drag_new_tab_restoring ||
+      !drag_new_tab_event_hook) {
+    return;
   }
-
-  return false;
-}
-
-bool IsDragNewTabEnabled() {
-  int mode = config.GetDragNewTabMode();
-  return mode == 1 || mode == 2;
+  UnhookWinEvent(drag_new_tab_event_hook);
+  drag_new_tab_event_hook = nullptr;
 }
 
 void ResetDragNewTabState() {
@@ -224,57 +120,31 @@ void ResetDragNewTabState() {
   drag_new_tab_state.hwnd = nullptr;
   drag_new_tab_state.drop_point = {-1, -1};
   drag_new_tab_state.start_tab_count = 0;
-  drag_new_tab_state.start_selected_tab = nullptr;
+  drag_new_tab_state.start_selected_key = 0;
   drag_new_tab_state.start_selected_index = -1;
-  drag_new_tab_state.start_tabs.clear();
+  drag_new_tab_state.start_tab_keys.clear();
+  drag_new_tab_state.event_tab_keys = false;
   drag_new_tab_state.check_attempts = 0;
-  drag_new_tab_state.armed = false;
   drag_new_tab_state.pending = false;
   if (drag_new_tab_restore_timer != 0) {
     KillTimer(nullptr, drag_new_tab_restore_timer);
     drag_new_tab_restore_timer = 0;
   }
-  drag_new_tab_restore_tab = nullptr;
+  drag_new_tab_restoring = false;
   drag_new_tab_restore_attempts = 0;
+  UpdateDragNewTabEventHook();
 }
 
-NodePtr FindNewTabAfterDrag(const std::vector<NodePtr>& tabs) {
-  if (drag_new_tab_state.start_tabs.empty()) {
-    return nullptr;
-  }
-  for (const auto& tab : tabs) {
-    bool existed = false;
-    for (const auto& old_tab : drag_new_tab_state.start_tabs) {
-      if (tab.Get() == old_tab.Get()) {
-        existed = true;
-        break;
-      }
-    }
-    if (!existed) {
-      return tab;
-    }
-  }
-  return nullptr;
-}
-
-int GetTabIndex(const std::vector<NodePtr>& tabs, const NodePtr& target_tab) {  
-  if (!target_tab) {
+int GetTabIndex(const std::vector<TabInfo>& tabs, TabKey key) {
+  if (key == 0) {
     return -1;
   }
-  for (size_t i = 0; i < tabs.size(); ++i) {
-    if (tabs[i].Get() == target_tab.Get()) {
-      return static_cast<int>(i);
-    }
-  }
-  return -1;
-}
-
-bool IsTabInList(const std::vector<NodePtr>& tabs, const NodePtr& target_tab) {
-  return GetTabIndex(tabs, target_tab) >= 0;
+  auto it = std::ranges::find(tabs, key, &TabInfo::key);
+  return it == tabs.end() ? -1 : static_cast<int>(it - tabs.begin());
 }
 
 bool InitDragNewTabState(HWND hwnd, const NodePtr& top_container_view) {
-  int mode = config.GetDragNewTabMode();
+  int mode = config->GetDragNewTabMode();
   if (mode != 1 && mode != 2) {
     ResetDragNewTabState();
     return false;
@@ -287,24 +157,25 @@ bool InitDragNewTabState(HWND hwnd, const NodePtr& top_container_view) {
   drag_new_tab_state.mode = mode;
   drag_new_tab_state.hwnd = hwnd;
   drag_new_tab_state.start_tab_count = GetTabCount(top_container_view);
-  drag_new_tab_state.start_selected_tab = GetSelectedTab(top_container_view);
-  drag_new_tab_state.start_tabs = GetTabs(top_container_view);
+  auto tabs = GetTabs(top_container_view);
+  drag_new_tab_state.start_tab_keys = GetTabKeys(tabs);
+  drag_new_tab_state.event_tab_keys = HasEventTabKeys(tabs);
+  const TabInfo* selected_tab = GetSelectedTab(tabs);
+  drag_new_tab_state.start_selected_key = selected_tab ? selected_tab->key : 0;
   drag_new_tab_state.start_selected_index =
-      GetTabIndex(drag_new_tab_state.start_tabs,
-                  drag_new_tab_state.start_selected_tab);
-  return !drag_new_tab_state.start_tabs.empty();
+      GetTabIndex(tabs, drag_new_tab_state.start_selected_key);
+  return !tabs.empty();
 }
 
-NodePtr GetTabByIndex(const std::vector<NodePtr>& tabs, int index) {
+const TabInfo* GetTabByIndex(const std::vector<TabInfo>& tabs, int index) {
   if (index < 0 || index >= static_cast<int>(tabs.size())) {
     return nullptr;
   }
-  return tabs[index];
+  return &tabs[index];
 }
 
-int GetMoveStepsToEnd(const std::vector<NodePtr>& tabs,
-                      const NodePtr& target_tab) {
-  int index = GetTabIndex(tabs, target_tab);
+int GetMoveStepsToEnd(const std::vector<TabInfo>& tabs, TabKey key) {
+  int index = GetTabIndex(tabs, key);
   if (index < 0) {
     return 0;
   }
@@ -312,486 +183,495 @@ int GetMoveStepsToEnd(const std::vector<NodePtr>& tabs,
   return last_index > index ? last_index - index : 0;
 }
 
-NodePtr ResolveRestoreTab(const std::vector<NodePtr>& tabs) {
-  if (drag_new_tab_state.start_selected_tab) {
-    int index = GetTabIndex(tabs, drag_new_tab_state.start_selected_tab);
-    if (index >= 0) {
-      return tabs[index];
-    }
+const TabInfo* ResolveRestoreTab(const std::vector<TabInfo>& tabs) {
+  int index = GetTabIndex(tabs, drag_new_tab_state.start_selected_key);
+  if (index >= 0) {
+    return &tabs[index];
   }
   return GetTabByIndex(tabs, drag_new_tab_state.start_selected_index);
 }
 
-void MoveSelectedTabToEnd(HWND hwnd, int steps) {
+// Calls `done` once the tab has been moved, at once if there is nothing to do.
+void MoveSelectedTabToEnd(HWND hwnd, int steps, CommandCallback done) {
   if (!hwnd || steps <= 0) {
+    done(true);
     return;
   }
-  for (int i = 0; i < steps; ++i) {
-    ExecuteCommand(IDC_MOVE_TAB_NEXT, hwnd);
-  }
+  QueueCommand(IDC_MOVE_TAB_NEXT, hwnd, steps, std::move(done));
 }
 
-void CALLBACK DragNewTabRestoreTimerProc(HWND, UINT, UINT_PTR timer_id,
-                                         DWORD) {
-  if (drag_new_tab_restore_attempts <= 0) {
-    KillTimer(nullptr, timer_id);
-    drag_new_tab_restore_timer = 0;
-    drag_new_tab_restore_tab = nullptr;
-    return;
-  }
+void OnDragNewTabEvent(DWORD event, HWND hwnd, LONG id_object, LONG id_child);
 
-  --drag_new_tab_restore_attempts;
-  if (!drag_new_tab_state.hwnd) {
-    KillTimer(nullptr, timer_id);
-    drag_new_tab_restore_timer = 0;
-    drag_new_tab_restore_tab = nullptr;
-    return;
-  }
-  NodePtr top_container_view = GetTopContainerView(drag_new_tab_state.hwnd);
-  if (!top_container_view) {
+// Chrome fires these for its own windows once something has asked it for
+// accessibility objects, which the drag did when it read the tab strip. The
+// hook is out of context, so the events arrive through the message loop of
+// this thread rather than from inside Chrome.
+void CALLBACK DragNewTabEventProc(HWINEVENTHOOK,
+                                  DWORD event,
+                                  HWND hwnd,
+                                  LONG id_object,
+                                  LONG id_child,
+                                  DWORD,
+                                  DWORD) {
+  if (event != EVENT_OBJECT_CREATE && event != EVENT_OBJECT_SHOW &&
+      event != EVENT_OBJECT_SELECTION) {
     return;
   }
-  auto tabs = GetTabs(top_container_view);
-  NodePtr restore_tab = ResolveRestoreTab(tabs);
-  if (!restore_tab) {
+  if (!hwnd || !drag_new_tab_state.hwnd ||
+      GetAncestor(hwnd, GA_ROOT) !=
+          GetAncestor(drag_new_tab_state.hwnd, GA_ROOT)) {
     return;
   }
-  NodePtr selected_tab = GetSelectedTab(top_container_view);
-  if (!selected_tab || selected_tab.Get() != restore_tab.Get()) {
-    SelectTab(restore_tab);
-  }
-  if (drag_new_tab_restore_attempts <= 0) {
-    KillTimer(nullptr, timer_id);
-    drag_new_tab_restore_timer = 0;
-    drag_new_tab_restore_tab = nullptr;
+  PostUITask(L"DragNewTabEvent", [=] {
+    OnDragNewTabEvent(event, hwnd, id_object, id_child);
+  });
+}
+
+// Starts listening for the tab events of this thread. Returns false if the
+// hook cannot be set, in which case the callers fall back to polling.
+bool WatchDragNewTabEvents() {
+  if (!drag_new_tab_event_hook) {
+    drag_new_tab_event_hook = SetWinEventHook(
+        EVENT_OBJECT_CREATE, EVENT_OBJECT_SELECTION, nullptr,
+        DragNewTabEventProc, GetCurrentProcessId(), GetCurrentThreadId(),
+        WINEVENT_OUTOFCONTEXT);
   }
+  return drag_new_tab_event_hook != nullptr;
 }
 
-void QueueDragNewTabRestore(const NodePtr& tab) {
+void EndDragNewTabRestore() {
   if (drag_new_tab_restore_timer != 0) {
     KillTimer(nullptr, drag_new_tab_restore_timer);
     drag_new_tab_restore_timer = 0;
   }
-  drag_new_tab_restore_tab = nullptr;
+  drag_new_tab_restoring = false;
   drag_new_tab_restore_attempts = 0;
-  if (!tab) {
-    return;
-  }
-  drag_new_tab_restore_tab = tab;
-  drag_new_tab_restore_attempts = kDragNewTabRestoreAttempts;
-  drag_new_tab_restore_timer = SetTimer(nullptr, 0, kDragNewTabCheckIntervalMs,
-                                        DragNewTabRestoreTimerProc);
+  UpdateDragNewTabEventHook();
 }
 
-void CALLBACK DragNewTabTimerProc(HWND, UINT, UINT_PTR timer_id, DWORD) {       
-  KillTimer(nullptr, timer_id);
-  drag_new_tab_timer = 0;
-
-  if (!drag_new_tab_state.pending) {
+// Selects the tab the drag started from again if Chrome has moved the
+// selection away from it.
+void RestoreDragStartTab() {
+  NodePtr top_container_view = GetTopContainerView(drag_new_tab_state.hwnd);
+  if (!top_container_view) {
     return;
   }
-  if (drag_new_tab_state.check_attempts <= 0) {
-    ResetDragNewTabState();
-    return;
+  auto tabs = GetTabs(top_container_view);
+  const TabInfo* restore_tab = ResolveRestoreTab(tabs);
+  if (restore_tab && !restore_tab->selected) {
+    SelectTab(restore_tab->node);
   }
-  --drag_new_tab_state.check_attempts;
+}
 
-  if (drag_new_tab_state.mode != 1 && drag_new_tab_state.mode != 2) {
-    ResetDragNewTabState();
+void CALLBACK DragNewTabRestoreTimerProc(HWND, UINT, UINT_PTR, DWORD) {
+  ConfigReadScope config_scope;
+  AccessibleSnapshotScope accessible_scope(L"DragNewTabRestoreTimerProc");
+  if (drag_new_tab_restore_attempts <= 0 || !drag_new_tab_state.hwnd) {
+    EndDragNewTabRestore();
     return;
   }
-
-  NodePtr top_container_view = GetTopContainerView(drag_new_tab_state.hwnd);    
-  if (!top_container_view) {
-    ResetDragNewTabState();
-    return;
+  --drag_new_tab_restore_attempts;
+  RestoreDragStartTab();
+  if (drag_new_tab_restore_attempts <= 0) {
+    EndDragNewTabRestore();
   }
-  if (drag_new_tab_state.start_tabs.empty()) {
-    ResetDragNewTabState();
-    return;
+}
+
+void QueueDragNewTabRestore() {
+  EndDragNewTabRestore();
+  drag_new_tab_restoring = true;
+  if (WatchDragNewTabEvents()) {
+    // Selection changes are handled as Chrome reports them, so the timer only
+    // makes a last check when the restore window closes.
+    drag_new_tab_restore_attempts = 1;
+    drag_new_tab_restore_timer = SetTimer(
+        nullptr, 0, kDragNewTabCheckIntervalMs * kDragNewTabRestoreAttempts,
+        DragNewTabRestoreTimerProc);
+  } else {
+    drag_new_tab_restore_attempts = kDragNewTabRestoreAttempts;
+    drag_new_tab_restore_timer = SetTimer(
+        nullptr, 0, kDragNewTabCheckIntervalMs, DragNewTabRestoreTimerProc);
   }
+}
 
+// Finds the tab a drop created by diffing the whole tab strip against the one
+// the drag started from, along with how far it is from the end.
+bool FindDragNewTab(const NodePtr& top_container_view,
+                    TabInfo& new_tab,
+                    int& move_steps) {
   auto tabs = GetTabs(top_container_view);
-  NodePtr selected_tab = GetSelectedTab(top_container_view);
-  NodePtr new_tab = FindNewTabAfterDrag(tabs);
-  if (!new_tab && selected_tab &&
-      !IsTabInList(drag_new_tab_state.start_tabs, selected_tab)) {
-    new_tab = selected_tab;
+  const TabInfo* added_tab =
+      FindAddedTab(drag_new_tab_state.start_tab_keys, tabs);
+  if (!added_tab) {
+    return false;
   }
+  // Copied, since it is used once the tab has been moved.
+  new_tab = *added_tab;
+  move_steps = GetMoveStepsToEnd(tabs, new_tab.key);
+  return true;
+}
 
-  if (!new_tab) {
-    drag_new_tab_timer = SetTimer(nullptr, 0, kDragNewTabCheckIntervalMs,
-                                  DragNewTabTimerProc);
-    return;
+// Looks for the tab a drop created and, once it is there, moves and selects it
+// as configured. `event_tab` is the tab of a WinEvent: one the drag started
+// with is dismissed without reading the tab strip, and a new one is taken as
+// the created tab. Without it, as for the first check and the deadline, the
+// whole tab strip is read. Returns false while the tab has yet to show up or
+// to take the selection.
+bool TryFinishDragNewTab(const TabInfo* event_tab = nullptr) {
+  if (drag_new_tab_state.mode != 1 && drag_new_tab_state.mode != 2) {
+    ResetDragNewTabState();
+    return true;
+  }
+  if (!drag_new_tab_state.hwnd || drag_new_tab_state.start_tab_keys.empty()) {
+    ResetDragNewTabState();
+    return true;
   }
 
-  int move_steps = GetMoveStepsToEnd(tabs, new_tab);
-  auto ensure_selected = [&](const NodePtr& tab) -> bool {
-    if (!tab) {
+  TabInfo new_tab;
+  int move_steps = 0;
+  std::optional<int> tabs_after;
+  if (event_tab && drag_new_tab_state.event_tab_keys) {
+    if (drag_new_tab_state.start_tab_keys.contains(event_tab->key)) {
       return false;
     }
-    if (selected_tab && selected_tab.Get() == tab.Get()) {
+    tabs_after = CountTabsAfter(event_tab->node);
+  }
+  if (tabs_after) {
+    new_tab = *event_tab;
+    move_steps = *tabs_after;
+  } else {
+    NodePtr top_container_view = GetTopContainerView(drag_new_tab_state.hwnd);
+    if (!top_container_view) {
+      ResetDragNewTabState();
       return true;
     }
-    if (!SelectTab(tab)) {
+    if (!FindDragNewTab(top_container_view, new_tab, move_steps)) {
       return false;
     }
-    NodePtr now_selected = GetSelectedTab(top_container_view);
-    return now_selected && now_selected.Get() == tab.Get();
+  }
+
+  auto ensure_selected = [](const TabInfo& tab) -> bool {
+    if (tab.selected) {
+      return true;
+    }
+    return SelectTab(tab.node) && IsTabSelected(tab.node);
   };
 
   bool new_tab_selected = ensure_selected(new_tab);
   if (!new_tab_selected) {
     if (move_steps > 0 || drag_new_tab_state.mode == 1) {
-      drag_new_tab_timer = SetTimer(nullptr, 0, kDragNewTabCheckIntervalMs,
-                                    DragNewTabTimerProc);
-      return;
+      return false;
     }
   }
-  if (move_steps > 0 && new_tab_selected) {
-    MoveSelectedTabToEnd(drag_new_tab_state.hwnd, move_steps);
-    tabs = GetTabs(top_container_view);
+  HWND hwnd = drag_new_tab_state.hwnd;
+  int mode = drag_new_tab_state.mode;
+  MoveSelectedTabToEnd(
+      hwnd, new_tab_selected ? move_steps : 0,
+      [hwnd, mode, new_tab, new_tab_selected](bool) {
+        // Reset, or another drag started, while the tab was moved.
+        if (drag_new_tab_state.hwnd != hwnd) {
+          return;
+        }
+        if (mode == 2) {
+          auto tabs = GetTabs(GetTopContainerView(hwnd));
+          const TabInfo* restore_tab = ResolveRestoreTab(tabs);
+          if (restore_tab && (!restore_tab->selected || new_tab_selected)) {
+            SelectTab(restore_tab->node);
+            QueueDragNewTabRestore();
+          }
+        } else if (!new_tab_selected) {
+          SelectTab(new_tab.node);
+        }
+      });
+
+  drag_new_tab_state.pending = false;
+  drag_new_tab_state.check_attempts = 0;
+  drag_new_tab_state.start_tab_keys.clear();
+  if (drag_new_tab_timer != 0) {
+    KillTimer(nullptr, drag_new_tab_timer);
+    drag_new_tab_timer = 0;
   }
+  UpdateDragNewTabEventHook();
+  return true;
+}
 
-  if (drag_new_tab_state.mode == 2) {
-    NodePtr restore_tab = ResolveRestoreTab(tabs);
-    if (restore_tab &&
-        (!selected_tab || selected_tab.Get() != restore_tab.Get() ||
-         new_tab_selected)) {
-      SelectTab(restore_tab);
-      QueueDragNewTabRestore(restore_tab);
-    }
-  } else if (!new_tab_selected) {
-    SelectTab(new_tab);
+void CALLBACK DragNewTabTimerProc(HWND, UINT, UINT_PTR timer_id, DWORD) {
+  ConfigReadScope config_scope;
+  AccessibleSnapshotScope accessible_scope(L"DragNewTabTimerProc");
+  KillTimer(nullptr, timer_id);
+  drag_new_tab_timer = 0;
+
+  if (!drag_new_tab_state.pending) {
+    return;
   }
+  if (drag_new_tab_state.check_attempts <= 0) {
+    ResetDragNewTabState();
+    return;
+  }
+  --drag_new_tab_state.check_attempts;
+  if (TryFinishDragNewTab()) {
+    return;
+  }
+  if (drag_new_tab_state.check_attempts <= 0) {
+    ResetDragNewTabState();
+    return;
+  }
+  drag_new_tab_timer =
+      SetTimer(nullptr, 0, kDragNewTabCheckIntervalMs, DragNewTabTimerProc);
+}
 
-  drag_new_tab_state.pending = false;
-  drag_new_tab_state.check_attempts = 0;
-  drag_new_tab_state.start_tabs.clear();
-  drag_new_tab_state.armed = false;
+void OnDragNewTabEvent(DWORD event, HWND hwnd, LONG id_object, LONG id_child) {
+  if (!drag_new_tab_state.pending && !drag_new_tab_restoring) {
+    return;
+  }
+  TabInfo event_tab = GetEventTab(hwnd, id_object, id_child);
+  if (!event_tab.node) {
+    return;
+  }
+  if (drag_new_tab_state.pending) {
+    TryFinishDragNewTab(&event_tab);
+  } else if (event == EVENT_OBJECT_SELECTION) {
+    RestoreDragStartTab();
+  }
 }
 
 void QueueDragNewTabCheck(HWND hwnd, const NodePtr& top_container_view,
                           POINT pt) {
-  int mode = config.GetDragNewTabMode();
+  int mode = config->GetDragNewTabMode();
   if (mode != 1 && mode != 2) {
     ResetDragNewTabState();
     return;
   }
   drag_new_tab_state.mode = mode;
-  if (!drag_new_tab_state.armed || drag_new_tab_state.start_tabs.empty() ||
+  if (drag_new_tab_state.start_tab_keys.empty() ||
       drag_new_tab_state.hwnd != hwnd) {
     if (!InitDragNewTabState(hwnd, top_container_view)) {
       return;
     }
   }
 
-  if (drag_new_tab_restore_timer != 0) {
-    KillTimer(nullptr, drag_new_tab_restore_timer);
-    drag_new_tab_restore_timer = 0;
-  }
-  drag_new_tab_restore_tab = nullptr;
-  drag_new_tab_restore_attempts = 0;
+  EndDragNewTabRestore();
   drag_new_tab_state.drop_point = pt;
   drag_new_tab_state.pending = true;
-  drag_new_tab_state.check_attempts = kDragNewTabMaxAttempts;
-  drag_new_tab_state.armed = false;
 
   if (drag_new_tab_timer != 0) {
     KillTimer(nullptr, drag_new_tab_timer);
     drag_new_tab_timer = 0;
   }
-  // Delay the check to allow Chrome to finish the drag-drop tab creation.      
+  if (WatchDragNewTabEvents()) {
+    // The tab is found from the events Chrome fires as it creates and selects
+    // it. Chrome may have created it before the hook was set, so look once
+    // now; the timer only gives up when no tab shows up.
+    drag_new_tab_state.check_attempts = 1;
+    drag_new_tab_timer = SetTimer(
+        nullptr, 0, kDragNewTabCheckIntervalMs * kDragNewTabMaxAttempts,
+        DragNewTabTimerProc);
+    PostUITask(L"DragNewTabCheck", [] {
+      if (drag_new_tab_state.pending) {
+        TryFinishDragNewTab();
+      }
+    });
+    return;
+  }
+  // Delay the check to allow Chrome to finish the drag-drop tab creation.
+  drag_new_tab_state.check_attempts = kDragNewTabMaxAttempts;
   drag_new_tab_timer =
       SetTimer(nullptr, 0, kDragNewTabCheckIntervalMs, DragNewTabTimerProc);
 }
+// A timer of the hooks, run with the scopes of a hook.
+struct HookTimer {
+  std::wstring_view name;
+  std::function<void()> task;
+};
 
-// Open bookmarks in a new tab.
-bool HandleBookmark(PMOUSEHOOKSTRUCT pmouse) {
-  int mode = config.GetBookmarkNewTabMode();
-  if (IsPressed(VK_CONTROL) || IsPressed(VK_SHIFT) || mode == 0) {
-    return false;
-  }
-
-  POINT pt = pmouse->pt;
-  HWND hwnd = WindowFromPoint(pt);
+std::unordered_map<UINT_PTR, HookTimer> hook_timers;
 
-  if (!IsOnBookmark(hwnd, pt)) {
-    return false;
+void CALLBACK HookTimerProc(HWND, UINT, UINT_PTR timer_id, DWORD) {
+  KillTimer(nullptr, timer_id);
+  auto timer = hook_timers.extract(timer_id);
+  if (timer.empty()) {
+    return;
   }
+  ConfigReadScope config_scope;
+  AccessibleSnapshotScope accessible_scope(timer.mapped().name);
+  timer.mapped().task();
+}
 
-  if (IsOnExpandedList(hwnd, pt)) {
-    // This is only used to determine the expanded dropdown menu of the address
-    // bar. When the mouse clicks on it, it may penetrate through to the
-    // background, causing a misjudgment that it is on the bookmark. Related
-    // issue: https://github.com/Bush2021/chrome_plus/issues/162
-    return false;
-  }
+// What `TabHooks` sees of Windows and the browser.
+class BrowserHookEnv {
+ public:
+  using Window = HWND;
+  using Point = POINT;
 
-  NodePtr top_container_view = GetTopContainerView(
-      GetFocus());  // Must use `GetFocus()`, otherwise when opening bookmarks
-                    // in a bookmark folder (and similar expanded menus),
-                    // `top_container_view` cannot be obtained, making it
-                    // impossible to correctly determine `is_on_new_tab`. See
-                    // #98.
+  const Config& config() const { return Config::Current(); }
+  uint64_t Now() const { return GetTickCount64(); }
 
-  if (!IsOnNewTab(top_container_view)) {
-    if (mode == 1) {
-      SendKey(VK_MBUTTON, VK_SHIFT);
-    } else if (mode == 2) {
-      SendKey(VK_MBUTTON);
-    }
-    return true;
+  bool IsPressed(int key) const { return ::IsPressed(key); }
+  bool AreModifiersPressed(uint32_t modifiers) const {
+    return ::AreModifiersPressed(modifiers);
   }
-  return false;
-}
-
-LRESULT CALLBACK MouseProc(int nCode, WPARAM wParam, LPARAM lParam) {
-  if (nCode != HC_ACTION) {
-    return CallNextHookEx(mouse_hook, nCode, wParam, lParam);
+  POINT GetDragThreshold() const {
+    static POINT threshold = {GetSystemMetrics(SM_CXDRAG),
+                              GetSystemMetrics(SM_CYDRAG)};
+    return threshold;
   }
 
-  PMOUSEHOOKSTRUCT pmouse = reinterpret_cast<PMOUSEHOOKSTRUCT>(lParam);
-
-  // Defining a `dwExtraInfo` value to prevent hook the message sent by
-  // Chrome++ itself.
-  if (pmouse->dwExtraInfo == GetMagicCode()) {
-    return CallNextHookEx(mouse_hook, nCode, wParam, lParam);
+  HWND FocusWindow() const { return GetFocus(); }
+  HWND ForegroundWindow() const { return GetForegroundWindow(); }
+  HWND WindowFromPoint(POINT pt) const { return ::WindowFromPoint(pt); }
+  HWND TopWindow(HWND hwnd) const { return GetTopWnd(hwnd); }
+  HWND RootWindow(HWND hwnd) const { return GetAncestor(hwnd, GA_ROOTOWNER); }
+  bool IsBrowserWindow(HWND hwnd) const {
+    return GetChromeWidgetWin(hwnd) != nullptr;
   }
+  bool IsFullScreen(HWND hwnd) const { return ::IsFullScreen(hwnd); }
 
-  if (wParam == WM_MOUSEMOVE || wParam == WM_NCMOUSEMOVE) {
-    if (IsDragNewTabEnabled()) {
-      POINT pt = pmouse->pt;
-      HWND hwnd = GetTopWnd(GetFocus());
-      if (!hwnd) {
-        hwnd = GetTopWnd(WindowFromPoint(pt));
-      }
-      NodePtr top_container_view = GetTopContainerView(hwnd);
-      bool is_on_tab_bar =
-          top_container_view && IsOnTheTabBar(top_container_view, pt);
-      bool has_down_point = HasValidLButtonDownPoint();
-      bool drag_started_on_tab_bar = has_down_point && lbutton_down_on_tab_bar;
-      if (is_on_tab_bar && IsPressed(VK_LBUTTON) && !drag_started_on_tab_bar) {
-        bool from_outside = !last_on_tab_bar;
-        bool dragged_from_down = has_down_point && HandleDrag(pmouse);
-        if (from_outside || dragged_from_down || !has_down_point) {
-          if (!drag_new_tab_state.armed || drag_new_tab_state.hwnd != hwnd) {
-            InitDragNewTabState(hwnd, top_container_view);
-          }
-          drag_new_tab_state.armed = true;
-        }
-      }
-      last_on_tab_bar = is_on_tab_bar;
-    }
-    return CallNextHookEx(mouse_hook, nCode, wParam, lParam);
+  bool IsTabStripCached(HWND hwnd) const { return ::IsTabStripCached(hwnd); }
+  std::optional<bool> IsInCachedTabStrip(HWND hwnd, POINT pt) const {
+    return ::IsInCachedTabStrip(hwnd, pt);
   }
-
-  static bool wheel_tab_ing_with_rbutton = false;
-  bool handled = false;
-  switch (wParam) {
-    case WM_LBUTTONDOWN:
-      lbutton_down_point = pmouse->pt;
-      lbutton_down_on_tab_bar = false;
-      if (IsDragNewTabEnabled()) {
-        POINT pt = pmouse->pt;
-        HWND hwnd = GetTopWnd(GetFocus());
-        if (!hwnd) {
-          hwnd = GetTopWnd(WindowFromPoint(pt));
-        }
-        NodePtr top_container_view = GetTopContainerView(hwnd);
-        if (top_container_view && IsOnTheTabBar(top_container_view, pt)) {
-          lbutton_down_on_tab_bar = true;
-        }
-      }
-      drag_new_tab_state.armed = false;
-      if (drag_new_tab_timer != 0) {
-        KillTimer(nullptr, drag_new_tab_timer);
-        drag_new_tab_timer = 0;
-      }
-      drag_new_tab_state.pending = false;
-      drag_new_tab_state.check_attempts = 0;
-      drag_new_tab_state.start_tabs.clear();
-      break;
-    case WM_LBUTTONUP:
-      if (IsDragNewTabEnabled()) {
-        POINT pt = pmouse->pt;
-        HWND hwnd = GetTopWnd(GetFocus());
-        if (!hwnd) {
-          hwnd = GetTopWnd(WindowFromPoint(pt));
-        }
-        NodePtr top_container_view = GetTopContainerView(hwnd);
-        if (top_container_view && IsOnTheTabBar(top_container_view, pt) &&
-            !IsOnNewTabButton(top_container_view, pt) &&
-            drag_new_tab_state.armed) {
-          QueueDragNewTabCheck(hwnd, top_container_view, pt);
-          break;
-        }
-      }
-      drag_new_tab_state.armed = false;
-      lbutton_down_on_tab_bar = false;
-      lbutton_down_point = {-1, -1};
-      if (HandleBookmark(pmouse)) {
-        handled = true;
-      }
-      break;
-    case WM_RBUTTONUP:
-      if (wheel_tab_ing_with_rbutton) {
-        // Swallow the first RBUTTONUP that follows a wheel-based tab switch to
-        // suppress Chrome's context menu; the RBUTTONUP arrives after
-        // WM_MOUSEWHEEL.
-        wheel_tab_ing_with_rbutton = false;
-        handled = true;
-      } else if (HandleRightClick(pmouse)) {
-        handled = true;
-      }
-      break;
-    case WM_MOUSEWHEEL:
-      if (HandleMouseWheel(lParam, pmouse)) {
-        // Mark it true only when a tab switch is performed via mouse wheel with
-        // right button pressed. Otherwise, normal mouse wheel to switch tabs
-        // will swallow irrelevant RBUTTONUP events, causing #198.
-        wheel_tab_ing_with_rbutton = IsPressed(VK_RBUTTON);
-        handled = true;
-      }
-      break;
-    case WM_LBUTTONDBLCLK:
-      if (HandleDoubleClick(pmouse)) {
-        // Do not return 1. Returning 1 could cause the keep_tab to fail
-        // or trigger double-click operations consecutively when the user
-        // double-clicks on the tab page rapidly and repeatedly.
-      }
-      break;
-    case WM_MBUTTONUP:
-      if (HandleMiddleClick(pmouse)) {
-        handled = true;
-      }
-      break;
+  std::optional<TabStripHit> HitCachedTabStrip(HWND hwnd, POINT pt) const {
+    return ::HitCachedTabStrip(hwnd, pt);
   }
-  if (handled) {
-    return 1;  // Swallow the event
+  std::optional<int> GetCachedTabCount(HWND hwnd) const {
+    return ::GetCachedTabCount(hwnd);
   }
-  return CallNextHookEx(mouse_hook, nCode, wParam, lParam);  // Pass
-}
+  void InvalidateUIRegions() const { ::InvalidateUIRegions(); }
 
-int HandleKeepTab(WPARAM wParam) {
-  if (!(wParam == 'W' && IsPressed(VK_CONTROL) && !IsPressed(VK_SHIFT)) &&
-      !(wParam == VK_F4 && IsPressed(VK_CONTROL))) {
-    return 0;
+  void PrefetchTabStrip(HWND hwnd) const { ::PrefetchTabStrip(hwnd); }
+  bool HasTopContainerView(HWND hwnd) const {
+    return GetTopContainerView(hwnd) != nullptr;
   }
-
-  HWND hwnd = GetFocus();
-  if (GetChromeWidgetWin(hwnd) == nullptr) {
-    return 0;
+  TabStripHit HitTabStrip(HWND hwnd, POINT pt) const {
+    NodePtr top_container_view = GetTopContainerView(hwnd);
+    return {IsOnOneTab(top_container_view, pt),
+            IsOnCloseButton(top_container_view, pt),
+            IsOnNewTabButton(top_container_view, pt),
+            ::GetTabCount(top_container_view)};
   }
-
-  if (IsFullScreen(hwnd)) {
-    // Have to exit full screen to find the tab.
-    ExecuteCommand(IDC_FULLSCREEN, hwnd);
+  bool IsOnTheTabBar(HWND hwnd, POINT pt) const {
+    NodePtr top_container_view = GetTopContainerView(hwnd);
+    return top_container_view && ::IsOnTheTabBar(top_container_view, pt);
   }
-
-  HWND tmp_hwnd = hwnd;
-  hwnd = GetAncestor(tmp_hwnd, GA_ROOTOWNER);
-  ExecuteCommand(IDC_CLOSE_FIND_OR_STOP, tmp_hwnd);
-
-  NodePtr top_container_view = GetTopContainerView(hwnd);
-  if (!IsNeedKeep(top_container_view)) {
-    return 0;
+  int GetTabCount(HWND hwnd) const {
+    return ::GetTabCount(GetTopContainerView(hwnd));
   }
-
-  ExecuteCommand(IDC_NEW_TAB, hwnd);
-  ExecuteCommand(IDC_WINDOW_CLOSE_OTHER_TABS, hwnd);
-  return 1;
-}
-
-int HandleOpenUrlNewTab(WPARAM wParam) {
-  int mode = config.GetOpenUrlNewTabMode();
-  if (!(mode != 0 && wParam == VK_RETURN && !IsPressed(VK_MENU))) {
-    return 0;
+  std::vector<TabInfo> GetTabs(HWND hwnd) const {
+    return ::GetTabs(GetTopContainerView(hwnd));
+  }
+  void SelectTab(const TabInfo& tab) const { ::SelectTab(tab.node); }
+  bool IsOnFindBarPane(POINT pt) const { return ::IsOnFindBarPane(pt); }
+  bool IsOnClickableBookmark(HWND hwnd, POINT pt) const {
+    // `IsOnExpandedList` is only used to determine the expanded dropdown menu
+    // of the address bar. When the mouse clicks on it, it may penetrate
+    // through to the background, causing a misjudgment that it is on the
+    // bookmark. Related issue:
+    // https://github.com/Bush2021/chrome_plus/issues/162
+    return IsOnBookmark(hwnd, pt) && !IsOnExpandedList(hwnd, pt);
+  }
+  bool IsBookmarkOpenedOnNewTab() const {
+    // Must use `GetFocus()`, otherwise when opening bookmarks in a bookmark
+    // folder (and similar expanded menus), `top_container_view` cannot be
+    // obtained, making it impossible to correctly determine `is_on_new_tab`.
+    // See #98.
+    return ::IsOnNewTab(GetTopContainerView(GetFocus()));
+  }
+  bool IsOmniboxFocus(HWND hwnd) const {
+    return ::IsOmniboxFocus(GetTopContainerView(hwnd));
+  }
+  bool IsOnNewTab(HWND hwnd) const {
+    return ::IsOnNewTab(GetTopContainerView(hwnd));
   }
 
-  NodePtr top_container_view = GetTopContainerView(GetForegroundWindow());
-  if (IsOmniboxFocus(top_container_view) && !IsOnNewTab(top_container_view)) {
-    if (mode == 1) {
-      SendKey(VK_MENU, VK_RETURN);
-    } else if (mode == 2) {
-      SendKey(VK_SHIFT, VK_MENU, VK_RETURN);
+  void PostTask(std::wstring_view name, std::function<void()> task) const {
+    PostUITask(name, std::move(task));
+  }
+  UINT_PTR StartTimer(std::wstring_view name,
+                      UINT ms,
+                      std::function<void()> task) const {
+    UINT_PTR timer_id = SetTimer(nullptr, 0, ms, HookTimerProc);
+    if (timer_id != 0) {
+      hook_timers[timer_id] = {name, std::move(task)};
     }
-    return 1;
+    return timer_id;
   }
-  return 0;
-}
-
-bool IsHotkeyMatch(UINT hotkey, WPARAM wParam) {
-  if (hotkey == 0) {
-    return false;
+  void StopTimer(UINT_PTR timer_id) const {
+    KillTimer(nullptr, timer_id);
+    hook_timers.erase(timer_id);
   }
-
-  auto vk = HIWORD(hotkey);
-  auto modifiers = LOWORD(hotkey);
-  if ((modifiers & MOD_SHIFT) && !IsPressed(VK_SHIFT)) {
-    return false;
+  void QueueCommand(int id,
+                    HWND hwnd,
+                    int count = 1,
+                    CommandCallback done = {}) const {
+    ::QueueCommand(id, hwnd, count, std::move(done));
   }
-  if ((modifiers & MOD_CONTROL) && !IsPressed(VK_CONTROL)) {
-    return false;
+  template <WORD... kKeys>
+  void SendKeys() const {
+    ::SendKeys<kKeys...>();
   }
-  if ((modifiers & MOD_ALT) && !IsPressed(VK_MENU)) {
-    return false;
+
+  bool InitDragNewTab(HWND hwnd) const {
+    return InitDragNewTabState(hwnd, GetTopContainerView(hwnd));
   }
-  if ((modifiers & MOD_WIN) && !IsPressed(VK_LWIN) && !IsPressed(VK_RWIN)) {
-    return false;
+  void CheckDragNewTab(HWND hwnd, POINT pt) const {
+    QueueDragNewTabCheck(hwnd, GetTopContainerView(hwnd), pt);
   }
-  if (wParam != vk) {
-    return false;
+  void CancelDragNewTab() const {
+    if (drag_new_tab_timer != 0) {
+      KillTimer(nullptr, drag_new_tab_timer);
+      drag_new_tab_timer = 0;
+    }
+    drag_new_tab_state.pending = false;
+    drag_new_tab_state.check_attempts = 0;
+    drag_new_tab_state.start_tab_keys.clear();
   }
+};
 
-  return true;
-}
+BrowserHookEnv browser_hook_env;
+TabHooks<BrowserHookEnv> tab_hooks(browser_hook_env);
 
-int HandleTranslateKey(WPARAM wParam) {
-  auto hotkey = ParseTranslateKey();
-  if (!IsHotkeyMatch(hotkey, wParam)) {
-    return 0;
+LRESULT CALLBACK MouseProc(int nCode, WPARAM wParam, LPARAM lParam) {
+  if (nCode != HC_ACTION) {
+    return CallNextHookEx(mouse_hook, nCode, wParam, lParam);
   }
 
-  ExecuteCommand(IDC_SHOW_TRANSLATE);
-  keybd_event(VK_RIGHT, 0, 0, 0);
-  keybd_event(VK_RIGHT, 0, KEYEVENTF_KEYUP, 0);
-  return 1;
-}
+  PMOUSEHOOKSTRUCT pmouse = reinterpret_cast<PMOUSEHOOKSTRUCT>(lParam);
 
-int HandleSwitchTabKey(WPARAM wParam) {
-  auto prev_hotkey = ParseSwitchToPrevKey();
-  if (IsHotkeyMatch(prev_hotkey, wParam)) {
-    ExecuteCommand(IDC_SELECT_PREVIOUS_TAB);
-    return 1;
+  // Defining a `dwExtraInfo` value to prevent hook the message sent by
+  // Chrome++ itself.
+  if (pmouse->dwExtraInfo == GetMagicCode()) {
+    return CallNextHookEx(mouse_hook, nCode, wParam, lParam);
   }
 
-  auto next_hotkey = ParseSwitchToNextKey();
-  if (IsHotkeyMatch(next_hotkey, wParam)) {
-    ExecuteCommand(IDC_SELECT_NEXT_TAB);
-    return 1;
-  }
+  uint32_t mouse_data =
+      wParam == WM_MOUSEWHEEL
+          ? reinterpret_cast<PMOUSEHOOKSTRUCTEX>(lParam)->mouseData
+          : 0;
+  HookLatencyScope latency_scope(GetMouseHookHandler(wParam),
+                                 static_cast<UINT>(wParam), pmouse->pt,
+                                 mouse_data);
+  ConfigReadScope config_scope;
+  AccessibleSnapshotScope accessible_scope(L"MouseProc");
 
-  return 0;
+  if (tab_hooks.OnMouse(static_cast<uint32_t>(wParam), pmouse->pt,
+                        GET_WHEEL_DELTA_WPARAM(mouse_data))) {
+    return 1;  // Swallow the event
+  }
+  return CallNextHookEx(mouse_hook, nCode, wParam, lParam);  // Pass
 }
 
 HHOOK keyboard_hook = nullptr;
 LRESULT CALLBACK KeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
+  HookLatencyScope latency_scope(
+      HookHandler::kKeyboard, (lParam & 0x80000000) ? WM_KEYUP : WM_KEYDOWN,
+      {}, static_cast<uint32_t>(wParam));
+  ConfigReadScope config_scope;
+  AccessibleSnapshotScope accessible_scope(L"KeyboardProc");
   if (nCode == HC_ACTION && !(lParam & 0x80000000))  // pressed
   {
-    if (HandleKeepTab(wParam) != 0) {
-      return 1;
-    }
-
-    if (HandleOpenUrlNewTab(wParam) != 0) {
-      return 1;
-    }
-
-    if (HandleTranslateKey(wParam) != 0) {
-      return 1;
-    }
-
-    if (HandleSwitchTabKey(wParam) != 0) {
+    // Bit 30 is set for the repeats of a held key.
+    if (tab_hooks.OnKeyDown(static_cast<uint32_t>(wParam),
+                            (lParam & 0x40000000) != 0)) {
       return 1;
     }
   }
@@ -801,6 +681,8 @@ LRESULT CALLBACK KeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
 }  // namespace
 
 void TabBookmark() {
+  // Created on the thread the hooks are installed on, which runs the tasks.
+  InitUITasks();
   mouse_hook =
       SetWindowsHookEx(WH_MOUSE, MouseProc, hInstance, GetCurrentThreadId());
   keyboard_hook = SetWindowsHookEx(WH_KEYBOARD, KeyboardProc, hInstance,
@@ -0,0 +1,811 @@
+#ifndef CHROME_PLUS_SRC_TABHOOKS_H_
+#define CHROME_PLUS_SRC_TABHOOKS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <utility>
+
+#include "commandids.h"
+#include "keybindings.h"
+#include "tabstrip.h"
+
+// What the input hooks of tabbookmark.cc do with each event, written against
+// an environment instead of Windows, the way accessibletree.h is written
+// against a tree, so that recorded traces can be replayed through the same
+// code on any platform.
+//
+// `Env` provides:
+// - `Window`, a window handle that is false when empty, and `Point`, with `x`
+//   and `y` in screen coordinates.
+// - `config()`, with the getters of `Config`, and `Now()` in milliseconds.
+// - The input state: `IsPressed(vk)`, `AreModifiersPressed(modifiers)` and
+//   `GetDragThreshold()`.
+// - The windows: `FocusWindow()`, `ForegroundWindow()`, `WindowFromPoint(pt)`,
+//   `TopWindow(hwnd)`, `RootWindow(hwnd)`, `IsBrowserWindow(hwnd)` and
+//   `IsFullScreen(hwnd)`.
+// - The cached tab strip, which never calls into the browser and is all the
+//   hooks may read: `IsTabStripCached(hwnd)`, `IsInCachedTabStrip(hwnd, pt)`,
+//   `HitCachedTabStrip(hwnd, pt)`, `GetCachedTabCount(hwnd)` and
+//   `InvalidateUIRegions()`.
+// - The reads made by tasks: `PrefetchTabStrip(hwnd)`,
+//   `HasTopContainerView(hwnd)`, `HitTabStrip(hwnd, pt)`,
+//   `IsOnTheTabBar(hwnd, pt)`, `GetTabCount(hwnd)`, `GetTabs(hwnd)`, whose
+//   elements have `selected`, `SelectTab(tab)`, `IsOnFindBarPane(pt)`,
+//   `IsOnClickableBookmark(hwnd, pt)`, `IsBookmarkOpenedOnNewTab()`,
+//   `IsOmniboxFocus(hwnd)` and `IsOnNewTab(hwnd)`.
+// - What the hooks hand off: `PostTask(name, task)`,
+//   `StartTimer(name, ms, task)`, which returns 0 on failure,
+//   `StopTimer(id)`, `QueueCommand(id, hwnd, count, done)` and
+//   `SendKeys<kKeys...>()`.
+// - The drops of drag-new-tab: `InitDragNewTab(hwnd)`, which returns false if
+//   the tabs could not be read, `CheckDragNewTab(hwnd, pt)` and
+//   `CancelDragNewTab()`.
+
+// The window messages and virtual keys the hooks look at, with the values
+// <windows.h> gives them.
+inline constexpr uint32_t kWmNcMouseMove = 0x00A0;
+inline constexpr uint32_t kWmKeyDown = 0x0100;
+inline constexpr uint32_t kWmKeyUp = 0x0101;
+inline constexpr uint32_t kWmMouseMove = 0x0200;
+inline constexpr uint32_t kWmLButtonDown = 0x0201;
+inline constexpr uint32_t kWmLButtonUp = 0x0202;
+inline constexpr uint32_t kWmLButtonDblClk = 0x0203;
+inline constexpr uint32_t kWmRButtonDown = 0x0204;
+inline constexpr uint32_t kWmRButtonUp = 0x0205;
+inline constexpr uint32_t kWmMButtonDown = 0x0207;
+inline constexpr uint32_t kWmMButtonUp = 0x0208;
+inline constexpr uint32_t kWmMouseWheel = 0x020A;
+
+inline constexpr uint16_t kVkLButton = 0x01;
+inline constexpr uint16_t kVkRButton = 0x02;
+inline constexpr uint16_t kVkMButton = 0x04;
+inline constexpr uint16_t kVkReturn = 0x0D;
+inline constexpr uint16_t kVkShift = 0x10;
+inline constexpr uint16_t kVkControl = 0x11;
+inline constexpr uint16_t kVkMenu = 0x12;
+inline constexpr uint16_t kVkRight = 0x27;
+inline constexpr uint16_t kVkF4 = 0x73;
+
+inline constexpr int kWheelDelta = 120;
+
+// Wheel notches are collected for about a frame and applied as one switch, so
+// that a flick on a high resolution wheel or a touchpad makes Chrome switch
+// tabs and repaint the strip once instead of for every event.
+inline constexpr uint32_t kWheelCoalesceMs = 16;
+
+template <typename Env>
+class TabHooks {
+ public:
+  using Window = typename Env::Window;
+  using Point = typename Env::Point;
+
+  explicit TabHooks(Env& env) : env_(env) {}
+
+  TabHooks(const TabHooks&) = delete;
+  TabHooks& operator=(const TabHooks&) = delete;
+
+  // Handles a mouse `message` at `pt`. `wheel_delta` is the delta of a
+  // `WM_MOUSEWHEEL`. Returns true to swallow the event.
+  bool OnMouse(uint32_t message, Point pt, int wheel_delta = 0) {
+    if (message == kWmMouseMove || message == kWmNcMouseMove) {
+      OnMouseMove(pt);
+      return false;
+    }
+
+    bool handled = false;
+    switch (message) {
+      case kWmLButtonDown:
+        OnLButtonDown(pt);
+        break;
+      case kWmLButtonUp:
+        handled = OnLButtonUp(pt);
+        break;
+      case kWmRButtonDown:
+      case kWmMButtonDown: {
+        // The release is decided from the tab strip; read it in the meantime.
+        Window hwnd = env_.WindowFromPoint(pt);
+        if (message == kWmMButtonDown || ClosesTabOnRightClick()) {
+          QueueTabStripPressPrefetch(hwnd, pt);
+        } else {
+          QueueTabStripPrefetch(hwnd);
+        }
+        break;
+      }
+      case kWmRButtonUp:
+        if (wheel_tab_ing_with_rbutton_) {
+          // Swallow the first RBUTTONUP that follows a wheel-based tab switch
+          // to suppress Chrome's context menu; the RBUTTONUP arrives after
+          // WM_MOUSEWHEEL.
+          wheel_tab_ing_with_rbutton_ = false;
+          handled = true;
+        } else if (HandleRightClick(pt)) {
+          handled = true;
+        }
+        break;
+      case kWmMouseWheel:
+        if (HandleMouseWheel(pt, wheel_delta)) {
+          // Mark it true only when a tab switch is performed via mouse wheel
+          // with right button pressed. Otherwise, normal mouse wheel to switch
+          // tabs will swallow irrelevant RBUTTONUP events, causing #198.
+          wheel_tab_ing_with_rbutton_ = env_.IsPressed(kVkRButton);
+          handled = true;
+        }
+        break;
+      case kWmLButtonDblClk:
+        // Do not return 1. Returning 1 could cause the keep_tab to fail
+        // or trigger double-click operations consecutively when the user
+        // double-clicks on the tab page rapidly and repeatedly.
+        if (env_.config().IsDoubleClickClose()) {
+          env_.PostTask(L"HandleDoubleClick",
+                        [this, pt] { HandleDoubleClick(pt); });
+        }
+        break;
+      case kWmMButtonUp:
+        if (HandleMiddleClick(pt)) {
+          handled = true;
+        }
+        break;
+    }
+
+    if (message == kWmLButtonUp || message == kWmRButtonUp ||
+        message == kWmMButtonUp || message == kWmLButtonDblClk) {
+      // Clicks may open, close or move tabs. The handlers above still see the
+      // tab strip as it was before the click, which Chrome has not seen yet.
+      env_.InvalidateUIRegions();
+    }
+    if (message == kWmLButtonUp || message == kWmRButtonUp) {
+      // Clicks may move the focus into or out of the omnibox.
+      QueueOmniboxPrefetch();
+    }
+    return handled;
+  }
+
+  // Handles a press of the virtual key `vk`. `repeat` is set for the repeats
+  // of a held key. Returns true to swallow the event.
+  bool OnKeyDown(uint32_t vk, bool repeat) {
+    KeyAction action =
+        env_.config().GetKeyBindings().Match(vk, [this](uint32_t modifiers) {
+          return env_.AreModifiersPressed(modifiers);
+        });
+    QueueKeepTabPrefetch(vk, repeat);
+    QueueOmniboxPrefetch();
+    bool handled = HandleKeepTab(vk) || HandleOpenUrlNewTab(vk) ||
+                   HandleKeyBinding(action);
+
+    // Bound tab shortcuts may change the tab strip. The handlers above still
+    // see it as it was before the key. Other keys leave the map alone; tabs
+    // opened by Chrome's own shortcuts are picked up when it expires.
+    if (IsTabAction(action)) {
+      env_.InvalidateUIRegions();
+    }
+    return handled;
+  }
+
+ private:
+  struct WheelSwitch {
+    Window hwnd{};
+    // Where the burst started. Its events are taken without looking at the
+    // tab strip again while the pointer stays there.
+    Point pt = {-1, -1};
+    // What is left of the deltas once whole notches are taken out.
+    int delta = 0;
+    // Tabs to move by, towards the end of the strip when positive.
+    int steps = 0;
+    uintptr_t timer = 0;
+  };
+
+  // What a left button press landed on, looked up by a task queued on the
+  // press so that the release can be decided without walking the tree.
+  struct BookmarkPress {
+    Window hwnd{};
+    Point pt = {-1, -1};
+    bool ready = false;
+    bool on_bookmark = false;
+    bool on_new_tab = false;
+  };
+
+  // Whether Enter in the omnibox of `hwnd` is to open the URL in a new tab,
+  // as last read by a task.
+  struct OmniboxState {
+    Window hwnd{};
+    bool open_in_new_tab = false;
+  };
+
+  bool IsBeyondDragThreshold(Point from, Point to) const {
+    Point threshold = env_.GetDragThreshold();
+    return std::abs(to.x - from.x) > threshold.x ||
+           std::abs(to.y - from.y) > threshold.y;
+  }
+
+  bool HasValidLButtonDownPoint() const {
+    return lbutton_down_point_.x >= 0 && lbutton_down_point_.y >= 0;
+  }
+
+  bool IsDragNewTabEnabled() const {
+    int mode = env_.config().GetDragNewTabMode();
+    return mode == 1 || mode == 2;
+  }
+
+  // The browser window a drag goes to.
+  Window GetDragWindow(Point pt) const {
+    Window hwnd = env_.TopWindow(env_.FocusWindow());
+    if (!hwnd) {
+      hwnd = env_.TopWindow(env_.WindowFromPoint(pt));
+    }
+    return hwnd;
+  }
+
+  // Queues a read of the tab strip of `hwnd` unless it is cached, so that the
+  // events that follow can be decided from the cache. A burst of events
+  // queues it only once.
+  void QueueTabStripPrefetch(Window hwnd) {
+    if (!hwnd || hwnd == tab_strip_prefetch_hwnd_ ||
+        env_.IsTabStripCached(hwnd)) {
+      return;
+    }
+    tab_strip_prefetch_hwnd_ = hwnd;
+    env_.PostTask(L"PrefetchTabStrip", [this, hwnd] {
+      tab_strip_prefetch_hwnd_ = {};
+      env_.PrefetchTabStrip(hwnd);
+    });
+  }
+
+  // Runs `then` once the tab strip of `hwnd` can be read. When
+  // `top_container_view` is not found, the find-in-page bar may be open and
+  // focused. Use `IsOnFindBarPane` to check if the click at `pt` occurred on
+  // the bar. If so, drop `then` to avoid interfering with find operations
+  // (#157). Otherwise, queue closing the bar and run `then` after it, to fix
+  // issues where double-click and right-click close actions fail when the bar
+  // is open (#187). Closing the bar typically has no side effects, except
+  // that clicks on other tabs or bookmarks will also dismiss the bar when it
+  // is open.
+  void WhenTabStripReadable(Window hwnd,
+                            Point pt,
+                            std::function<void()> then) {
+    if (env_.HasTopContainerView(hwnd)) {
+      then();
+      return;
+    }
+    if (env_.IsOnFindBarPane(pt)) {
+      return;
+    }
+    env_.QueueCommand(IDC_CLOSE_FIND_OR_STOP, hwnd, 1,
+                      [then = std::move(then)](bool ran) {
+                        if (ran) {
+                          then();
+                        }
+                      });
+  }
+
+  // For a right or middle button press at `pt`, whose release is decided
+  // from the cache. Unlike `QueueTabStripPrefetch`, this gets the find bar
+  // out of the way, as the click would close it anyway.
+  void QueueTabStripPressPrefetch(Window hwnd, Point pt) {
+    if (!hwnd || hwnd == tab_strip_prefetch_hwnd_ ||
+        env_.IsTabStripCached(hwnd)) {
+      return;
+    }
+    tab_strip_prefetch_hwnd_ = hwnd;
+    env_.PostTask(L"PrefetchTabStrip", [this, hwnd, pt] {
+      tab_strip_prefetch_hwnd_ = {};
+      WhenTabStripReadable(hwnd, pt,
+                           [this, hwnd] { env_.PrefetchTabStrip(hwnd); });
+    });
+  }
+
+  // Opens a new tab and closes the others instead of closing the last tab,
+  // which would close the window.
+  void KeepLastTab(Window hwnd) {
+    env_.QueueCommand(IDC_NEW_TAB, hwnd);
+    env_.QueueCommand(IDC_WINDOW_CLOSE_OTHER_TABS, hwnd);
+  }
+
+  bool IsOnlyOneTab(int tab_count) const {
+    return env_.config().IsKeepLastTab() && tab_count <= 1;
+  }
+
+  // Compared with `IsOnlyOneTab`, this function additionally implements tick
+  // fault tolerance to prevent users from directly closing the window when
+  // they click too fast.
+  bool IsNeedKeep(int tab_count) {
+    if (!env_.config().IsKeepLastTab()) {
+      return false;
+    }
+
+    bool keep_tab = (tab_count == 1);
+
+    uint64_t now = env_.Now();
+    uint64_t tick = now - std::exchange(last_closing_tab_tick_, now);
+
+    if (tick > 50 && tick <= 250 && tab_count == 2) {
+      keep_tab = true;
+    }
+
+    return keep_tab;
+  }
+
+  // Moves the selection of `hwnd` by `steps` tabs, wrapping around like the
+  // next and previous tab commands do.
+  void SwitchTabs(Window hwnd, int steps) {
+    if (steps == 0) {
+      return;
+    }
+    int step_command =
+        steps > 0 ? IDC_SELECT_NEXT_TAB : IDC_SELECT_PREVIOUS_TAB;
+    if (steps == 1 || steps == -1) {
+      env_.QueueCommand(step_command, hwnd);
+      return;
+    }
+
+    auto tabs = env_.GetTabs(hwnd);
+    auto selected_tab = std::ranges::find_if(
+        tabs, [](const auto& tab) { return tab.selected; });
+    if (selected_tab == tabs.end()) {
+      env_.QueueCommand(step_command, hwnd, std::abs(steps));
+      return;
+    }
+    int count = static_cast<int>(tabs.size());
+    int index = static_cast<int>(selected_tab - tabs.begin());
+    int target = ((index + steps) % count + count) % count;
+    if (target == index) {
+      return;
+    }
+    // The numbered commands count the tabs of collapsed groups, which are not
+    // in `tabs`.
+    if (env_.GetTabCount(hwnd) == count) {
+      if (target == count - 1) {
+        env_.QueueCommand(IDC_SELECT_LAST_TAB, hwnd);
+        return;
+      }
+      if (target <= IDC_SELECT_TAB_7 - IDC_SELECT_TAB_0) {
+        env_.QueueCommand(IDC_SELECT_TAB_0 + target, hwnd);
+        return;
+      }
+    }
+    env_.SelectTab(tabs[target]);
+  }
+
+  // Whether a wheel event at `pt` in `hwnd` continues the burst that is being
+  // collected.
+  bool IsInWheelBurst(Window hwnd, Point pt) const {
+    return wheel_switch_.timer != 0 && wheel_switch_.hwnd == hwnd &&
+           !IsBeyondDragThreshold(wheel_switch_.pt, pt);
+  }
+
+  void OnWheelSwitchTimer() {
+    wheel_switch_.timer = 0;
+    int steps = std::exchange(wheel_switch_.steps, 0);
+    SwitchTabs(wheel_switch_.hwnd, steps);
+  }
+
+  void AddWheelDelta(Window hwnd, Point pt, int z_delta) {
+    if (!IsInWheelBurst(hwnd, pt)) {
+      if (wheel_switch_.timer != 0) {
+        // Another window or place; the burst so far is applied as it is.
+        env_.StopTimer(wheel_switch_.timer);
+        wheel_switch_.timer = 0;
+        env_.PostTask(L"SwitchTabs",
+                      [this, hwnd = wheel_switch_.hwnd,
+                       steps = std::exchange(wheel_switch_.steps, 0)] {
+                        SwitchTabs(hwnd, steps);
+                      });
+      }
+      if (wheel_switch_.hwnd != hwnd) {
+        wheel_switch_.delta = 0;
+      }
+      wheel_switch_.hwnd = hwnd;
+      wheel_switch_.pt = pt;
+    }
+
+    // A partial notch in the other direction is dropped rather than
+    // cancelling part of the next one.
+    if ((wheel_switch_.delta < 0) != (z_delta < 0)) {
+      wheel_switch_.delta = 0;
+    }
+    wheel_switch_.delta += z_delta;
+    int notches = wheel_switch_.delta / kWheelDelta;
+    wheel_switch_.delta -= notches * kWheelDelta;
+    // Scrolling up selects the previous tab.
+    wheel_switch_.steps -= notches;
+    if (wheel_switch_.steps != 0 && wheel_switch_.timer == 0) {
+      wheel_switch_.timer =
+          env_.StartTimer(L"WheelSwitchTimerProc", kWheelCoalesceMs,
+                          [this] { OnWheelSwitchTimer(); });
+      if (wheel_switch_.timer == 0) {
+        env_.PostTask(L"SwitchTabs",
+                      [this, hwnd,
+                       steps = std::exchange(wheel_switch_.steps, 0)] {
+                        SwitchTabs(hwnd, steps);
+                      });
+      }
+    }
+  }
+
+  // Use the mouse wheel to switch tabs
+  bool HandleMouseWheel(Point pt, int z_delta) {
+    const auto& config = env_.config();
+    if (!config.IsWheelTab() && !config.IsWheelTabWhenPressRightButton()) {
+      return false;
+    }
+
+    Window hwnd = env_.FocusWindow();
+    Window top_hwnd = env_.TopWindow(hwnd);
+
+    auto switch_tabs = [&]() {
+      AddWheelDelta(top_hwnd, pt, z_delta);
+      return true;
+    };
+
+    // The rest of a burst goes where its first event went.
+    if (IsInWheelBurst(top_hwnd, pt)) {
+      return switch_tabs();
+    }
+
+    // If the mouse wheel is used to switch tabs when the mouse is on the tab
+    // bar.
+    if (config.IsWheelTab() && env_.IsOnTheTabBar(hwnd, pt)) {
+      return switch_tabs();
+    }
+
+    // If it is used to switch tabs when the right button is held.
+    if (config.IsWheelTabWhenPressRightButton() &&
+        env_.IsPressed(kVkRButton)) {
+      return switch_tabs();
+    }
+
+    return false;
+  }
+
+  // Double-click to close tab. The event is never swallowed, so this runs as
+  // a task after the hook has returned.
+  void HandleDoubleClick(Point pt) {
+    Window hwnd = env_.WindowFromPoint(pt);
+    WhenTabStripReadable(hwnd, pt, [this, hwnd, pt] {
+      TabStripHit hit = env_.HitTabStrip(hwnd, pt);
+      if (!hit.on_tab || hit.on_close_button) {
+        return;
+      }
+
+      if (IsOnlyOneTab(hit.tab_count)) {
+        KeepLastTab(hwnd);
+      } else {
+        env_.QueueCommand(IDC_CLOSE_TAB, hwnd);
+      }
+    });
+  }
+
+  // Whether a right click is to close the tab under it, in which case its
+  // press may close the find bar to read the tab strip.
+  bool ClosesTabOnRightClick() const {
+    return !env_.IsPressed(kVkShift) && env_.config().IsRightClickClose();
+  }
+
+  // Right-click to close tab (Hold Shift to show the original menu). The
+  // press has read the tab strip into the cache, which the release is decided
+  // from; if that failed, the event is passed on.
+  bool HandleRightClick(Point pt) {
+    if (!ClosesTabOnRightClick()) {
+      return false;
+    }
+
+    Window hwnd = env_.WindowFromPoint(pt);
+    std::optional<TabStripHit> hit = env_.HitCachedTabStrip(hwnd, pt);
+    if (!hit || !hit->on_tab) {
+      return false;
+    }
+
+    if (IsNeedKeep(hit->tab_count)) {
+      KeepLastTab(hwnd);
+    } else {
+      // The synthesized events carry `GetMagicCode()` as their
+      // `dwExtraInfo`, so that the hook lets them through.
+      env_.template SendKeys<kVkMButton>();
+    }
+    return true;
+  }
+
+  // Preserve the last tab when the middle button is clicked on the tab.
+  // Decided from the cache, like `HandleRightClick`.
+  bool HandleMiddleClick(Point pt) {
+    Window hwnd = env_.WindowFromPoint(pt);
+    std::optional<TabStripHit> hit = env_.HitCachedTabStrip(hwnd, pt);
+    if (!hit) {
+      return false;
+    }
+
+    bool is_on_one_tab = hit->on_tab;
+    bool keep_tab = IsNeedKeep(hit->tab_count);
+
+    if (is_on_one_tab && keep_tab) {
+      KeepLastTab(hwnd);
+      return true;
+    }
+
+    return false;
+  }
+
+  void OnMouseMove(Point pt) {
+    const auto& config = env_.config();
+    if (config.IsWheelTab()) {
+      // Read the tab strip when the pointer enters it, so that the wheel
+      // events that follow are decided from the cache. Until it has been read
+      // once, a button down or the first wheel event does that.
+      Window hwnd = env_.FocusWindow();
+      bool on_tab_strip = env_.IsInCachedTabStrip(hwnd, pt).value_or(false);
+      if (on_tab_strip && !pointer_on_tab_strip_) {
+        QueueTabStripPrefetch(hwnd);
+      }
+      pointer_on_tab_strip_ = on_tab_strip;
+    }
+    if (!IsDragNewTabEnabled()) {
+      return;
+    }
+    Window hwnd = GetDragWindow(pt);
+    std::optional<bool> in_tab_strip = env_.IsInCachedTabStrip(hwnd, pt);
+    if (!in_tab_strip) {
+      // Left to the moves after the tab strip has been read.
+      QueueTabStripPrefetch(hwnd);
+      return;
+    }
+    bool is_on_tab_bar = *in_tab_strip;
+    bool has_down_point = HasValidLButtonDownPoint();
+    bool drag_started_on_tab_bar = has_down_point && lbutton_down_on_tab_bar_;
+    if (is_on_tab_bar && env_.IsPressed(kVkLButton) &&
+        !drag_started_on_tab_bar) {
+      bool from_outside = !last_on_tab_bar_;
+      bool dragged_from_down =
+          has_down_point && IsBeyondDragThreshold(lbutton_down_point_, pt);
+      if (from_outside || dragged_from_down || !has_down_point) {
+        if (!drag_armed_ || drag_hwnd_ != hwnd) {
+          QueueDragNewTabInit(hwnd);
+        }
+        drag_armed_ = true;
+      }
+    }
+    last_on_tab_bar_ = is_on_tab_bar;
+  }
+
+  // Reading every tab is too slow for the hook, so the tabs a drag starts
+  // from are recorded by a task.
+  void QueueDragNewTabInit(Window hwnd) {
+    drag_hwnd_ = hwnd;
+    env_.PostTask(L"InitDragNewTabState", [this, hwnd] {
+      if (!env_.InitDragNewTab(hwnd)) {
+        // Tried again by the next move over the tab strip.
+        drag_armed_ = false;
+      }
+    });
+  }
+
+  void QueueBookmarkPrefetch(Point pt) {
+    bookmark_press_ = {};
+    if (env_.config().GetBookmarkNewTabMode() == 0) {
+      return;
+    }
+    Window hwnd = env_.WindowFromPoint(pt);
+    bookmark_press_.hwnd = hwnd;
+    bookmark_press_.pt = pt;
+    env_.PostTask(L"PrefetchBookmark", [this, hwnd, pt] {
+      bookmark_press_.on_bookmark = env_.IsOnClickableBookmark(hwnd, pt);
+      bookmark_press_.on_new_tab =
+          bookmark_press_.on_bookmark && env_.IsBookmarkOpenedOnNewTab();
+      bookmark_press_.ready = true;
+    });
+  }
+
+  // Open bookmarks in a new tab.
+  bool HandleBookmark(Point pt) {
+    int mode = env_.config().GetBookmarkNewTabMode();
+    BookmarkPress press = std::exchange(bookmark_press_, {});
+    if (env_.IsPressed(kVkControl) || env_.IsPressed(kVkShift) || mode == 0) {
+      return false;
+    }
+
+    Window hwnd = env_.WindowFromPoint(pt);
+
+    bool on_bookmark = false;
+    bool on_new_tab = false;
+    if (press.ready && press.hwnd == hwnd &&
+        !IsBeyondDragThreshold(press.pt, pt)) {
+      // Released where it was pressed, which has been looked up already.
+      on_bookmark = press.on_bookmark;
+      on_new_tab = press.on_new_tab;
+    } else {
+      on_bookmark = env_.IsOnClickableBookmark(hwnd, pt);
+      on_new_tab = on_bookmark && env_.IsBookmarkOpenedOnNewTab();
+    }
+
+    if (on_bookmark && !on_new_tab) {
+      if (mode == 1) {
+        env_.template SendKeys<kVkMButton, kVkShift>();
+      } else if (mode == 2) {
+        env_.template SendKeys<kVkMButton>();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void OnLButtonDown(Point pt) {
+    if (env_.config().IsWheelTab()) {
+      QueueTabStripPrefetch(env_.FocusWindow());
+    }
+    lbutton_down_point_ = pt;
+    lbutton_down_on_tab_bar_ = false;
+    if (IsDragNewTabEnabled()) {
+      Window hwnd = GetDragWindow(pt);
+      env_.PostTask(L"CheckLButtonDownOnTabBar", [this, hwnd, pt] {
+        lbutton_down_on_tab_bar_ = env_.IsOnTheTabBar(hwnd, pt);
+      });
+    }
+    QueueBookmarkPrefetch(pt);
+    drag_armed_ = false;
+    env_.CancelDragNewTab();
+  }
+
+  bool OnLButtonUp(Point pt) {
+    if (IsDragNewTabEnabled() && drag_armed_) {
+      Window hwnd = GetDragWindow(pt);
+      // Arming found the pointer on the cached tab strip, so its bounds are
+      // known. Without the rest of the map, the drop is taken as not being on
+      // a new tab button.
+      std::optional<TabStripHit> hit = env_.HitCachedTabStrip(hwnd, pt);
+      if (env_.IsInCachedTabStrip(hwnd, pt).value_or(false) &&
+          !(hit && hit->on_new_tab_button)) {
+        drag_armed_ = false;
+        env_.PostTask(L"QueueDragNewTabCheck",
+                      [this, hwnd, pt] { env_.CheckDragNewTab(hwnd, pt); });
+        return false;
+      }
+    }
+    drag_armed_ = false;
+    lbutton_down_on_tab_bar_ = false;
+    lbutton_down_point_ = {-1, -1};
+    return HandleBookmark(pt);
+  }
+
+  // Reads the tab strip of the focused window when Ctrl goes down, so that a
+  // Ctrl+W or Ctrl+F4 that follows is decided from the cache.
+  void QueueKeepTabPrefetch(uint32_t vk, bool repeat) {
+    if (vk != kVkControl || repeat || !env_.config().IsKeepLastTab()) {
+      return;
+    }
+    QueueTabStripPrefetch(env_.RootWindow(env_.FocusWindow()));
+  }
+
+  bool HandleKeepTab(uint32_t vk) {
+    if (!(vk == 'W' && env_.IsPressed(kVkControl) &&
+          !env_.IsPressed(kVkShift)) &&
+        !(vk == kVkF4 && env_.IsPressed(kVkControl))) {
+      return false;
+    }
+    if (!env_.config().IsKeepLastTab()) {
+      return false;
+    }
+
+    Window hwnd = env_.FocusWindow();
+    if (!env_.IsBrowserWindow(hwnd)) {
+      return false;
+    }
+
+    bool full_screen = env_.IsFullScreen(hwnd);
+    hwnd = env_.RootWindow(hwnd);
+    auto queue_show_tab_strip = [&](std::function<void(bool)> done = {}) {
+      if (full_screen) {
+        // Have to exit full screen to find the tab.
+        env_.QueueCommand(IDC_FULLSCREEN, hwnd);
+      }
+      env_.QueueCommand(IDC_CLOSE_FIND_OR_STOP, hwnd, 1, std::move(done));
+    };
+
+    if (std::optional<int> tab_count = env_.GetCachedTabCount(hwnd)) {
+      if (!IsNeedKeep(*tab_count)) {
+        return false;
+      }
+      queue_show_tab_strip();
+      KeepLastTab(hwnd);
+      return true;
+    }
+
+    // The tab strip could not be read when Ctrl went down, as when full
+    // screen or the find bar hides it. The key is taken, and the tab closed
+    // or kept once both are out of the way.
+    queue_show_tab_strip([this, hwnd](bool ran) {
+      if (!ran) {
+        return;
+      }
+      if (IsNeedKeep(env_.GetTabCount(hwnd))) {
+        KeepLastTab(hwnd);
+      } else {
+        env_.QueueCommand(IDC_CLOSE_TAB, hwnd);
+      }
+    });
+    return true;
+  }
+
+  // Reads whether the omnibox has focus after every key press and click,
+  // which are what move the focus, so that Enter is decided without walking
+  // the tree.
+  void QueueOmniboxPrefetch() {
+    if (env_.config().GetOpenUrlNewTabMode() == 0 ||
+        omnibox_prefetch_queued_) {
+      return;
+    }
+    omnibox_prefetch_queued_ = true;
+    env_.PostTask(L"PrefetchOmnibox", [this] {
+      omnibox_prefetch_queued_ = false;
+      Window hwnd = env_.ForegroundWindow();
+      omnibox_state_ = {hwnd,
+                        env_.IsOmniboxFocus(hwnd) && !env_.IsOnNewTab(hwnd)};
+    });
+  }
+
+  bool HandleOpenUrlNewTab(uint32_t vk) {
+    int mode = env_.config().GetOpenUrlNewTabMode();
+    if (!(mode != 0 && vk == kVkReturn && !env_.IsPressed(kVkMenu))) {
+      return false;
+    }
+
+    // A window that has not had a key or a click since it came to the
+    // foreground is left alone.
+    if (omnibox_state_.hwnd == env_.ForegroundWindow() &&
+        omnibox_state_.open_in_new_tab) {
+      if (mode == 1) {
+        env_.template SendKeys<kVkMenu, kVkReturn>();
+      } else if (mode == 2) {
+        env_.template SendKeys<kVkShift, kVkMenu, kVkReturn>();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  // Keys bound in the config, with `action` being what the key matched in the
+  // table. Unbound keys fall through after that single lookup.
+  bool HandleKeyBinding(KeyAction action) {
+    switch (action) {
+      case KeyAction::kTranslate:
+        env_.QueueCommand(IDC_SHOW_TRANSLATE, Window{}, 1, [this](bool ran) {
+          if (ran) {
+            env_.template SendKeys<kVkRight>();
+          }
+        });
+        return true;
+      case KeyAction::kSwitchToPrev:
+        env_.QueueCommand(IDC_SELECT_PREVIOUS_TAB, Window{});
+        return true;
+      case KeyAction::kSwitchToNext:
+        env_.QueueCommand(IDC_SELECT_NEXT_TAB, Window{});
+        return true;
+      case KeyAction::kNone:
+        break;
+    }
+    return false;
+  }
+
+  Env& env_;
+
+  Point lbutton_down_point_ = {-1, -1};
+  bool lbutton_down_on_tab_bar_ = false;
+  bool last_on_tab_bar_ = false;
+  bool pointer_on_tab_strip_ = false;
+  bool wheel_tab_ing_with_rbutton_ = false;
+  // The window a tab strip prefetch is queued for.
+  Window tab_strip_prefetch_hwnd_{};
+  uint64_t last_closing_tab_tick_ = 0;
+
+  // Whether the left button is dragging something over the tab strip of
+  // `drag_hwnd_`, which may be dropped there to open a new tab.
+  bool drag_armed_ = false;
+  Window drag_hwnd_{};
+
+  WheelSwitch wheel_switch_;
+  BookmarkPress bookmark_press_;
+  OmniboxState omnibox_state_;
+  bool omnibox_prefetch_queued_ = false;
+};
+
+#endif  // CHROME_PLUS_SRC_TABHOOKS_H_
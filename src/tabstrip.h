@@ -0,0 +1,127 @@
+#ifndef CHROME_PLUS_SRC_TABSTRIP_H_
+#define CHROME_PLUS_SRC_TABSTRIP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "accessibletree.h"
+
+// The screen geometry of a tab strip that the hooks hit-test against instead
+// of walking the accessibility tree on every event, written against
+// `AccessibleTree` so that it does not depend on Windows.
+
+inline constexpr long kStateCollapsed = 0x400;
+
+// Upper bound for how long the tab strip of a window is trusted. Tab list
+// changes caused by user input invalidate it; this only bounds the damage
+// from changes made by pages themselves.
+inline constexpr uint64_t kWindowCacheMaxAgeMs = 2000;
+// Chrome animates the tab strip after tabs are opened or closed, so strips
+// read shortly after an invalidation are read again once the animation has
+// settled.
+inline constexpr uint64_t kUIRegionSettleMs = 300;
+
+// What lies under a point on the tab strip.
+struct TabStripHit {
+  bool on_tab = false;
+  bool on_close_button = false;
+  bool on_new_tab_button = false;
+  // Like `GetTabCount`, collapsed tab groups count as one tab.
+  int tab_count = 0;
+};
+
+// `Item` has a `rect` and is built from a rectangle and the node it belongs
+// to.
+template <typename Rect, typename Item>
+struct TabStripRegions {
+  Rect tab_strip = {};
+  bool horizontal = true;
+  RegionIndex<Item> tabs;
+  RegionIndex<Item> close_buttons;
+  std::vector<Rect> new_tab_buttons;
+  // Collapsed tab groups count as one tab.
+  int tab_count = 0;
+};
+
+bool IsHorizontal(const auto& rect) {
+  return (rect.right - rect.left) >= (rect.bottom - rect.top);
+}
+
+// Reads the tab strip below `top`: its bounds and new tab buttons, then every
+// tab with its close button. Returns false if there is no tab strip.
+template <AccessibleTree Tree, typename Item>
+bool BuildTabStripRegions(const Tree& tree,
+                          const typename Tree::Node& top,
+                          TabStripRegions<typename Tree::Rect, Item>& map) {
+  using Node = typename Tree::Node;
+  map = {};
+  Node page_tab_list = FindElementWithRole(tree, top, kRolePageTabList);
+  if (!page_tab_list) {
+    return false;
+  }
+  if (auto rect = tree.Location(page_tab_list)) {
+    map.tab_strip = *rect;
+  }
+  map.horizontal = IsHorizontal(map.tab_strip);
+
+  tree.ForEachChild(page_tab_list, [&](const Node& child) {
+    if (tree.Role(child) == kRolePushButton) {
+      if (auto rect = tree.Location(child)) {
+        map.new_tab_buttons.push_back(*rect);
+      }
+    }
+    return false;
+  });
+
+  Node page_tab = FindElementWithRole(tree, page_tab_list, kRolePageTab);
+  Node page_tab_pane = page_tab ? tree.Parent(page_tab) : Node{};
+  auto collect_close_buttons = [&](this auto&& self, const Node& node) -> bool {
+    if (tree.Role(node) == kRolePushButton) {
+      if (auto rect = tree.Location(node)) {
+        map.close_buttons.items.push_back({*rect, node});
+      }
+      return false;
+    }
+    tree.ForEachChild(node, self);
+    return false;
+  };
+  if (page_tab_pane) {
+    tree.ForEachChild(page_tab_pane, [&](const Node& child) {
+      long role = tree.Role(child);
+      if (role == kRolePageTabList && (tree.State(child) & kStateCollapsed)) {
+        ++map.tab_count;
+        return false;
+      }
+      if (role != kRolePageTab) {
+        return false;
+      }
+      ++map.tab_count;
+      if (auto rect = tree.Location(child)) {
+        map.tabs.items.push_back({*rect, child});
+      }
+      tree.ForEachChild(child, collect_close_buttons);
+      return false;
+    });
+  }
+
+  SortRegions(map.tabs, map.horizontal);
+  SortRegions(map.close_buttons, map.horizontal);
+  return true;
+}
+
+template <typename Rect, typename Item>
+TabStripHit HitTabStrip(const TabStripRegions<Rect, Item>& map,
+                        const auto& pt) {
+  TabStripHit hit;
+  hit.on_tab = HitRegion(map.tabs, map.horizontal, pt) != nullptr;
+  hit.on_close_button =
+      HitRegion(map.close_buttons, map.horizontal, pt) != nullptr;
+  hit.on_new_tab_button = std::ranges::any_of(
+      map.new_tab_buttons,
+      [&pt](const Rect& rect) { return RectContains(rect, pt); });
+  hit.tab_count = map.tab_count;
+  return hit;
+}
+
+#endif  // CHROME_PLUS_SRC_TABSTRIP_H_
@@ -0,0 +1,245 @@
+#include "uiatabs.h"
+
+#include <windows.h>
+
+#include <oleacc.h>
+#include <uiautomation.h>
+#include <wrl/client.h>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "hash.h"
+#include "utils.h"
+
+namespace {
+
+// Both objects are created once and never released, since the hooks may still
+// run while COM is being torn down at exit.
+IUIAutomation* GetAutomation() {
+  static IUIAutomation* automation = []() -> IUIAutomation* {
+    IUIAutomation* automation = nullptr;
+    HRESULT hr = CoCreateInstance(__uuidof(CUIAutomation), nullptr,
+                                  CLSCTX_INPROC_SERVER,
+                                  IID_PPV_ARGS(&automation));
+    if (FAILED(hr)) {
+      DebugLog(L"Create IUIAutomation failed: {:#x}", static_cast<ULONG>(hr));
+      return nullptr;
+    }
+    return automation;
+  }();
+  return automation;
+}
+
+IUIAutomationCacheRequest* GetTabStripCacheRequest(IUIAutomation* automation) {
+  static IUIAutomationCacheRequest* request =
+      [automation]() -> IUIAutomationCacheRequest* {
+    IUIAutomationCacheRequest* request = nullptr;
+    if (FAILED(automation->CreateCacheRequest(&request))) {
+      return nullptr;
+    }
+    for (PROPERTYID id : {UIA_ControlTypePropertyId,
+                          UIA_BoundingRectanglePropertyId, UIA_NamePropertyId,
+                          UIA_SelectionItemIsSelectedPropertyId,
+                          UIA_LegacyIAccessibleStatePropertyId,
+                          UIA_RuntimeIdPropertyId}) {
+      request->AddProperty(id);
+    }
+    // Needed to hand tabs back to the MSAA code as `IAccessible`.
+    request->AddPattern(UIA_LegacyIAccessiblePatternId);
+    request->put_TreeScope(TreeScope_Subtree);
+    // Match the MSAA tree, which has the panes the tabs live in.
+    IUIAutomationCondition* raw_view = nullptr;
+    if (SUCCEEDED(automation->get_RawViewCondition(&raw_view))) {
+      request->put_TreeFilter(raw_view);
+      raw_view->Release();
+    }
+    return request;
+  }();
+  return request;
+}
+
+long GetCachedLong(IUIAutomationElement* element, PROPERTYID id) {
+  VARIANT value;
+  VariantInit(&value);
+  long result = 0;
+  if (SUCCEEDED(element->GetCachedPropertyValue(id, &value)) &&
+      value.vt == VT_I4) {
+    result = value.lVal;
+  }
+  VariantClear(&value);
+  return result;
+}
+
+bool GetCachedBool(IUIAutomationElement* element, PROPERTYID id) {
+  VARIANT value;
+  VariantInit(&value);
+  bool result = false;
+  if (SUCCEEDED(element->GetCachedPropertyValue(id, &value)) &&
+      value.vt == VT_BOOL) {
+    result = value.boolVal == VARIANT_TRUE;
+  }
+  VariantClear(&value);
+  return result;
+}
+
+RECT GetCachedRect(IUIAutomationElement* element) {
+  RECT rect = {};
+  element->get_CachedBoundingRectangle(&rect);
+  return rect;
+}
+
+std::wstring GetCachedName(IUIAutomationElement* element) {
+  std::wstring name;
+  BSTR bstr = nullptr;
+  if (SUCCEEDED(element->get_CachedName(&bstr)) && bstr) {
+    name.assign(bstr, SysStringLen(bstr));
+  }
+  SysFreeString(bstr);
+  return name;
+}
+
+// Runtime IDs stay the same for as long as the element lives. Returns 0 if
+// there is none.
+uint64_t GetCachedRuntimeIdKey(IUIAutomationElement* element) {
+  VARIANT value;
+  VariantInit(&value);
+  uint64_t key = 0;
+  LONG lower = 0;
+  LONG upper = -1;
+  int* ids = nullptr;
+  if (SUCCEEDED(
+          element->GetCachedPropertyValue(UIA_RuntimeIdPropertyId, &value)) &&
+      value.vt == (VT_ARRAY | VT_I4) &&
+      SUCCEEDED(SafeArrayGetLBound(value.parray, 1, &lower)) &&
+      SUCCEEDED(SafeArrayGetUBound(value.parray, 1, &upper)) &&
+      upper >= lower &&
+      SUCCEEDED(SafeArrayAccessData(value.parray,
+                                    reinterpret_cast<void**>(&ids)))) {
+    key = HashBytes({reinterpret_cast<const uint8_t*>(ids),
+                     (upper - lower + 1) * sizeof(int)});
+    SafeArrayUnaccessData(value.parray);
+  }
+  VariantClear(&value);
+  return key;
+}
+
+// Keys the tabs that have no runtime ID by their name and by how many tabs
+// of the same name come before them.
+void FillMissingTabKeys(std::vector<UIATabStrip::Tab>& tabs) {
+  std::unordered_map<std::wstring_view, uint32_t> seen;
+  for (auto& tab : tabs) {
+    uint32_t position = seen[tab.name]++;
+    if (tab.key != 0) {
+      continue;
+    }
+    std::wstring text = std::to_wstring(UIA_TabItemControlTypeId) + L'\n' +
+                        tab.name + L'\n' + std::to_wstring(position);
+    tab.key = HashBytes({reinterpret_cast<const uint8_t*>(text.data()),
+                         text.size() * sizeof(wchar_t)});
+  }
+}
+
+// Walks the cached tree the same way the MSAA code walks the live one:
+// invisible nodes are skipped, buttons directly below the tab list are new tab
+// buttons and buttons inside a tab are close buttons.
+void CollectTabStrip(IUIAutomationElement* parent,
+                     bool is_tab_list,
+                     bool in_tab,
+                     UIATabStrip& strip) {
+  Microsoft::WRL::ComPtr<IUIAutomationElementArray> children;
+  if (FAILED(parent->GetCachedChildren(&children)) || !children) {
+    return;
+  }
+  int length = 0;
+  children->get_Length(&length);
+  for (int i = 0; i < length; ++i) {
+    ElementPtr child;
+    if (FAILED(children->GetElement(i, &child)) || !child) {
+      continue;
+    }
+    long state =
+        GetCachedLong(child.Get(), UIA_LegacyIAccessibleStatePropertyId);
+    if (state & STATE_SYSTEM_INVISIBLE) {
+      continue;
+    }
+
+    switch (GetCachedLong(child.Get(), UIA_ControlTypePropertyId)) {
+      case UIA_TabItemControlTypeId:
+        if (!in_tab) {
+          strip.tabs.push_back(
+              {GetCachedRect(child.Get()),
+               GetCachedBool(child.Get(),
+                             UIA_SelectionItemIsSelectedPropertyId),
+               GetCachedName(child.Get()), child,
+               GetCachedRuntimeIdKey(child.Get())});
+          CollectTabStrip(child.Get(), false, true, strip);
+        }
+        break;
+      case UIA_ButtonControlTypeId:
+        if (in_tab) {
+          strip.close_buttons.push_back(GetCachedRect(child.Get()));
+        } else if (is_tab_list) {
+          strip.new_tab_buttons.push_back(
+              {GetCachedRect(child.Get()), GetCachedName(child.Get())});
+        }
+        break;
+      case UIA_TabControlTypeId:
+        if (!in_tab && (state & STATE_SYSTEM_COLLAPSED)) {
+          ++strip.collapsed_groups;
+          break;
+        }
+        CollectTabStrip(child.Get(), false, in_tab, strip);
+        break;
+      default:
+        CollectTabStrip(child.Get(), false, in_tab, strip);
+        break;
+    }
+  }
+}
+
+}  // namespace
+
+bool ReadUIATabStrip(IAccessible* page_tab_list, UIATabStrip& strip) {
+  strip = {};
+  IUIAutomation* automation = GetAutomation();
+  IUIAutomationCacheRequest* request =
+      automation ? GetTabStripCacheRequest(automation) : nullptr;
+  if (!page_tab_list || !request) {
+    return false;
+  }
+
+  ElementPtr tab_list;
+  ++strip.com_calls;
+  HRESULT hr = automation->ElementFromIAccessibleBuildCache(
+      page_tab_list, CHILDID_SELF, request, &tab_list);
+  if (FAILED(hr) || !tab_list) {
+    DebugLog(L"ElementFromIAccessibleBuildCache failed: {:#x}",
+             static_cast<ULONG>(hr));
+    return false;
+  }
+  strip.bounds = GetCachedRect(tab_list.Get());
+  CollectTabStrip(tab_list.Get(), true, false, strip);
+  FillMissingTabKeys(strip.tabs);
+  return true;
+}
+
+NodePtr GetUIAElementAccessible(IUIAutomationElement* element) {
+  if (!element) {
+    return nullptr;
+  }
+  Microsoft::WRL::ComPtr<IUIAutomationLegacyIAccessiblePattern> pattern;
+  if (FAILED(element->GetCachedPatternAs(UIA_LegacyIAccessiblePatternId,
+                                         IID_PPV_ARGS(&pattern))) ||
+      !pattern) {
+    return nullptr;
+  }
+  NodePtr node;
+  if (FAILED(pattern->GetIAccessible(&node)) || !node) {
+    return nullptr;
+  }
+  return node;
+}
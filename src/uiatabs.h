@@ -0,0 +1,56 @@
+#ifndef CHROME_PLUS_SRC_UIATABS_H_
+#define CHROME_PLUS_SRC_UIATABS_H_
+
+#include <windows.h>
+
+#include <uiautomation.h>
+#include <wrl/client.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "iaccessible.h"
+
+using ElementPtr = Microsoft::WRL::ComPtr<IUIAutomationElement>;
+
+// The tab strip of one window, read through UI Automation. Everything below
+// comes from the cache filled in by a single call, so reading it costs no
+// further calls into the browser.
+struct UIATabStrip {
+  struct Tab {
+    RECT rect = {};
+    bool selected = false;
+    std::wstring name;
+    ElementPtr element;
+    // See `TabKey`. Hashed from the runtime ID of the element, or from its
+    // name and its position among the tabs of the same name if the browser
+    // reports no runtime ID.
+    uint64_t key = 0;
+  };
+
+  struct Button {
+    RECT rect = {};
+    std::wstring name;
+  };
+
+  RECT bounds = {};
+  // In tree order.
+  std::vector<Tab> tabs;
+  std::vector<RECT> close_buttons;
+  std::vector<Button> new_tab_buttons;
+  // Tab groups collapsed into their header, which count as one tab each.
+  int collapsed_groups = 0;
+  // Calls made into the browser to read the strip.
+  uint32_t com_calls = 0;
+};
+
+// Reads the subtree of `page_tab_list` with a single
+// `ElementFromIAccessibleBuildCache` call. Must be called on a thread that
+// initialized COM.
+bool ReadUIATabStrip(IAccessible* page_tab_list, UIATabStrip& strip);
+
+// Returns the `IAccessible` behind an element of a strip, or nullptr.
+NodePtr GetUIAElementAccessible(IUIAutomationElement* element);
+
+#endif  // CHROME_PLUS_SRC_UIATABS_H_
@@ -0,0 +1,99 @@
+#include "uitask.h"
+
+#include <windows.h>
+
+#include <deque>
+#include <functional>
+#include <string_view>
+#include <utility>
+
+#include "config.h"
+#include "iaccessible.h"
+#include "utils.h"
+
+namespace {
+
+constexpr wchar_t kUITaskWindowClass[] = L"ChromePlusUITask";
+constexpr UINT kRunUITasksMessage = WM_APP + 1;
+
+struct UITask {
+  std::wstring_view name;
+  std::function<void()> run;
+};
+
+// Only touched from the thread that owns the window.
+HWND task_window = nullptr;
+std::deque<UITask> pending_tasks;
+bool run_posted = false;
+
+void RunUITask(const UITask& task) {
+  ConfigReadScope config_scope;
+  AccessibleSnapshotScope accessible_scope(task.name);
+  task.run();
+}
+
+void RunUITasks() {
+  run_posted = false;
+  // Tasks queued by these wait for the next message, so that a task that keeps
+  // queueing more cannot starve input.
+  std::deque<UITask> tasks;
+  tasks.swap(pending_tasks);
+  for (const auto& task : tasks) {
+    RunUITask(task);
+  }
+}
+
+LRESULT CALLBACK UITaskWindowProc(HWND hwnd,
+                                  UINT message,
+                                  WPARAM wparam,
+                                  LPARAM lparam) {
+  if (message == kRunUITasksMessage) {
+    RunUITasks();
+    return 0;
+  }
+  if (message == WM_SETTINGCHANGE) {
+    InvalidateMouseButtonSwap();
+  }
+  return DefWindowProcW(hwnd, message, wparam, lparam);
+}
+
+}  // namespace
+
+void InitUITasks() {
+  if (task_window) {
+    return;
+  }
+  WNDCLASSEXW window_class = {sizeof(window_class)};
+  window_class.lpfnWndProc = UITaskWindowProc;
+  window_class.hInstance = hInstance;
+  window_class.lpszClassName = kUITaskWindowClass;
+  if (!RegisterClassExW(&window_class) &&
+      GetLastError() != ERROR_CLASS_ALREADY_EXISTS) {
+    DebugLog(L"InitUITasks failed: RegisterClassExW error {}", GetLastError());
+    return;
+  }
+  // A hidden top-level window rather than a message-only one, which would not
+  // get the `WM_SETTINGCHANGE` broadcasts.
+  task_window =
+      CreateWindowExW(WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE, kUITaskWindowClass,
+                      L"", WS_POPUP, 0, 0, 0, 0, nullptr, nullptr, hInstance,
+                      nullptr);
+  if (!task_window) {
+    DebugLog(L"InitUITasks failed: CreateWindowExW error {}", GetLastError());
+  }
+}
+
+void PostUITask(std::wstring_view name, std::function<void()> task) {
+  if (!task_window) {
+    RunUITask({name, std::move(task)});
+    return;
+  }
+  pending_tasks.push_back({name, std::move(task)});
+  if (!run_posted) {
+    run_posted = PostMessageW(task_window, kRunUITasksMessage, 0, 0);
+    if (!run_posted) {
+      // The message queue is full; run the tasks now rather than lose them.
+      RunUITasks();
+    }
+  }
+}
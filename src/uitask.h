@@ -0,0 +1,19 @@
+#ifndef CHROME_PLUS_SRC_UITASK_H_
+#define CHROME_PLUS_SRC_UITASK_H_
+
+#include <functional>
+#include <string_view>
+
+// Work handed off by the hook callbacks so that they can return at once. The
+// tasks run in order on the thread that called `InitUITasks`, from a message
+// posted to a hidden window. Posted messages are retrieved before input, so
+// the tasks queued for one input event have run before the hooks see the next
+// one. The window also passes system setting changes on to the caches that
+// depend on them.
+void InitUITasks();
+
+// `name` names the task in the debug log and must outlive it. Runs `task` at
+// once if the window could not be created.
+void PostUITask(std::wstring_view name, std::function<void()> task);
+
+#endif  // CHROME_PLUS_SRC_UITASK_H_
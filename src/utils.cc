@@ -6,6 +6,7 @@
 #include <shlwapi.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdarg>
 #include <cstdio>
@@ -76,35 +77,6 @@ std::vector<std::string> StringSplit(std::string_view str,
   return result;
 }
 
-// Compression html.
-std::string& ltrim(std::string& s) {
-  auto it = std::ranges::find_if_not(
-      s, [](unsigned char c) { return std::isspace(c); });
-  s.erase(s.begin(), it);
-  return s;
-}
-
-std::string& rtrim(std::string& s) {
-  auto reversed_view = s | std::views::reverse;
-  auto it = std::ranges::find_if_not(
-      reversed_view, [](unsigned char c) { return std::isspace(c); });
-  s.erase(it.base(), s.end());
-  return s;
-}
-
-std::string& trim(std::string& s) {
-  return ltrim(rtrim(s));
-}
-
-void compression_html(std::string& html) {
-  auto lines = StringSplit(html, '\n');
-  html.clear();
-  for (auto& line : lines) {
-    html += "\n";
-    html += trim(line);
-  }
-}
-
 bool ReplaceStringInPlace(std::string& subject,
                           std::string_view search,
                           std::string_view replace) {
@@ -166,25 +138,6 @@ uint8_t* memmem(uint8_t* src, int n, const uint8_t* sub, int m) {
   return const_cast<uint8_t*>(FastSearch(src, n, sub, m));
 }
 
-std::wstring GetIniString(std::wstring_view section,
-                          std::wstring_view key,
-                          std::wstring_view default_value) {
-  std::vector<TCHAR> buffer(100);
-  DWORD bytesread = 0;
-  do {
-    bytesread = ::GetPrivateProfileStringW(
-        section.data(), key.data(), default_value.data(), buffer.data(),
-        static_cast<DWORD>(buffer.size()), GetIniPath().c_str());
-    if (bytesread >= buffer.size() - 1) {
-      buffer.resize(buffer.size() * 2);
-    } else {
-      break;
-    }
-  } while (true);
-
-  return std::wstring(buffer.data());
-}
-
 std::wstring CanonicalizePath(const std::wstring& path) {
   TCHAR temp[MAX_PATH];
   ::PathCanonicalize(temp, path.data());
@@ -259,3 +212,23 @@ bool IsFullScreen(HWND hwnd) {
            windowRect.right == GetSystemMetrics(SM_CXSCREEN) &&
            windowRect.bottom == GetSystemMetrics(SM_CYSCREEN)));
 }
+
+namespace {
+
+// -1 until the setting has been read.
+std::atomic<int> mouse_buttons_swapped = -1;
+
+}  // namespace
+
+bool AreMouseButtonsSwapped() {
+  int swapped = mouse_buttons_swapped.load(std::memory_order_relaxed);
+  if (swapped < 0) {
+    swapped = GetSystemMetrics(SM_SWAPBUTTON) ? 1 : 0;
+    mouse_buttons_swapped.store(swapped, std::memory_order_relaxed);
+  }
+  return swapped != 0;
+}
+
+void InvalidateMouseButtonSwap() {
+  mouse_buttons_swapped.store(-1, std::memory_order_relaxed);
+}
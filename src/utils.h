@@ -8,7 +8,9 @@
 #include <string_view>
 #include <vector>
 
+#include "commandids.h"
 #include "fastsearch.h"
+#include "inputsequence.h"
 
 // Global variable declaration
 extern HMODULE hInstance;
@@ -18,28 +20,13 @@ consteval uint32_t GetMagicCode() {
   return 0x1603ABD9;
 }
 
-// Chrome command IDs
-// https://source.chromium.org/chromium/chromium/src/+/main:chrome/app/chrome_command_ids.h?q=chrome_command_ids.h&ss=chromium%2Fchromium%2Fsrc
-#define IDC_NEW_TAB 34014
-#define IDC_CLOSE_TAB 34015
-#define IDC_SELECT_NEXT_TAB 34016
-#define IDC_SELECT_PREVIOUS_TAB 34017
-#define IDC_SELECT_TAB_0 34018
-#define IDC_SELECT_TAB_1 34019
-#define IDC_SELECT_TAB_2 34020
-#define IDC_SELECT_TAB_3 34021
-#define IDC_SELECT_TAB_4 34022
-#define IDC_SELECT_TAB_5 34023
-#define IDC_SELECT_TAB_6 34024
-#define IDC_SELECT_TAB_7 34025
-#define IDC_SELECT_LAST_TAB 34026
-#define IDC_FULLSCREEN 34030
-#define IDC_MOVE_TAB_NEXT 34032
-#define IDC_MOVE_TAB_PREVIOUS 34033
-#define IDC_SHOW_TRANSLATE 35009
-#define IDC_WINDOW_CLOSE_OTHER_TABS 35023
-#define IDC_CLOSE_FIND_OR_STOP 37003
-#define IDC_UPGRADE_DIALOG 40024
+#define KEY_PRESSED 0x8000
+
+// Whether `key` is held down, as far as the input this thread has processed
+// tells.
+inline bool IsPressed(int key) {
+  return key && (::GetKeyState(key) & KEY_PRESSED) != 0;
+}
 
 // Global constants - use functions to avoid static initialization order issues
 const std::wstring& GetAppDir();
@@ -54,9 +41,6 @@ std::vector<std::string> StringSplit(std::string_view str,
                                      const char delim,
                                      std::string_view enclosure = "");
 
-// HTML compression functions
-void compression_html(std::string& html);
-
 bool ReplaceStringInPlace(std::string& subject,
                           std::string_view search,
                           std::string_view replace);
@@ -73,11 +57,6 @@ std::wstring JoinArgsString(const std::vector<std::wstring>& lines,
 // Memory and module search functions
 uint8_t* memmem(uint8_t* src, int n, const uint8_t* sub, int m);
 
-// Parse the INI file
-std::wstring GetIniString(std::wstring_view section,
-                          std::wstring_view key,
-                          std::wstring_view default_value);
-
 // Canonicalize the path
 std::wstring CanonicalizePath(const std::wstring& path);
 
@@ -120,78 +99,22 @@ void LaunchCommands(const std::wstring& get_commands);
 bool IsFullScreen(HWND hwnd);
 
 // Keyboard and mouse input functions
-// Template function for sending combined key operations - kept in header
-template <typename... T>
-void SendKey(T&&... keys) {
-  std::vector<typename std::common_type<T...>::type> keys_ = {
-      std::forward<T>(keys)...};
-  std::vector<INPUT> inputs{};
-  inputs.reserve(keys_.size() * 2);
-  for (auto& key : keys_) {
-    INPUT input = {0};
-    // Adjust mouse messages
-    switch (key) {
-      case VK_RBUTTON:
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = GetSystemMetrics(SM_SWAPBUTTON) == TRUE
-                               ? MOUSEEVENTF_LEFTDOWN
-                               : MOUSEEVENTF_RIGHTDOWN;
-        input.mi.dwExtraInfo = GetMagicCode();
-        break;
-      case VK_LBUTTON:
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = GetSystemMetrics(SM_SWAPBUTTON) == TRUE
-                               ? MOUSEEVENTF_RIGHTDOWN
-                               : MOUSEEVENTF_LEFTDOWN;
-        input.mi.dwExtraInfo = GetMagicCode();
-        break;
-      case VK_MBUTTON:
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_MIDDLEDOWN;
-        input.mi.dwExtraInfo = GetMagicCode();
-        break;
-      default:
-        input.type = INPUT_KEYBOARD;
-        input.ki.wVk = (WORD)key;
-        input.ki.dwFlags = KEYEVENTF_EXTENDEDKEY;
-        input.ki.dwExtraInfo = GetMagicCode();
-        break;
-    }
-    inputs.emplace_back(std::move(input));
-  }
-  for (auto& key : keys_) {
-    INPUT input = {0};
-    // Adjust mouse messages
-    switch (key) {
-      case VK_RBUTTON:
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = GetSystemMetrics(SM_SWAPBUTTON) == TRUE
-                               ? MOUSEEVENTF_LEFTUP
-                               : MOUSEEVENTF_RIGHTUP;
-        input.mi.dwExtraInfo = GetMagicCode();
-        break;
-      case VK_LBUTTON:
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = GetSystemMetrics(SM_SWAPBUTTON) == TRUE
-                               ? MOUSEEVENTF_RIGHTUP
-                               : MOUSEEVENTF_LEFTUP;
-        input.mi.dwExtraInfo = GetMagicCode();
-        break;
-      case VK_MBUTTON:
-        input.type = INPUT_MOUSE;
-        input.mi.dwFlags = MOUSEEVENTF_MIDDLEUP;
-        input.mi.dwExtraInfo = GetMagicCode();
-        break;
-      default:
-        input.type = INPUT_KEYBOARD;
-        input.ki.dwFlags = KEYEVENTF_KEYUP;
-        input.ki.wVk = (WORD)key;
-        input.ki.dwFlags = KEYEVENTF_EXTENDEDKEY | KEYEVENTF_KEYUP;
-        input.ki.dwExtraInfo = GetMagicCode();
-        break;
-    }
-    inputs.emplace_back(std::move(input));
-  }
+// Whether the primary mouse button is the right one. The setting is read once
+// and kept until `InvalidateMouseButtonSwap` is called for a
+// `WM_SETTINGCHANGE`.
+bool AreMouseButtonsSwapped();
+void InvalidateMouseButtonSwap();
+
+// Presses `kKeys` in order, then releases them in order, with a single
+// `SendInput` call so that no other input can land in between. The events
+// for both layouts of the mouse buttons are built at compile time.
+template <WORD... kKeys>
+void SendKeys() {
+  static constexpr auto kInputs =
+      MakeKeyPresses(false, GetMagicCode(), kKeys...);
+  static constexpr auto kSwappedInputs =
+      MakeKeyPresses(true, GetMagicCode(), kKeys...);
+  auto inputs = AreMouseButtonsSwapped() ? kSwappedInputs : kInputs;
   SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
 }
 
@@ -0,0 +1,141 @@
+// Runs the queries of accessibletree.h on generated browser windows and
+// reports the nodes each one visits next to its latency. The pruned searches
+// should not grow with the web page; a jump in `visits` means one of them
+// started walking into it.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "mock_accessible_tree.h"
+
+namespace {
+
+struct Region {
+  MockAccessibleTree::Rect rect;
+  size_t index = 0;
+};
+
+MockBrowserOptions OptionsFor(const benchmark::State& state) {
+  MockBrowserOptions options;
+  options.tabs = static_cast<size_t>(state.range(0));
+  options.bookmarks = static_cast<size_t>(state.range(0));
+  options.web_content_nodes = static_cast<size_t>(state.range(1));
+  options.omnibox_focused = true;
+  return options;
+}
+
+// Runs `query` once per iteration and reports its visits, which are the same
+// every time.
+template <typename Query>
+void RunQuery(benchmark::State& state,
+              const MockBrowser& browser,
+              Query query) {
+  browser.tree.ResetCounters();
+  if (!query()) {
+    state.SkipWithError("the query did not find its target");
+    return;
+  }
+  const auto counters = browser.tree.counters();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(query());
+  }
+  state.counters["visits"] = static_cast<double>(counters.visits);
+  state.counters["property_reads"] =
+      static_cast<double>(counters.property_reads);
+  state.counters["tree_size"] = static_cast<double>(browser.tree.size());
+}
+
+void BM_FindPageTabPane(benchmark::State& state) {
+  const MockBrowser browser = MakeMockBrowser(OptionsFor(state));
+  RunQuery(state, browser, [&] {
+    return FindPageTabPane(browser.tree, browser.tree.root()) ==
+           browser.tab_pane;
+  });
+}
+
+void BM_CollectTabs(benchmark::State& state) {
+  const MockBrowser browser = MakeMockBrowser(OptionsFor(state));
+  RunQuery(state, browser, [&] {
+    return CollectTabs(browser.tree, browser.tree.root()).size() ==
+           browser.tabs.size();
+  });
+}
+
+// The last bookmark on the bar, so the walk covers the bar before it.
+void BM_IsBookmarkAt(benchmark::State& state) {
+  const MockBrowser browser = MakeMockBrowser(OptionsFor(state));
+  MockAccessibleTree::Node target;
+  for (auto bookmark : browser.bookmarks) {
+    if (!(browser.tree.data(bookmark).state & kStateInvisible)) {
+      target = bookmark;
+    }
+  }
+  const auto rect = *browser.tree.Location(target);
+  const MockPoint pt = {rect.left + 1, rect.top + 1};
+  RunQuery(state, browser, [&] {
+    return IsBookmarkAt(browser.tree, browser.tree.root(), pt);
+  });
+}
+
+// Misses every bookmark, so the whole tree is walked, web page included.
+void BM_IsBookmarkAtMiss(benchmark::State& state) {
+  const MockBrowser browser = MakeMockBrowser(OptionsFor(state));
+  const MockPoint pt = {-10, -10};
+  RunQuery(state, browser, [&] {
+    return !IsBookmarkAt(browser.tree, browser.tree.root(), pt);
+  });
+}
+
+void BM_HasFocusedOmnibox(benchmark::State& state) {
+  const MockBrowser browser = MakeMockBrowser(OptionsFor(state));
+  RunQuery(state, browser, [&] {
+    return HasFocusedOmnibox(browser.tree, browser.tree.root());
+  });
+}
+
+// The close button hit test, once the regions are indexed.
+void BM_HitCloseButton(benchmark::State& state) {
+  const MockBrowser browser = MakeMockBrowser(OptionsFor(state));
+  RegionIndex<Region> index;
+  for (size_t i = 0; i < browser.close_buttons.size(); ++i) {
+    const auto rect = *browser.tree.Location(browser.close_buttons[i]);
+    index.items.push_back({rect, i});
+  }
+  SortRegions(index, true);
+
+  std::vector<MockPoint> points;
+  for (size_t i = 0; i < browser.close_buttons.size(); i += 7) {
+    const auto rect = *browser.tree.Location(browser.close_buttons[i]);
+    points.push_back({rect.left + 2, rect.top + 2});
+  }
+  size_t hits = 0;
+  for (auto _ : state) {
+    for (const auto& pt : points) {
+      hits += HitRegion(index, true, pt) != nullptr;
+    }
+  }
+  if (hits != state.iterations() * points.size()) {
+    state.SkipWithError("a close button was missed");
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+
+// Tabs and bookmarks, then the size of the web page.
+void WindowSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Args({20, 2000})->Args({1000, 2000})->Args({5000, 2000});
+  benchmark->Args({20, 50000});
+}
+
+BENCHMARK(BM_FindPageTabPane)->Apply(WindowSizes);
+BENCHMARK(BM_CollectTabs)->Apply(WindowSizes);
+BENCHMARK(BM_IsBookmarkAt)->Apply(WindowSizes);
+BENCHMARK(BM_IsBookmarkAtMiss)->Apply(WindowSizes);
+BENCHMARK(BM_HasFocusedOmnibox)->Apply(WindowSizes);
+BENCHMARK(BM_HitCloseButton)->Apply(WindowSizes);
+
+}  // namespace
+
+BENCHMARK_MAIN();
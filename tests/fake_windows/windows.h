@@ -0,0 +1,68 @@
+#ifndef CHROME_PLUS_TESTS_FAKE_WINDOWS_WINDOWS_H_
+#define CHROME_PLUS_TESTS_FAKE_WINDOWS_WINDOWS_H_
+
+#include <cstdint>
+
+// The parts of <windows.h> that inputsequence.h uses, with the layouts and
+// values of the real header, so that it can be tested outside Windows.
+
+using WORD = uint16_t;
+using DWORD = uint32_t;
+using LONG = int32_t;
+using ULONG_PTR = uintptr_t;
+
+inline constexpr WORD VK_LBUTTON = 0x01;
+inline constexpr WORD VK_RBUTTON = 0x02;
+inline constexpr WORD VK_MBUTTON = 0x04;
+inline constexpr WORD VK_SHIFT = 0x10;
+inline constexpr WORD VK_CONTROL = 0x11;
+inline constexpr WORD VK_MENU = 0x12;
+inline constexpr WORD VK_RETURN = 0x0D;
+inline constexpr WORD VK_RIGHT = 0x27;
+
+inline constexpr DWORD INPUT_MOUSE = 0;
+inline constexpr DWORD INPUT_KEYBOARD = 1;
+
+inline constexpr DWORD MOUSEEVENTF_LEFTDOWN = 0x0002;
+inline constexpr DWORD MOUSEEVENTF_LEFTUP = 0x0004;
+inline constexpr DWORD MOUSEEVENTF_RIGHTDOWN = 0x0008;
+inline constexpr DWORD MOUSEEVENTF_RIGHTUP = 0x0010;
+inline constexpr DWORD MOUSEEVENTF_MIDDLEDOWN = 0x0020;
+inline constexpr DWORD MOUSEEVENTF_MIDDLEUP = 0x0040;
+
+inline constexpr DWORD KEYEVENTF_EXTENDEDKEY = 0x0001;
+inline constexpr DWORD KEYEVENTF_KEYUP = 0x0002;
+
+struct MOUSEINPUT {
+  LONG dx;
+  LONG dy;
+  DWORD mouseData;
+  DWORD dwFlags;
+  DWORD time;
+  ULONG_PTR dwExtraInfo;
+};
+
+struct KEYBDINPUT {
+  WORD wVk;
+  WORD wScan;
+  DWORD dwFlags;
+  DWORD time;
+  ULONG_PTR dwExtraInfo;
+};
+
+struct HARDWAREINPUT {
+  DWORD uMsg;
+  WORD wParamL;
+  WORD wParamH;
+};
+
+struct INPUT {
+  DWORD type;
+  union {
+    MOUSEINPUT mi;
+    KEYBDINPUT ki;
+    HARDWAREINPUT hi;
+  };
+};
+
+#endif  // CHROME_PLUS_TESTS_FAKE_WINDOWS_WINDOWS_H_
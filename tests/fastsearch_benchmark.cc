@@ -0,0 +1,115 @@
+// Compares `FastSearch` with the scalar Sunday search it replaced, on
+// WebUI-like text and on random bytes.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "../src/fastsearch.h"
+#include "pak_test_util.h"
+
+namespace {
+
+constexpr size_t kCorpusSize = 1024 * 1024;
+
+// Needles the pak patch searches for, none of which occur in the corpora, so
+// every search scans the whole haystack.
+constexpr std::string_view kNeedles[] = {
+    "</settings-about-page>",
+    "hidden=\"[[!showUpdateStatus_]]\"",
+    "<cr-toast",
+};
+
+// The scalar search `FastSearch` used before it was vectorized, kept here as
+// the baseline.
+const uint8_t* SundaySearch(const uint8_t* s, int n, const uint8_t* p, int m) {
+  size_t skip[256];
+  for (int i = 0; i < 256; ++i) {
+    skip[i] = m + 1;
+  }
+  for (int i = 0; i < m; ++i) {
+    skip[p[i]] = m - i;
+  }
+
+  int i = 0;
+  while (i <= n - m) {
+    int j = 0;
+    while (s[i + j] == p[j]) {
+      ++j;
+      if (j >= m) {
+        return s + i;
+      }
+    }
+    if (i + m >= n) {
+      break;
+    }
+    i += static_cast<int>(skip[s[i + m]]);
+  }
+  return nullptr;
+}
+
+const std::string& WebUiCorpus() {
+  static const std::string corpus = MakeWebUiText(kCorpusSize);
+  return corpus;
+}
+
+const std::string& RandomCorpus() {
+  static const std::string corpus = [] {
+    std::mt19937 random(7);
+    std::string text(kCorpusSize, '\0');
+    for (auto& c : text) {
+      c = static_cast<char>(random());
+    }
+    return text;
+  }();
+  return corpus;
+}
+
+using SearchFunction = const uint8_t* (*)(const uint8_t*,
+                                          int,
+                                          const uint8_t*,
+                                          int);
+
+void RunSearch(benchmark::State& state,
+               const std::string& corpus,
+               SearchFunction search) {
+  std::string_view needle = kNeedles[state.range(0)];
+  auto* s = reinterpret_cast<const uint8_t*>(corpus.data());
+  auto* p = reinterpret_cast<const uint8_t*>(needle.data());
+  for (auto _ : state) {
+    auto* found = search(s, static_cast<int>(corpus.size()), p,
+                         static_cast<int>(needle.size()));
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+  state.SetLabel(std::string(needle));
+}
+
+void BM_SundayWebUi(benchmark::State& state) {
+  RunSearch(state, WebUiCorpus(), SundaySearch);
+}
+BENCHMARK(BM_SundayWebUi)->DenseRange(0, std::size(kNeedles) - 1);
+
+void BM_FastSearchWebUi(benchmark::State& state) {
+  RunSearch(state, WebUiCorpus(), FastSearch);
+}
+BENCHMARK(BM_FastSearchWebUi)->DenseRange(0, std::size(kNeedles) - 1);
+
+void BM_SundayRandom(benchmark::State& state) {
+  RunSearch(state, RandomCorpus(), SundaySearch);
+}
+BENCHMARK(BM_SundayRandom)->DenseRange(0, std::size(kNeedles) - 1);
+
+void BM_FastSearchRandom(benchmark::State& state) {
+  RunSearch(state, RandomCorpus(), FastSearch);
+}
+BENCHMARK(BM_FastSearchRandom)->DenseRange(0, std::size(kNeedles) - 1);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,684 @@
+// Replays input hook traces through the handlers of tabbookmark.cc, the
+// `TabHooks` of tabhooks.h, against a generated browser window and a command
+// sink, and reports the latency and tree accesses of each handler. Tree
+// accesses stand in for the accessibility calls the handlers make into the
+// browser.
+//
+//   hook_replay_benchmark [benchmark flags] [Chrome++_HookTrace.bin]
+//
+// Without a trace, a synthetic session of moves, clicks, wheel bursts and key
+// presses is replayed. A recorded trace keeps its timing, but its coordinates
+// are taken as they are, on the generated window.
+//
+// The environment caches the tab strip the way iaccessible.cc does and runs
+// what the handlers defer with `PostTask`, timers and `QueueCommand` before
+// the next event, as the message loop would. Each handler is reported as its
+// own benchmark, whose time is spent in that handler per replay of the trace.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../src/hooktrace.h"
+#include "../src/keybindings.h"
+#include "../src/tabhooks.h"
+#include "mock_accessible_tree.h"
+
+namespace {
+
+using Node = MockAccessibleTree::Node;
+using Clock = std::chrono::steady_clock;
+
+// The keys bound to switching tabs in the replayed config.
+constexpr uint32_t kVkPrior = 0x21;
+constexpr uint32_t kVkNext = 0x22;
+
+// The handlers of `HookHandler`, then the tasks they queue.
+constexpr size_t kUITasks = static_cast<size_t>(HookHandler::kCount);
+constexpr std::array<const char*, kUITasks + 1> kHandlerNames = {
+    "MouseMove",  "ButtonDown", "LButtonUp", "RButtonUp", "MButtonUp",
+    "DoubleClick", "MouseWheel", "Keyboard", "Other",     "UITasks",
+};
+
+// The settings of `Config` the handlers read.
+struct ReplayConfig {
+  bool wheel_tab = true;
+  bool wheel_tab_when_press_right_button = true;
+  bool right_click_close = true;
+  bool double_click_close = true;
+  bool keep_last_tab = true;
+  int bookmark_new_tab_mode = 1;
+  int open_url_new_tab_mode = 1;
+  int drag_new_tab_mode = 1;
+  KeyBindingTable key_bindings;
+
+  bool IsWheelTab() const { return wheel_tab; }
+  bool IsWheelTabWhenPressRightButton() const {
+    return wheel_tab_when_press_right_button;
+  }
+  bool IsRightClickClose() const { return right_click_close; }
+  bool IsDoubleClickClose() const { return double_click_close; }
+  bool IsKeepLastTab() const { return keep_last_tab; }
+  int GetBookmarkNewTabMode() const { return bookmark_new_tab_mode; }
+  int GetOpenUrlNewTabMode() const { return open_url_new_tab_mode; }
+  int GetDragNewTabMode() const { return drag_new_tab_mode; }
+  const KeyBindingTable& GetKeyBindings() const { return key_bindings; }
+};
+
+struct TabRegion {
+  MockRect rect;
+  Node node;
+};
+
+using RegionMap = TabStripRegions<MockRect, TabRegion>;
+
+// The `Env` of `TabHooks` for a single browser window, which is shown on
+// `MockBrowser` and owns every point of the screen. Time is taken from the
+// trace.
+class ReplayEnv {
+ public:
+  using Window = int;
+  using Point = MockPoint;
+
+  struct Tab {
+    Node node;
+    bool selected = false;
+  };
+
+  struct QueuedCommand {
+    int id = 0;
+    int count = 0;
+    std::function<void(bool)> done;
+  };
+
+  struct Timer {
+    uintptr_t id = 0;
+    uint64_t deadline_us = 0;
+    std::function<void()> task;
+  };
+
+  static constexpr Window kBrowserWindow = 1;
+
+  ReplayEnv(const MockBrowser& browser, const ReplayConfig& config)
+      : browser_(browser), config_(config) {}
+
+  const MockAccessibleTree& tree() const { return browser_.tree; }
+  uint64_t now_us() const { return now_us_; }
+  void set_now_us(uint64_t now_us) { now_us_ = now_us; }
+  void SetPressed(uint32_t vk, bool pressed) { pressed_[vk & 0xFF] = pressed; }
+  // Commands, inputs and tab selections the handlers asked for.
+  uint64_t sent() const { return sent_; }
+
+  std::vector<std::function<void()>> TakeTasks() {
+    return std::exchange(tasks_, {});
+  }
+
+  // Takes the timer that fires first if it is due at `time_us`.
+  std::optional<Timer> TakeDueTimer(uint64_t time_us) {
+    auto timer = std::ranges::min_element(timers_, {}, &Timer::deadline_us);
+    if (timer == timers_.end() || timer->deadline_us > time_us) {
+      return std::nullopt;
+    }
+    Timer due = std::move(*timer);
+    timers_.erase(timer);
+    return due;
+  }
+
+  // Runs the queued commands like one slice of the command queue and returns
+  // their callbacks, which run after the tab strip has been dropped.
+  std::vector<std::function<void(bool)>> RunCommands() {
+    std::vector<std::function<void(bool)>> callbacks;
+    if (commands_.empty()) {
+      return callbacks;
+    }
+    int count = static_cast<int>(browser_.tabs.size());
+    for (auto& command : std::exchange(commands_, {})) {
+      ++sent_;
+      if (count > 0) {
+        RunCommand(command.id, command.count, count);
+      }
+      if (command.done) {
+        callbacks.push_back(std::move(command.done));
+      }
+    }
+    InvalidateUIRegions();
+    return callbacks;
+  }
+
+  // The `Env` interface.
+
+  const ReplayConfig& config() const { return config_; }
+  uint64_t Now() const { return now_us_ / 1000; }
+
+  bool IsPressed(int vk) const { return pressed_[vk & 0xFF]; }
+  bool AreModifiersPressed(uint32_t modifiers) const {
+    return (!(modifiers & kModifierShift) || IsPressed(kVkShift)) &&
+           (!(modifiers & kModifierControl) || IsPressed(kVkControl)) &&
+           (!(modifiers & kModifierAlt) || IsPressed(kVkMenu)) &&
+           !(modifiers & kModifierWin);
+  }
+  // `SM_CXDRAG` and `SM_CYDRAG` at 100% scaling.
+  MockPoint GetDragThreshold() const { return {4, 4}; }
+
+  Window FocusWindow() const { return kBrowserWindow; }
+  Window ForegroundWindow() const { return kBrowserWindow; }
+  Window WindowFromPoint(MockPoint) const { return kBrowserWindow; }
+  Window TopWindow(Window hwnd) const { return hwnd; }
+  Window RootWindow(Window hwnd) const { return hwnd; }
+  bool IsBrowserWindow(Window hwnd) const { return hwnd == kBrowserWindow; }
+  bool IsFullScreen(Window) const { return false; }
+
+  bool IsTabStripCached(Window) const {
+    return regions_ && now_us_ < regions_expire_us_;
+  }
+  std::optional<bool> IsInCachedTabStrip(Window, MockPoint pt) const {
+    if (!tab_strip_) {
+      return std::nullopt;
+    }
+    return RectContains(*tab_strip_, pt);
+  }
+  std::optional<TabStripHit> HitCachedTabStrip(Window hwnd,
+                                               MockPoint pt) const {
+    if (!IsTabStripCached(hwnd)) {
+      return std::nullopt;
+    }
+    return ::HitTabStrip(*regions_, pt);
+  }
+  std::optional<int> GetCachedTabCount(Window hwnd) const {
+    if (!IsTabStripCached(hwnd)) {
+      return std::nullopt;
+    }
+    return regions_->tab_count;
+  }
+  void InvalidateUIRegions() {
+    regions_.reset();
+    settle_us_ = now_us_ + kUIRegionSettleMs * 1000;
+  }
+
+  void PrefetchTabStrip(Window) { GetRegionMap(); }
+  bool HasTopContainerView(Window) const { return true; }
+  TabStripHit HitTabStrip(Window, MockPoint pt) {
+    const RegionMap* map = GetRegionMap();
+    return map ? ::HitTabStrip(*map, pt) : TabStripHit{};
+  }
+  bool IsOnTheTabBar(Window hwnd, MockPoint pt) {
+    if (auto in_strip = IsInCachedTabStrip(hwnd, pt)) {
+      return *in_strip;
+    }
+    const RegionMap* map = GetRegionMap();
+    return map && RectContains(map->tab_strip, pt);
+  }
+  int GetTabCount(Window) {
+    const RegionMap* map = GetRegionMap();
+    return map ? map->tab_count : 0;
+  }
+  std::vector<Tab> GetTabs(Window) const {
+    std::vector<Tab> tabs;
+    for (Node node : CollectTabs(tree(), tree().root())) {
+      tabs.push_back({node, GetTabIndex(node) == selected_});
+    }
+    return tabs;
+  }
+  void SelectTab(const Tab& tab) {
+    ++sent_;
+    selected_ = GetTabIndex(tab.node);
+  }
+  bool IsOnFindBarPane(MockPoint) const { return false; }
+  bool IsOnClickableBookmark(Window, MockPoint pt) const {
+    return IsBookmarkAt(tree(), tree().root(), pt);
+  }
+  bool IsBookmarkOpenedOnNewTab() const { return false; }
+  bool IsOmniboxFocus(Window) const {
+    return HasFocusedOmnibox(tree(), tree().root());
+  }
+  bool IsOnNewTab(Window) const { return false; }
+
+  void PostTask(std::wstring_view, std::function<void()> task) {
+    tasks_.push_back(std::move(task));
+  }
+  uintptr_t StartTimer(std::wstring_view,
+                       uint32_t ms,
+                       std::function<void()> task) {
+    timers_.push_back({++last_timer_id_, now_us_ + ms * 1000, std::move(task)});
+    return last_timer_id_;
+  }
+  void StopTimer(uintptr_t timer_id) {
+    std::erase_if(timers_,
+                  [timer_id](const Timer& timer) { return timer.id == timer_id; });
+  }
+  void QueueCommand(int id,
+                    Window,
+                    int count = 1,
+                    std::function<void(bool)> done = {}) {
+    commands_.push_back({id, count, std::move(done)});
+  }
+  template <uint16_t... kKeys>
+  void SendKeys() {
+    ++sent_;
+  }
+
+  bool InitDragNewTab(Window) {
+    drag_start_tab_count_ =
+        static_cast<int>(CollectTabs(tree(), tree().root()).size());
+    return drag_start_tab_count_ > 0;
+  }
+  // Chrome adds the dropped tab, which is then selected.
+  void CheckDragNewTab(Window, MockPoint) {
+    if (static_cast<int>(CollectTabs(tree(), tree().root()).size()) >
+        drag_start_tab_count_) {
+      ++sent_;
+    }
+  }
+  void CancelDragNewTab() {}
+
+ private:
+  // `GetUIRegionMap`.
+  const RegionMap* GetRegionMap() {
+    if (regions_ && now_us_ < regions_expire_us_) {
+      return &*regions_;
+    }
+    RegionMap map;
+    if (!BuildTabStripRegions(tree(), tree().root(), map)) {
+      return nullptr;
+    }
+    tab_strip_ = map.tab_strip;
+    regions_ = std::move(map);
+    regions_expire_us_ = now_us_ < settle_us_
+                             ? settle_us_
+                             : now_us_ + kWindowCacheMaxAgeMs * 1000;
+    return &*regions_;
+  }
+
+  int GetTabIndex(Node node) const {
+    auto tab = std::ranges::find(browser_.tabs, node);
+    return static_cast<int>(tab - browser_.tabs.begin());
+  }
+
+  void RunCommand(int id, int count, int tab_count) {
+    if (id == IDC_SELECT_NEXT_TAB) {
+      selected_ = (selected_ + count) % tab_count;
+    } else if (id == IDC_SELECT_PREVIOUS_TAB) {
+      selected_ = ((selected_ - count) % tab_count + tab_count) % tab_count;
+    } else if (id >= IDC_SELECT_TAB_0 && id <= IDC_SELECT_TAB_7) {
+      selected_ = std::min(id - IDC_SELECT_TAB_0, tab_count - 1);
+    } else if (id == IDC_SELECT_LAST_TAB) {
+      selected_ = tab_count - 1;
+    }
+  }
+
+  const MockBrowser& browser_;
+  const ReplayConfig& config_;
+
+  uint64_t now_us_ = 0;
+  std::bitset<256> pressed_;
+  std::vector<std::function<void()>> tasks_;
+  std::vector<Timer> timers_;
+  uintptr_t last_timer_id_ = 0;
+  std::vector<QueuedCommand> commands_;
+  uint64_t sent_ = 0;
+
+  std::optional<RegionMap> regions_;
+  uint64_t regions_expire_us_ = 0;
+  uint64_t settle_us_ = 0;
+  std::optional<MockRect> tab_strip_;
+
+  int selected_ = 0;
+  int drag_start_tab_count_ = 0;
+};
+
+struct HandlerStats {
+  LatencyHistogram latency_ns;
+  LatencyHistogram com_calls;
+  uint64_t total_ns = 0;
+};
+
+using ReplayStats = std::array<HandlerStats, kUITasks + 1>;
+
+// Feeds a trace to `TabHooks`, running what the hooks defer between events.
+class HookReplayer {
+ public:
+  HookReplayer(const MockBrowser& browser,
+               const ReplayConfig& config,
+               ReplayStats& stats)
+      : env_(browser, config), hooks_(env_), stats_(stats) {}
+
+  // Runs the hook for `record`, then the tasks, timers and commands that are
+  // due before the next event.
+  void Replay(const HookTraceRecord& record) {
+    AdvanceTo(record.time_us);
+    Measure(static_cast<size_t>(record.handler), [&] { RunHook(record); });
+    RunTasks();
+  }
+
+  // Lets the timers of the last events fire.
+  void Finish() { AdvanceTo(env_.now_us() + kWindowCacheMaxAgeMs * 1000); }
+
+  uint64_t sent() const { return env_.sent(); }
+
+ private:
+  template <typename F>
+  void Measure(size_t handler, F&& f) {
+    auto& stats = stats_[handler];
+    size_t before = GetTreeAccesses();
+    auto start = Clock::now();
+    f();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  Clock::now() - start)
+                  .count();
+    stats.total_ns += ns;
+    stats.latency_ns.Add(static_cast<uint32_t>(
+        std::min<int64_t>(ns, std::numeric_limits<uint32_t>::max())));
+    stats.com_calls.Add(static_cast<uint32_t>(GetTreeAccesses() - before));
+  }
+
+  size_t GetTreeAccesses() const {
+    const auto& counters = env_.tree().counters();
+    return counters.visits + counters.property_reads;
+  }
+
+  void RunTasks() {
+    while (true) {
+      auto tasks = env_.TakeTasks();
+      auto callbacks = env_.RunCommands();
+      if (tasks.empty() && callbacks.empty()) {
+        return;
+      }
+      for (auto& task : tasks) {
+        Measure(kUITasks, task);
+      }
+      for (auto& callback : callbacks) {
+        Measure(kUITasks, [&] { callback(true); });
+      }
+    }
+  }
+
+  void AdvanceTo(uint64_t time_us) {
+    while (auto timer = env_.TakeDueTimer(time_us)) {
+      env_.set_now_us(std::max(env_.now_us(), timer->deadline_us));
+      Measure(kUITasks, timer->task);
+      RunTasks();
+    }
+    env_.set_now_us(std::max(env_.now_us(), time_us));
+  }
+
+  // The hooks see the buttons and keys as they were before the event.
+  void RunHook(const HookTraceRecord& record) {
+    const MockPoint pt = {record.x, record.y};
+    switch (record.message) {
+      case kWmKeyDown:
+        hooks_.OnKeyDown(record.data, env_.IsPressed(record.data));
+        env_.SetPressed(record.data, true);
+        return;
+      case kWmKeyUp:
+        env_.SetPressed(record.data, false);
+        return;
+    }
+    hooks_.OnMouse(record.message, pt,
+                   static_cast<int16_t>(record.data >> 16));
+    switch (record.message) {
+      case kWmLButtonDown:
+      case kWmLButtonUp:
+        env_.SetPressed(kVkLButton, record.message == kWmLButtonDown);
+        break;
+      case kWmRButtonDown:
+      case kWmRButtonUp:
+        env_.SetPressed(kVkRButton, record.message == kWmRButtonDown);
+        break;
+      case kWmMButtonDown:
+      case kWmMButtonUp:
+        env_.SetPressed(kVkMButton, record.message == kWmMButtonDown);
+        break;
+    }
+  }
+
+  ReplayEnv env_;
+  TabHooks<ReplayEnv> hooks_;
+  ReplayStats& stats_;
+};
+
+// A session on `browser`: reading pages with the wheel, switching tabs with
+// the wheel and the keyboard, clicking tabs and bookmarks and closing tabs.
+std::vector<HookTraceRecord> MakeSyntheticTrace(const MockBrowser& browser) {
+  constexpr int kScenarios = 2000;
+  std::mt19937 random(19);
+  std::vector<HookTraceRecord> trace;
+  uint64_t time_us = 0;
+  auto add = [&](HookHandler handler, uint32_t message, MockPoint pt,
+                 uint32_t data = 0, uint64_t gap_us = 8'000) {
+    time_us += gap_us;
+    HookTraceRecord record;
+    record.time_us = time_us;
+    record.handler = handler;
+    record.message = message;
+    record.x = static_cast<int32_t>(pt.x);
+    record.y = static_cast<int32_t>(pt.y);
+    record.data = data;
+    trace.push_back(record);
+  };
+  auto pick = [&](const std::vector<Node>& nodes) {
+    auto rect = *browser.tree.Location(
+        nodes[std::uniform_int_distribution<size_t>(0, nodes.size() - 1)(
+            random)]);
+    return MockPoint{(rect.left + rect.right) / 2, (rect.top + rect.bottom) / 2};
+  };
+  auto move_to = [&](MockPoint from, MockPoint to) {
+    for (int i = 1; i <= 12; ++i) {
+      add(HookHandler::kMouseMove, kWmMouseMove,
+          {from.x + (to.x - from.x) * i / 12,
+           from.y + (to.y - from.y) * i / 12});
+    }
+  };
+  auto click = [&](MockPoint pt, uint32_t down, uint32_t up,
+                   HookHandler up_handler) {
+    add(HookHandler::kButtonDown, down, pt, 0, 30'000);
+    add(up_handler, up, pt, 0, 90'000);
+  };
+  auto wheel = [&](MockPoint pt, int notches) {
+    for (int i = 0; i < std::abs(notches); ++i) {
+      int16_t delta = notches > 0 ? -kWheelDelta : kWheelDelta;
+      add(HookHandler::kMouseWheel, kWmMouseWheel, pt,
+          static_cast<uint32_t>(static_cast<uint16_t>(delta)) << 16, 4'000);
+    }
+  };
+  auto press = [&](uint32_t vk) {
+    add(HookHandler::kKeyboard, kWmKeyDown, {}, vk, 120'000);
+    add(HookHandler::kKeyboard, kWmKeyUp, {}, vk, 60'000);
+  };
+  const std::vector<Node> visible_bookmarks = [&] {
+    std::vector<Node> nodes;
+    for (auto node : browser.bookmarks) {
+      if (!(browser.tree.data(node).state & kStateInvisible)) {
+        nodes.push_back(node);
+      }
+    }
+    return nodes;
+  }();
+
+  MockPoint pointer = {1000, 600};
+  for (int i = 0; i < kScenarios; ++i) {
+    MockPoint content = {std::uniform_int_distribution<long>(0, 1999)(random),
+                         std::uniform_int_distribution<long>(200, 1000)(random)};
+    switch (std::uniform_int_distribution<int>(0, 9)(random)) {
+      case 0:
+      case 1:
+        move_to(pointer, content);
+        wheel(content, 3);
+        pointer = content;
+        break;
+      case 2:
+      case 3: {
+        MockPoint tab = pick(browser.tabs);
+        move_to(pointer, tab);
+        wheel(tab, std::uniform_int_distribution<int>(-4, 4)(random));
+        pointer = tab;
+        break;
+      }
+      case 4: {
+        MockPoint tab = pick(browser.tabs);
+        move_to(pointer, tab);
+        click(tab, kWmLButtonDown, kWmLButtonUp, HookHandler::kLButtonUp);
+        pointer = tab;
+        break;
+      }
+      case 5: {
+        MockPoint tab = pick(browser.tabs);
+        move_to(pointer, tab);
+        click(tab, kWmLButtonDown, kWmLButtonUp, HookHandler::kLButtonUp);
+        add(HookHandler::kDoubleClick, kWmLButtonDblClk, tab, 0, 60'000);
+        add(HookHandler::kLButtonUp, kWmLButtonUp, tab, 0, 80'000);
+        pointer = tab;
+        break;
+      }
+      case 6: {
+        MockPoint tab = pick(browser.tabs);
+        move_to(pointer, tab);
+        bool right = std::bernoulli_distribution(0.5)(random);
+        click(tab, right ? kWmRButtonDown : kWmMButtonDown,
+              right ? kWmRButtonUp : kWmMButtonUp,
+              right ? HookHandler::kRButtonUp : HookHandler::kMButtonUp);
+        pointer = tab;
+        break;
+      }
+      case 7: {
+        MockPoint bookmark = pick(visible_bookmarks);
+        move_to(pointer, bookmark);
+        click(bookmark, kWmLButtonDown, kWmLButtonUp, HookHandler::kLButtonUp);
+        pointer = bookmark;
+        break;
+      }
+      case 8:
+        move_to(pointer, content);
+        click(content, kWmLButtonDown, kWmLButtonUp, HookHandler::kLButtonUp);
+        pointer = content;
+        break;
+      case 9:
+        // Typing, then switching tabs from the keyboard.
+        for (uint32_t vk : {uint32_t{'A'}, uint32_t{'B'}, uint32_t{'C'},
+                            uint32_t{kVkReturn}}) {
+          press(vk);
+        }
+        add(HookHandler::kKeyboard, kWmKeyDown, {}, kVkControl, 120'000);
+        press(kVkNext);
+        press(kVkPrior);
+        add(HookHandler::kKeyboard, kWmKeyUp, {}, kVkControl, 60'000);
+        break;
+    }
+  }
+  return trace;
+}
+
+std::vector<HookTraceRecord>& GetRecordedTrace() {
+  static std::vector<HookTraceRecord> trace;
+  return trace;
+}
+
+ReplayConfig MakeReplayConfig() {
+  ReplayConfig config;
+  config.key_bindings.Add((kVkPrior << 16) | kModifierControl,
+                          KeyAction::kSwitchToPrev);
+  config.key_bindings.Add((kVkNext << 16) | kModifierControl,
+                          KeyAction::kSwitchToNext);
+  return config;
+}
+
+void BM_ReplayTrace(benchmark::State& state, size_t handler) {
+  MockBrowserOptions options;
+  options.tabs = static_cast<size_t>(state.range(0));
+  options.bookmarks = 50;
+  options.web_content_nodes = static_cast<size_t>(state.range(1));
+  const MockBrowser browser = MakeMockBrowser(options);
+  const ReplayConfig config = MakeReplayConfig();
+  const std::vector<HookTraceRecord> trace =
+      GetRecordedTrace().empty() ? MakeSyntheticTrace(browser)
+                                 : GetRecordedTrace();
+
+  ReplayStats stats;
+  uint64_t commands = 0;
+  for (auto _ : state) {
+    uint64_t total_ns = stats[handler].total_ns;
+    HookReplayer replayer(browser, config, stats);
+    for (const auto& record : trace) {
+      replayer.Replay(record);
+    }
+    replayer.Finish();
+    commands = replayer.sent();
+    state.SetIterationTime(
+        static_cast<double>(stats[handler].total_ns - total_ns) / 1e9);
+  }
+
+  const auto& handler_stats = stats[handler];
+  if (handler_stats.latency_ns.count() == 0) {
+    state.SkipWithError("the trace has no calls of this handler");
+    return;
+  }
+  state.counters["calls"] = static_cast<double>(
+      handler_stats.latency_ns.count() / state.iterations());
+  state.counters["p50_ns"] =
+      static_cast<double>(handler_stats.latency_ns.GetPercentile(50));
+  state.counters["p99_ns"] =
+      static_cast<double>(handler_stats.latency_ns.GetPercentile(99));
+  state.counters["max_ns"] =
+      static_cast<double>(handler_stats.latency_ns.max());
+  state.counters["com_p99"] =
+      static_cast<double>(handler_stats.com_calls.GetPercentile(99));
+  state.counters["com_max"] =
+      static_cast<double>(handler_stats.com_calls.max());
+  state.counters["commands"] = static_cast<double>(commands);
+}
+
+bool LoadTrace(const char* path) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<uint8_t> data(std::istreambuf_iterator<char>(file), {});
+  return file.is_open() && ParseHookTrace(data, GetRecordedTrace());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // Every handler is timed on the same replays, however little time it takes
+  // of them.
+  constexpr int kReplays = 20;
+  benchmark::Initialize(&argc, argv);
+  if (argc > 2) {
+    std::cerr << "usage: " << argv[0]
+              << " [benchmark flags] [Chrome++_HookTrace.bin]\n";
+    return 1;
+  }
+  if (argc == 2 && !LoadTrace(argv[1])) {
+    std::cerr << argv[1] << " is not a hook trace\n";
+    return 1;
+  }
+  for (size_t handler = 0; handler < kHandlerNames.size(); ++handler) {
+    if (handler == static_cast<size_t>(HookHandler::kOther)) {
+      continue;
+    }
+    benchmark::RegisterBenchmark(
+        (std::string("BM_ReplayTrace/") + kHandlerNames[handler]).c_str(),
+        BM_ReplayTrace, handler)
+        ->Args({20, 2000})
+        ->Args({200, 2000})
+        ->Args({20, 50000})
+        ->Iterations(kReplays)
+        ->UseManualTime()
+        ->Unit(benchmark::kMicrosecond);
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
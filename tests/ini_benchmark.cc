@@ -0,0 +1,115 @@
+// Measures parsing a chrome++.ini sized file and reading every key `Config`
+// loads from it.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../src/ini.h"
+
+namespace {
+
+// The keys `Config::LoadConfig` reads, by section.
+constexpr std::pair<std::wstring_view, std::wstring_view> kKeys[] = {
+    {L"general", L"command_line"},
+    {L"general", L"launch_on_startup"},
+    {L"general", L"launch_on_exit"},
+    {L"general", L"data_dir"},
+    {L"general", L"cache_dir"},
+    {L"general", L"boss_key"},
+    {L"general", L"translate_key"},
+    {L"general", L"show_password"},
+    {L"general", L"win32k"},
+    {L"general", L"pak_patch"},
+    {L"tabs", L"keep_last_tab"},
+    {L"tabs", L"double_click_close"},
+    {L"tabs", L"right_click_close"},
+    {L"tabs", L"wheel_tab"},
+    {L"tabs", L"wheel_tab_when_press_rbutton"},
+    {L"tabs", L"drag_new_tab"},
+    {L"tabs", L"open_url_new_tab"},
+    {L"tabs", L"open_bookmark_new_tab"},
+    {L"tabs", L"new_tab_disable"},
+    {L"tabs", L"new_tab_disable_name"},
+    {L"tabs", L"switch_to_prev"},
+    {L"tabs", L"switch_to_next"},
+    {L"tabs", L"ui_automation"},
+};
+
+// Every key behind a block of comments, like the shipped chrome++.ini, which
+// is mostly documentation.
+std::wstring MakeIniText() {
+  std::wstring text;
+  std::wstring_view section;
+  for (const auto& [key_section, key] : kKeys) {
+    if (key_section != section) {
+      section = key_section;
+      text += L"\r\n[";
+      text += section;
+      text += L"]\r\n";
+    }
+    for (int i = 0; i < 6; ++i) {
+      text += L"; Explains what the option below does, in one line or two.\r\n";
+    }
+    text += key;
+    text += L"=\"1\"\r\n";
+  }
+  text += L"\r\n[pak_patch]\r\n";
+  for (int i = 0; i < 8; ++i) {
+    text += L"rule" + std::to_wstring(i) +
+            L"=\"</settings-about-page>\",\"hidden\",\"\"\r\n";
+  }
+  return text;
+}
+
+std::vector<uint8_t> EncodeUtf16Le(std::wstring_view text) {
+  std::vector<uint8_t> bytes = {0xFF, 0xFE};
+  for (wchar_t c : text) {
+    bytes.push_back(static_cast<uint8_t>(c));
+    bytes.push_back(static_cast<uint8_t>(c >> 8));
+  }
+  return bytes;
+}
+
+std::vector<uint8_t> EncodeAscii(std::wstring_view text) {
+  return {text.begin(), text.end()};
+}
+
+void RunParse(benchmark::State& state, const std::vector<uint8_t>& bytes) {
+  for (auto _ : state) {
+    IniFile ini = IniFile::Parse(bytes);
+    benchmark::DoNotOptimize(ini);
+  }
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+
+void BM_ParseUtf16(benchmark::State& state) {
+  RunParse(state, EncodeUtf16Le(MakeIniText()));
+}
+BENCHMARK(BM_ParseUtf16);
+
+void BM_ParseUtf8(benchmark::State& state) {
+  RunParse(state, EncodeAscii(MakeIniText()));
+}
+BENCHMARK(BM_ParseUtf8);
+
+void BM_LookupAllKeys(benchmark::State& state) {
+  const IniFile ini = IniFile::Parse(EncodeUtf16Le(MakeIniText()));
+  for (auto _ : state) {
+    for (const auto& [section, key] : kKeys) {
+      benchmark::DoNotOptimize(ini.GetString(section, key));
+    }
+    benchmark::DoNotOptimize(ini.GetSection(L"pak_patch"));
+  }
+  state.SetItemsProcessed(state.iterations() * (std::size(kKeys) + 1));
+}
+BENCHMARK(BM_LookupAllKeys);
+
+}  // namespace
+
+BENCHMARK_MAIN();
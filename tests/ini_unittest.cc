@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../src/ini.h"
+
+namespace {
+
+IniFile ParseUtf8(std::string_view text) {
+  return IniFile::Parse(
+      {reinterpret_cast<const uint8_t*>(text.data()), text.size()});
+}
+
+std::vector<uint8_t> EncodeUtf16Le(std::u16string_view text) {
+  std::vector<uint8_t> bytes = {0xFF, 0xFE};
+  for (char16_t unit : text) {
+    bytes.push_back(static_cast<uint8_t>(unit));
+    bytes.push_back(static_cast<uint8_t>(unit >> 8));
+  }
+  return bytes;
+}
+
+using Section = std::vector<std::pair<std::wstring_view, std::wstring_view>>;
+
+TEST(IniFileTest, ReadsKeysOfEachSection) {
+  IniFile ini = ParseUtf8(
+      "[general]\n"
+      "data_dir=%app%\\Data\n"
+      "\n"
+      "[tabs]\n"
+      "double_click_close=1\n");
+  EXPECT_EQ(ini.GetString(L"general", L"data_dir"), L"%app%\\Data");
+  EXPECT_EQ(ini.GetString(L"tabs", L"double_click_close"), L"1");
+  EXPECT_EQ(ini.GetString(L"general", L"double_click_close"), std::nullopt);
+  EXPECT_EQ(ini.GetString(L"missing", L"data_dir", L"default"), L"default");
+}
+
+TEST(IniFileTest, IgnoresCommentsBlanksAndStrayLines) {
+  IniFile ini = ParseUtf8(
+      "outside=1\n"
+      "; [general]\n"
+      "[general]\r\n"
+      "  ; key=commented\n"
+      "  key  =  value  \r\n"
+      "no equal sign\n"
+      "[broken\n"
+      "lost=1\n");
+  EXPECT_EQ(ini.GetString(L"general", L"key"), L"value");
+  EXPECT_EQ(ini.GetString(L"general", L"; key"), std::nullopt);
+  EXPECT_EQ(ini.GetString(L"general", L"outside"), std::nullopt);
+  // Keys after a section header without `]` belong to no section.
+  EXPECT_EQ(ini.GetString(L"general", L"lost"), std::nullopt);
+  EXPECT_EQ(ini.GetString(L"broken", L"lost"), std::nullopt);
+}
+
+TEST(IniFileTest, NamesAreCaseInsensitive) {
+  IniFile ini = ParseUtf8("[General]\nBoss_Key=Ctrl+Alt+B\n");
+  EXPECT_EQ(ini.GetString(L"general", L"boss_key"), L"Ctrl+Alt+B");
+  EXPECT_EQ(ini.GetString(L"GENERAL", L"BOSS_KEY"), L"Ctrl+Alt+B");
+}
+
+TEST(IniFileTest, StripsOnePairOfMatchingQuotes) {
+  IniFile ini = ParseUtf8(
+      "[s]\n"
+      "double=\"a, b\"\n"
+      "single='c'\n"
+      "mismatched=\"d'\n"
+      "nested=\"\"e\"\"\n"
+      "lone=\"\n");
+  EXPECT_EQ(ini.GetString(L"s", L"double"), L"a, b");
+  EXPECT_EQ(ini.GetString(L"s", L"single"), L"c");
+  EXPECT_EQ(ini.GetString(L"s", L"mismatched"), L"\"d'");
+  EXPECT_EQ(ini.GetString(L"s", L"nested"), L"\"e\"");
+  EXPECT_EQ(ini.GetString(L"s", L"lone"), L"\"");
+  // `GetSection` keeps the quotes.
+  EXPECT_EQ(ini.GetSection(L"s")[0], (Section::value_type{L"double",
+                                                           L"\"a, b\""}));
+}
+
+// Like `GetPrivateProfileStringW`, the first of several equal keys wins, even
+// across repeated sections.
+TEST(IniFileTest, FirstDuplicateKeyWins) {
+  IniFile ini = ParseUtf8(
+      "[s]\n"
+      "key=first\n"
+      "KEY=second\n"
+      "[other]\n"
+      "key=other\n"
+      "[S]\n"
+      "key=third\n"
+      "late=1\n");
+  EXPECT_EQ(ini.GetString(L"s", L"key"), L"first");
+  EXPECT_EQ(ini.GetString(L"s", L"late"), L"1");
+  EXPECT_EQ(ini.GetSection(L"s"),
+            (Section{{L"key", L"first"},
+                     {L"KEY", L"second"},
+                     {L"key", L"third"},
+                     {L"late", L"1"}}));
+}
+
+TEST(IniFileTest, GetIntReadsLeadingDigits) {
+  IniFile ini = ParseUtf8(
+      "[s]\n"
+      "plain=42\n"
+      "negative=-17\n"
+      "suffix=300ms\n"
+      "text=abc\n"
+      "empty=\n"
+      "quoted=\"8\"\n");
+  EXPECT_EQ(ini.GetInt(L"s", L"plain", 5), 42);
+  EXPECT_EQ(ini.GetInt(L"s", L"negative", 5), -17);
+  EXPECT_EQ(ini.GetInt(L"s", L"suffix", 5), 300);
+  EXPECT_EQ(ini.GetInt(L"s", L"text", 5), 0);
+  EXPECT_EQ(ini.GetInt(L"s", L"empty", 5), 0);
+  EXPECT_EQ(ini.GetInt(L"s", L"quoted", 5), 8);
+  EXPECT_EQ(ini.GetInt(L"s", L"missing", 5), 5);
+}
+
+TEST(IniFileTest, GetIntClampsOverflow) {
+  IniFile ini = ParseUtf8(
+      "[s]\n"
+      "max=2147483647\n"
+      "min=-2147483648\n"
+      "above=2147483648\n"
+      "below=-2147483649\n"
+      "huge=99999999999999999999999999\n"
+      "tiny=-99999999999999999999999999\n");
+  EXPECT_EQ(ini.GetInt(L"s", L"max", 0), INT_MAX);
+  EXPECT_EQ(ini.GetInt(L"s", L"min", 0), INT_MIN);
+  EXPECT_EQ(ini.GetInt(L"s", L"above", 0), INT_MAX);
+  EXPECT_EQ(ini.GetInt(L"s", L"below", 0), INT_MIN);
+  EXPECT_EQ(ini.GetInt(L"s", L"huge", 0), INT_MAX);
+  EXPECT_EQ(ini.GetInt(L"s", L"tiny", 0), INT_MIN);
+}
+
+TEST(IniFileTest, DecodesUtf16LeWithBom) {
+  IniFile ini = IniFile::Parse(
+      EncodeUtf16Le(u"[general]\r\nname=新标签\U0001F600\r\n"));
+  EXPECT_EQ(ini.GetString(L"general", L"name"),
+            L"新标签\U0001F600");
+}
+
+TEST(IniFileTest, DecodesUtf8WithAndWithoutBom) {
+  for (std::string_view bom : {"", "\xEF\xBB\xBF"}) {
+    std::string text(bom);
+    text += "[general]\nname=\xE6\x96\xB0\xF0\x9F\x98\x80\n";
+    EXPECT_EQ(ParseUtf8(text).GetString(L"general", L"name"),
+              L"新\U0001F600");
+  }
+}
+
+TEST(IniFileTest, ReplacesInvalidUtf8) {
+  IniFile ini = ParseUtf8("[s]\nkey=a\xFF" "b\xE6\x96\n");
+  EXPECT_EQ(ini.GetString(L"s", L"key"), L"a�b��");
+}
+
+TEST(IniFileTest, LoadFailsForMissingFile) {
+  EXPECT_FALSE(IniFile::Load(std::filesystem::temp_directory_path() /
+                             "ini_unittest_missing.ini"));
+}
+
+TEST(IniFileTest, EmptyFileReturnsDefaults) {
+  IniFile ini;
+  EXPECT_EQ(ini.GetString(L"general", L"key"), std::nullopt);
+  EXPECT_EQ(ini.GetInt(L"general", L"key", 3), 3);
+}
+
+}  // namespace
@@ -0,0 +1,134 @@
+// Compares building the input events of a synthesized key press with
+// `MakeKeyPresses`, as `SendKeys` does, against the builder it replaced,
+// which filled two vectors at run time and asked for the button layout for
+// every mouse event.
+
+#include <benchmark/benchmark.h>
+
+#include <windows.h>
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../src/inputsequence.h"
+
+namespace {
+
+constexpr ULONG_PTR kMagicCode = 0xC0DE;
+
+// Stands in for `GetSystemMetrics(SM_SWAPBUTTON)`, which the old builder
+// called for each mouse event, and for the cached `AreMouseButtonsSwapped`.
+bool buttons_swapped = false;
+[[gnu::noinline]] bool GetSwapButton() {
+  benchmark::ClobberMemory();
+  return buttons_swapped;
+}
+
+// The former `SendKey`, up to its `SendInput` call.
+template <typename... T>
+std::vector<INPUT> BuildLegacyKeyPresses(T&&... keys) {
+  std::vector<typename std::common_type<T...>::type> keys_ = {
+      std::forward<T>(keys)...};
+  std::vector<INPUT> inputs{};
+  inputs.reserve(keys_.size() * 2);
+  for (bool up : {false, true}) {
+    for (auto& key : keys_) {
+      INPUT input = {};
+      switch (key) {
+        case VK_RBUTTON:
+          input.type = INPUT_MOUSE;
+          if (GetSwapButton()) {
+            input.mi.dwFlags = up ? MOUSEEVENTF_LEFTUP : MOUSEEVENTF_LEFTDOWN;
+          } else {
+            input.mi.dwFlags = up ? MOUSEEVENTF_RIGHTUP : MOUSEEVENTF_RIGHTDOWN;
+          }
+          input.mi.dwExtraInfo = kMagicCode;
+          break;
+        case VK_LBUTTON:
+          input.type = INPUT_MOUSE;
+          if (GetSwapButton()) {
+            input.mi.dwFlags = up ? MOUSEEVENTF_RIGHTUP : MOUSEEVENTF_RIGHTDOWN;
+          } else {
+            input.mi.dwFlags = up ? MOUSEEVENTF_LEFTUP : MOUSEEVENTF_LEFTDOWN;
+          }
+          input.mi.dwExtraInfo = kMagicCode;
+          break;
+        case VK_MBUTTON:
+          input.type = INPUT_MOUSE;
+          input.mi.dwFlags = up ? MOUSEEVENTF_MIDDLEUP : MOUSEEVENTF_MIDDLEDOWN;
+          input.mi.dwExtraInfo = kMagicCode;
+          break;
+        default:
+          input.type = INPUT_KEYBOARD;
+          input.ki.wVk = static_cast<WORD>(key);
+          input.ki.dwFlags = KEYEVENTF_EXTENDEDKEY | (up ? KEYEVENTF_KEYUP : 0);
+          input.ki.dwExtraInfo = kMagicCode;
+          break;
+      }
+      inputs.emplace_back(std::move(input));
+    }
+  }
+  return inputs;
+}
+
+// `SendKeys`, up to its `SendInput` call.
+template <WORD... kKeys>
+std::array<INPUT, 2 * sizeof...(kKeys)> BuildKeyPresses() {
+  static constexpr auto kInputs = MakeKeyPresses(false, kMagicCode, kKeys...);
+  static constexpr auto kSwappedInputs =
+      MakeKeyPresses(true, kMagicCode, kKeys...);
+  return GetSwapButton() ? kSwappedInputs : kInputs;
+}
+
+// The sequences Chrome++ sends: a middle click, the bookmark middle click
+// with Shift, and Alt+Enter.
+void BM_LegacyMiddleClick(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildLegacyKeyPresses(VK_MBUTTON));
+  }
+}
+
+void BM_MakeKeyPressesMiddleClick(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildKeyPresses<VK_MBUTTON>());
+  }
+}
+
+void BM_LegacyShiftMiddleClick(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildLegacyKeyPresses(VK_MBUTTON, VK_SHIFT));
+  }
+}
+
+void BM_MakeKeyPressesShiftMiddleClick(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildKeyPresses<VK_MBUTTON, VK_SHIFT>());
+  }
+}
+
+void BM_LegacyShiftAltEnter(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        BuildLegacyKeyPresses(VK_SHIFT, VK_MENU, VK_RETURN));
+  }
+}
+
+void BM_MakeKeyPressesShiftAltEnter(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildKeyPresses<VK_SHIFT, VK_MENU, VK_RETURN>());
+  }
+}
+
+BENCHMARK(BM_LegacyMiddleClick);
+BENCHMARK(BM_MakeKeyPressesMiddleClick);
+BENCHMARK(BM_LegacyShiftMiddleClick);
+BENCHMARK(BM_MakeKeyPressesShiftMiddleClick);
+BENCHMARK(BM_LegacyShiftAltEnter);
+BENCHMARK(BM_MakeKeyPressesShiftAltEnter);
+
+}  // namespace
+
+BENCHMARK_MAIN();
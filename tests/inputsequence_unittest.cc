@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <windows.h>
+
+#include "../src/inputsequence.h"
+
+namespace {
+
+constexpr ULONG_PTR kExtraInfo = 0xC0DE;
+
+// The sequences are built at compile time.
+constexpr auto kCloseTab = MakeKeyPresses(false, kExtraInfo, VK_CONTROL, 'W');
+static_assert(kCloseTab.size() == 4);
+static_assert(kCloseTab[0].ki.wVk == VK_CONTROL);
+static_assert(kCloseTab[3].ki.dwFlags & KEYEVENTF_KEYUP);
+
+void ExpectKey(const INPUT& input, WORD key, bool up) {
+  EXPECT_EQ(input.type, INPUT_KEYBOARD);
+  EXPECT_EQ(input.ki.wVk, key);
+  EXPECT_EQ(input.ki.dwFlags,
+            KEYEVENTF_EXTENDEDKEY | (up ? KEYEVENTF_KEYUP : 0));
+  EXPECT_EQ(input.ki.dwExtraInfo, kExtraInfo);
+}
+
+void ExpectMouse(const INPUT& input, DWORD flags) {
+  EXPECT_EQ(input.type, INPUT_MOUSE);
+  EXPECT_EQ(input.mi.dwFlags, flags);
+  EXPECT_EQ(input.mi.dwExtraInfo, kExtraInfo);
+}
+
+// All the presses go into one batch, so that nothing the user types can end
+// up between them.
+TEST(InputSequenceTest, PressesAllKeysBeforeReleasingThem) {
+  auto inputs =
+      MakeKeyPresses(false, kExtraInfo, VK_SHIFT, VK_MENU, VK_RETURN);
+  ASSERT_EQ(inputs.size(), 6u);
+  ExpectKey(inputs[0], VK_SHIFT, false);
+  ExpectKey(inputs[1], VK_MENU, false);
+  ExpectKey(inputs[2], VK_RETURN, false);
+  ExpectKey(inputs[3], VK_SHIFT, true);
+  ExpectKey(inputs[4], VK_MENU, true);
+  ExpectKey(inputs[5], VK_RETURN, true);
+}
+
+TEST(InputSequenceTest, MixesMouseButtonsAndKeys) {
+  auto inputs = MakeKeyPresses(false, kExtraInfo, VK_MBUTTON, VK_SHIFT);
+  ASSERT_EQ(inputs.size(), 4u);
+  ExpectMouse(inputs[0], MOUSEEVENTF_MIDDLEDOWN);
+  ExpectKey(inputs[1], VK_SHIFT, false);
+  ExpectMouse(inputs[2], MOUSEEVENTF_MIDDLEUP);
+  ExpectKey(inputs[3], VK_SHIFT, true);
+}
+
+TEST(InputSequenceTest, KeepsButtonsWhenNotSwapped) {
+  auto inputs = MakeKeyPresses(false, kExtraInfo, VK_LBUTTON, VK_RBUTTON);
+  ExpectMouse(inputs[0], MOUSEEVENTF_LEFTDOWN);
+  ExpectMouse(inputs[1], MOUSEEVENTF_RIGHTDOWN);
+  ExpectMouse(inputs[2], MOUSEEVENTF_LEFTUP);
+  ExpectMouse(inputs[3], MOUSEEVENTF_RIGHTUP);
+}
+
+// `VK_LBUTTON` is the primary button, which is the right one when the user
+// has swapped them.
+TEST(InputSequenceTest, SwapsPrimaryAndSecondaryButtons) {
+  auto inputs = MakeKeyPresses(true, kExtraInfo, VK_LBUTTON, VK_RBUTTON);
+  ExpectMouse(inputs[0], MOUSEEVENTF_RIGHTDOWN);
+  ExpectMouse(inputs[1], MOUSEEVENTF_LEFTDOWN);
+  ExpectMouse(inputs[2], MOUSEEVENTF_RIGHTUP);
+  ExpectMouse(inputs[3], MOUSEEVENTF_LEFTUP);
+}
+
+TEST(InputSequenceTest, MiddleButtonIgnoresSwap) {
+  for (bool swap_buttons : {false, true}) {
+    auto inputs = MakeKeyPresses(swap_buttons, kExtraInfo, VK_MBUTTON);
+    ExpectMouse(inputs[0], MOUSEEVENTF_MIDDLEDOWN);
+    ExpectMouse(inputs[1], MOUSEEVENTF_MIDDLEUP);
+  }
+}
+
+// The hooks let events through by their extra info, so every event of a
+// batch must carry it.
+TEST(InputSequenceTest, TagsEveryEventWithExtraInfo) {
+  for (const INPUT& input :
+       MakeKeyPresses(false, kExtraInfo, VK_LBUTTON, VK_CONTROL, 'T')) {
+    ULONG_PTR extra_info = input.type == INPUT_MOUSE ? input.mi.dwExtraInfo
+                                                     : input.ki.dwExtraInfo;
+    EXPECT_EQ(extra_info, kExtraInfo);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,100 @@
+// Feeds keystroke streams through the `KeyBindingTable` the keyboard hook
+// matches every key press against, and reports the cost per key.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "../src/keybindings.h"
+
+namespace {
+
+constexpr uint32_t kVkLeft = 0x25;
+constexpr uint32_t kVkRight = 0x27;
+
+// As returned by `ParseHotkeys`.
+constexpr uint32_t MakeHotkey(uint32_t modifiers, uint32_t vk) {
+  return (vk << 16) | modifiers | kModifierNoRepeat;
+}
+
+struct KeyStroke {
+  uint32_t vk = 0;
+  // The modifiers held down while the key is pressed.
+  uint32_t modifiers = 0;
+};
+
+KeyBindingTable MakeTable() {
+  KeyBindingTable table;
+  table.Add(MakeHotkey(kModifierControl | kModifierAlt, 'T'),
+            KeyAction::kTranslate);
+  table.Add(MakeHotkey(kModifierAlt, kVkLeft), KeyAction::kSwitchToPrev);
+  table.Add(MakeHotkey(kModifierAlt, kVkRight), KeyAction::kSwitchToNext);
+  return table;
+}
+
+// Ordinary typing, which no binding matches.
+std::vector<KeyStroke> MakeTypingStream(size_t count) {
+  constexpr std::string_view kText =
+      "the quick brown fox jumps over the lazy dog 0123456789 ";
+  std::vector<KeyStroke> keys;
+  keys.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    char c = kText[i % kText.size()];
+    uint32_t vk = c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+    keys.push_back({vk, i % 16 == 0 ? kModifierShift : 0});
+  }
+  return keys;
+}
+
+// Only bound keys, with and without their modifiers, so that every press
+// checks modifiers.
+std::vector<KeyStroke> MakeBoundStream(size_t count) {
+  constexpr uint32_t kKeys[] = {'T', kVkLeft, kVkRight};
+  constexpr uint32_t kModifiers[] = {0, kModifierAlt,
+                                     kModifierControl | kModifierAlt};
+  std::mt19937 random(42);
+  std::vector<KeyStroke> keys;
+  keys.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    keys.push_back({kKeys[random() % 3], kModifiers[random() % 3]});
+  }
+  return keys;
+}
+
+void RunStream(benchmark::State& state, const std::vector<KeyStroke>& keys) {
+  const KeyBindingTable table = MakeTable();
+  size_t matched = 0;
+  size_t modifier_checks = 0;
+  for (auto _ : state) {
+    for (const auto& key : keys) {
+      KeyAction action = table.Match(key.vk, [&](uint32_t modifiers) {
+        ++modifier_checks;
+        return (key.modifiers & modifiers) == modifiers;
+      });
+      matched += action != KeyAction::kNone;
+      benchmark::DoNotOptimize(action);
+    }
+  }
+  auto processed = static_cast<double>(state.iterations() * keys.size());
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  state.counters["matched_per_key"] = matched / processed;
+  state.counters["modifier_checks_per_key"] = modifier_checks / processed;
+}
+
+void BM_MatchTyping(benchmark::State& state) {
+  RunStream(state, MakeTypingStream(static_cast<size_t>(state.range(0))));
+}
+BENCHMARK(BM_MatchTyping)->Arg(4096);
+
+void BM_MatchBoundKeys(benchmark::State& state) {
+  RunStream(state, MakeBoundStream(static_cast<size_t>(state.range(0))));
+}
+BENCHMARK(BM_MatchBoundKeys)->Arg(4096);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,234 @@
+#ifndef CHROME_PLUS_TESTS_MOCK_ACCESSIBLE_TREE_H_
+#define CHROME_PLUS_TESTS_MOCK_ACCESSIBLE_TREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../src/accessibletree.h"
+
+// An in-memory accessibility tree for the algorithms in accessibletree.h,
+// which counts how much of the tree each query touches.
+
+inline constexpr long kRoleClient = 0x0A;
+inline constexpr long kRoleDocument = 0x0F;
+inline constexpr long kRoleGrouping = 0x14;
+inline constexpr long kRoleLink = 0x1E;
+
+inline constexpr long kStateInvisible = 0x8000;
+
+struct MockPoint {
+  long x = 0;
+  long y = 0;
+};
+
+struct MockRect {
+  long left = 0;
+  long top = 0;
+  long right = 0;
+  long bottom = 0;
+};
+
+class MockAccessibleTree {
+ public:
+  using Rect = MockRect;
+
+  struct NodeData {
+    long role = 0;
+    long state = 0;
+    Rect rect;
+    std::wstring description;
+    int32_t parent = -1;
+    std::vector<int32_t> children;
+  };
+
+  // A handle to a node of the tree it came from, or none.
+  struct Node {
+    int32_t index = -1;
+
+    explicit operator bool() const { return index >= 0; }
+    bool operator==(const Node&) const = default;
+  };
+
+  // What a query touched since the last `ResetCounters`.
+  struct Counters {
+    // Children handed to `ForEachChild` callbacks.
+    size_t visits = 0;
+    // Calls to `Role`, `State`, `Location` and `Description`.
+    size_t property_reads = 0;
+  };
+
+  MockAccessibleTree() { nodes_.emplace_back().role = kRoleClient; }
+
+  Node root() const { return {0}; }
+
+  Node Add(Node parent,
+           long role,
+           Rect rect = {},
+           std::wstring description = {},
+           long state = 0) {
+    auto index = static_cast<int32_t>(nodes_.size());
+    nodes_.push_back(
+        {role, state, rect, std::move(description), parent.index, {}});
+    nodes_[parent.index].children.push_back(index);
+    return {index};
+  }
+
+  NodeData& data(Node node) { return nodes_[node.index]; }
+  const NodeData& data(Node node) const { return nodes_[node.index]; }
+  size_t size() const { return nodes_.size(); }
+
+  const Counters& counters() const { return counters_; }
+  void ResetCounters() const { counters_ = {}; }
+
+  // The `AccessibleTree` interface.
+
+  long Role(const Node& node) const {
+    ++counters_.property_reads;
+    return nodes_[node.index].role;
+  }
+
+  long State(const Node& node) const {
+    ++counters_.property_reads;
+    return nodes_[node.index].state;
+  }
+
+  Node Parent(const Node& node) const { return {nodes_[node.index].parent}; }
+
+  std::optional<Rect> Location(const Node& node) const {
+    ++counters_.property_reads;
+    return nodes_[node.index].rect;
+  }
+
+  template <typename F>
+  void Description(const Node& node, F&& f) const {
+    ++counters_.property_reads;
+    f(std::wstring_view(nodes_[node.index].description));
+  }
+
+  // Skips invisible children, like the MSAA tree.
+  template <typename F>
+  void ForEachChild(const Node& node, F&& f) const {
+    for (int32_t child : nodes_[node.index].children) {
+      if (nodes_[child].state & kStateInvisible) {
+        continue;
+      }
+      ++counters_.visits;
+      if (f(Node{child})) {
+        return;
+      }
+    }
+  }
+
+ private:
+  std::vector<NodeData> nodes_;
+  mutable Counters counters_;
+};
+
+static_assert(AccessibleTree<MockAccessibleTree>);
+
+// The shape of a generated browser window.
+struct MockBrowserOptions {
+  size_t tabs = 20;
+  size_t bookmarks = 50;
+  // Nodes in the web page, which the pruned searches must never enter.
+  size_t web_content_nodes = 2000;
+  bool omnibox_focused = false;
+};
+
+// The nodes the queries look for, so that tests and benchmarks can check
+// their results and aim at them.
+struct MockBrowser {
+  MockAccessibleTree tree;
+  MockAccessibleTree::Node tab_pane;
+  std::vector<MockAccessibleTree::Node> tabs;
+  std::vector<MockAccessibleTree::Node> close_buttons;
+  std::vector<MockAccessibleTree::Node> bookmarks;
+  MockAccessibleTree::Node omnibox;
+};
+
+// Builds a tree shaped like the one Chrome exposes for a browser window: the
+// tab strip, the toolbar with the omnibox and the bookmark bar in the top
+// container, followed by the web page.
+inline MockBrowser MakeMockBrowser(const MockBrowserOptions& options) {
+  using Rect = MockAccessibleTree::Rect;
+  constexpr long kTabStripTop = 0;
+  constexpr long kToolbarTop = 40;
+  constexpr long kBookmarkBarTop = 80;
+  constexpr long kContentTop = 110;
+
+  MockBrowser browser;
+  auto& tree = browser.tree;
+  auto view = tree.Add(tree.root(), kRolePane);
+  auto top_container = tree.Add(view, kRolePane);
+
+  // Tabs shrink to fit, as in Chrome, but never below 40 pixels.
+  const Rect strip = {0, kTabStripTop, 2000, kTabStripTop + 34};
+  auto tab_strip = tree.Add(top_container, kRolePane, strip);
+  auto tab_list = tree.Add(tab_strip, kRolePageTabList, strip);
+  browser.tab_pane = tree.Add(tab_list, kRolePane);
+  long tab_width = 200;
+  if (options.tabs > 0) {
+    tab_width = std::max(40l, static_cast<long>(2000 / options.tabs));
+  }
+  for (size_t i = 0; i < options.tabs; ++i) {
+    long left = static_cast<long>(i) * tab_width;
+    Rect rect = {left, kTabStripTop, left + tab_width, kTabStripTop + 34};
+    auto tab = tree.Add(browser.tab_pane, kRolePageTab, rect);
+    browser.tabs.push_back(tab);
+    Rect close = {rect.right - 24, rect.top + 8, rect.right - 8,
+                  rect.top + 24};
+    browser.close_buttons.push_back(tree.Add(tab, kRolePushButton, close));
+  }
+  tree.Add(browser.tab_pane, kRolePushButton,
+           {static_cast<long>(options.tabs) * tab_width, kTabStripTop,
+            static_cast<long>(options.tabs) * tab_width + 30,
+            kTabStripTop + 34});
+
+  auto toolbar = tree.Add(top_container, kRoleToolbar);
+  for (long i = 0; i < 3; ++i) {
+    tree.Add(toolbar, kRolePushButton,
+             {i * 30, kToolbarTop, i * 30 + 30, kToolbarTop + 30});
+  }
+  auto location_bar = tree.Add(toolbar, kRoleGrouping);
+  browser.omnibox = tree.Add(location_bar, kRoleText,
+                             {100, kToolbarTop, 1500, kToolbarTop + 30}, {},
+                             options.omnibox_focused ? kStateFocused : 0);
+
+  // The bookmark bar only has room for the first bookmarks; the rest are in
+  // a hidden overflow menu.
+  auto bookmark_bar = tree.Add(top_container, kRoleToolbar);
+  for (size_t i = 0; i < options.bookmarks; ++i) {
+    long left = static_cast<long>(i) * 120;
+    bool visible = left + 120 <= 2000;
+    auto bookmark = tree.Add(
+        bookmark_bar, kRolePushButton,
+        {left, kBookmarkBarTop, left + 120, kBookmarkBarTop + 28},
+        L"https://example.com/" + std::to_wstring(i),
+        visible ? 0 : kStateInvisible);
+    browser.bookmarks.push_back(bookmark);
+  }
+
+  // A web page as a tree of nested sections and links. Links have URLs as
+  // descriptions too, but lie below the browser UI.
+  auto document = tree.Add(view, kRoleDocument,
+                           {0, kContentTop, 2000, kContentTop + 1000});
+  std::vector<MockAccessibleTree::Node> sections = {document};
+  for (size_t i = 0; i + 1 < options.web_content_nodes; ++i) {
+    auto parent = sections[i / 8];
+    bool link = i % 3 == 2;
+    long top = kContentTop + static_cast<long>(i % 1000);
+    auto node = tree.Add(parent, link ? kRoleLink : kRoleGrouping,
+                         {0, top, 2000, top + 1},
+                         link ? L"https://example.org/page" : L"");
+    sections.push_back(node);
+  }
+  return browser;
+}
+
+#endif  // CHROME_PLUS_TESTS_MOCK_ACCESSIBLE_TREE_H_
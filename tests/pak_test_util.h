@@ -0,0 +1,99 @@
+#ifndef CHROME_PLUS_TESTS_PAK_TEST_UTIL_H_
+#define CHROME_PLUS_TESTS_PAK_TEST_UTIL_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+extern "C" void* gzip_compress(uint8_t* data, size_t len, size_t* out_len);
+
+// Builds synthetic pak files for the tests, benchmarks and fuzzers.
+
+struct TestPakEntry {
+  uint16_t resource_id = 0;
+  std::vector<uint8_t> data;
+};
+
+struct TestPakAlias {
+  uint16_t resource_id = 0;
+  uint16_t entry_index = 0;
+};
+
+inline void AppendLittleEndian(std::vector<uint8_t>& out,
+                               uint64_t value,
+                               size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+// A version 5 pak file holding `entries` in the given order.
+inline std::vector<uint8_t> BuildPak5(
+    const std::vector<TestPakEntry>& entries,
+    const std::vector<TestPakAlias>& aliases = {},
+    uint32_t encoding = 1) {
+  std::vector<uint8_t> pak;
+  AppendLittleEndian(pak, 5, 4);
+  AppendLittleEndian(pak, encoding, 4);
+  AppendLittleEndian(pak, entries.size(), 2);
+  AppendLittleEndian(pak, aliases.size(), 2);
+  size_t offset = pak.size() + (entries.size() + 1) * 6 + aliases.size() * 4;
+  for (const auto& entry : entries) {
+    AppendLittleEndian(pak, entry.resource_id, 2);
+    AppendLittleEndian(pak, offset, 4);
+    offset += entry.data.size();
+  }
+  AppendLittleEndian(pak, 0, 2);
+  AppendLittleEndian(pak, offset, 4);
+  for (const auto& alias : aliases) {
+    AppendLittleEndian(pak, alias.resource_id, 2);
+    AppendLittleEndian(pak, alias.entry_index, 2);
+  }
+  for (const auto& entry : entries) {
+    pak.insert(pak.end(), entry.data.begin(), entry.data.end());
+  }
+  return pak;
+}
+
+inline std::vector<uint8_t> Gzip(std::string_view text) {
+  std::string copy(text);
+  size_t size = 0;
+  std::unique_ptr<void, decltype(&std::free)> compressed(
+      gzip_compress(reinterpret_cast<uint8_t*>(copy.data()), copy.size(),
+                    &size),
+      std::free);
+  auto* bytes = static_cast<const uint8_t*>(compressed.get());
+  return {bytes, bytes + size};
+}
+
+// HTML-like text of at least `size` bytes, compressible like the WebUI
+// resources of Chrome, with `marker` in the middle if it is not empty.
+inline std::string MakeWebUiText(size_t size,
+                                 std::string_view marker = {},
+                                 uint32_t seed = 1) {
+  constexpr std::string_view kWords[] = {
+      "<div class=\"item\">", "</div>", "<span>", "</span>", "hidden",
+      "{{label}}",            "[[item.name]]",      "on-click=\"onTap_\"",
+      "\n  ",                 "Polymer({is: 'x'});"};
+  std::mt19937 random(seed);
+  std::string text;
+  while (text.size() < size) {
+    if (!marker.empty() && text.size() >= size / 2 &&
+        text.find(marker) == std::string::npos) {
+      text += marker;
+    }
+    text += kWords[random() % std::size(kWords)];
+    // Identifiers keep the text about as compressible as real resources.
+    text += " id" + std::to_string(random() % 100000) + ' ';
+  }
+  return text;
+}
+
+#endif  // CHROME_PLUS_TESTS_PAK_TEST_UTIL_H_
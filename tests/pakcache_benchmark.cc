@@ -0,0 +1,158 @@
+// Measures the startup cost of patching `resources.pak` on a synthetic pak
+// file the size of the one Chrome ships: a cold start inflates every
+// compressed resource to look for markers, patches and recompresses the
+// matches and saves the cache, while a warm start only loads the cache,
+// verifies it and copies the entries over.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "../src/hash.h"
+#include "../src/pakcache.h"
+#include "../src/pakfile.h"
+#include "../src/pakrules.h"
+#include "pak_test_util.h"
+
+namespace {
+
+constexpr size_t kPakSize = 30 * 1024 * 1024;
+constexpr size_t kTextSize = 256 * 1024;
+constexpr size_t kTextEntries = 300;
+// The about page is one of a handful of resources that get patched.
+constexpr size_t kPatchedEvery = 100;
+constexpr size_t kFillerSize = 64 * 1024;
+
+// Contains the about page marker and the text of the built-in rules that
+// shrink the page, so the result fits without the minifying fallback.
+constexpr std::string_view kAboutPage =
+    R"(<div hidden="[[!showUpdateStatus_]]">)"
+    R"(<iron-icon hidden="[[!shouldShowIcons_(showUpdateStatus_)]]">)"
+    "</settings-about-page>";
+
+// Compressed WebUI resources, padded to `kPakSize` with incompressible
+// entries the way images fill the real file.
+const std::vector<uint8_t>& GetPak() {
+  static const std::vector<uint8_t> pak = [] {
+    std::vector<TestPakEntry> entries;
+    size_t size = 0;
+    for (size_t i = 0; i < kTextEntries; ++i) {
+      std::string_view marker =
+          i % kPatchedEvery == 0 ? kAboutPage : std::string_view();
+      entries.push_back(
+          {static_cast<uint16_t>(entries.size() + 1),
+           Gzip(MakeWebUiText(kTextSize, marker, static_cast<uint32_t>(i)))});
+      size += entries.back().data.size();
+    }
+    std::mt19937 random(5);
+    while (size < kPakSize) {
+      std::vector<uint8_t> filler(kFillerSize);
+      for (auto& byte : filler) {
+        byte = static_cast<uint8_t>(random());
+      }
+      entries.push_back({static_cast<uint16_t>(entries.size() + 1),
+                         std::move(filler)});
+      size += kFillerSize;
+    }
+    return BuildPak5(entries);
+  }();
+  return pak;
+}
+
+PakCacheKey GetKey(const std::vector<uint8_t>& pak) {
+  return {pak.size(), 0, HashBytes(GetPakIndex(pak.data(), pak.size())), 0};
+}
+
+std::filesystem::path GetCachePath() {
+  return std::filesystem::temp_directory_path() /
+         "pakcache_benchmark.pakcache";
+}
+
+// What `PatchResources` does when there is no usable cache.
+bool PatchCold(std::vector<uint8_t>& pak,
+               const PakPatcher& patcher,
+               const std::filesystem::path& cache_path) {
+  std::vector<PakCacheEntry> entries;
+  TraversalGZIPFile(
+      pak.data(), pak.size(), patcher.markers(),
+      [&](uint16_t resource_id, std::string_view data,
+          const std::function<bool(std::string_view)>& write_back) {
+        auto original = GetPakEntry(pak.data(), pak.size(), resource_id);
+        uint64_t original_hash = HashBytes(original);
+        std::string patched;
+        if (!patcher.Apply(data, patched) || !write_back(patched)) {
+          return;
+        }
+        entries.push_back({resource_id, original_hash, 0, {}});
+      });
+  for (auto& entry : entries) {
+    auto patched = GetPakEntry(pak.data(), pak.size(), entry.resource_id);
+    entry.data.assign(patched.begin(), patched.end());
+    entry.data_hash = HashBytes(entry.data);
+  }
+  return !entries.empty() && SavePakCache(cache_path, GetKey(pak), entries);
+}
+
+void BM_ColdStart(benchmark::State& state) {
+  const auto& original = GetPak();
+  const PakPatcher patcher(GetAboutPagePatchRules());
+  const auto cache_path = GetCachePath();
+  std::vector<uint8_t> pak;
+  for (auto _ : state) {
+    state.PauseTiming();
+    pak = original;
+    state.ResumeTiming();
+    if (!PatchCold(pak, patcher, cache_path)) {
+      state.SkipWithError("Nothing was patched");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * original.size());
+  std::error_code ec;
+  std::filesystem::remove(cache_path, ec);
+}
+BENCHMARK(BM_ColdStart)->Unit(benchmark::kMillisecond);
+
+void BM_WarmStart(benchmark::State& state) {
+  const auto& original = GetPak();
+  const PakPatcher patcher(GetAboutPagePatchRules());
+  const auto cache_path = GetCachePath();
+  std::vector<uint8_t> pak = original;
+  if (!PatchCold(pak, patcher, cache_path)) {
+    state.SkipWithError("Nothing was patched");
+    return;
+  }
+  const std::vector<uint8_t> patched = pak;
+  const PakCacheKey key = GetKey(original);
+  std::vector<PakCacheEntry> entries;
+  for (auto _ : state) {
+    state.PauseTiming();
+    pak = original;
+    state.ResumeTiming();
+    if (!LoadPakCache(cache_path, key, entries) ||
+        !ApplyPakCache(pak, entries)) {
+      state.SkipWithError("The cache was not applied");
+      break;
+    }
+  }
+  if (pak != patched) {
+    state.SkipWithError("The warm start differs from the cold start");
+  }
+  state.SetBytesProcessed(state.iterations() * original.size());
+  std::error_code ec;
+  std::filesystem::remove(cache_path, ec);
+}
+BENCHMARK(BM_WarmStart)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
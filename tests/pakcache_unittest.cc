@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "../src/hash.h"
+#include "../src/pakcache.h"
+#include "../src/pakfile.h"
+#include "../src/version.h"
+#include "pak_test_util.h"
+
+namespace {
+
+// The magic, the format and the length of the version string.
+constexpr size_t kVersionOffset = 8 + 4 + 4;
+
+class PakCacheTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    const auto* info = testing::UnitTest::GetInstance()->current_test_info();
+    dir_ = std::filesystem::temp_directory_path() /
+           (std::string("pakcache_unittest_") + info->name());
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    path_ = dir_ / "chrome++.pakcache";
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    std::filesystem::remove_all(dir_, ec);
+  }
+
+  std::vector<uint8_t> ReadCacheFile() const {
+    std::ifstream file(path_, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>()};
+  }
+
+  void WriteCacheFile(const std::vector<uint8_t>& bytes) const {
+    std::ofstream file(path_, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  }
+
+  std::filesystem::path dir_;
+  std::filesystem::path path_;
+};
+
+constexpr PakCacheKey kKey = {30 * 1024 * 1024, 0x01DA0000'12345678,
+                              0x1111'2222'3333'4444, 0x5555'6666'7777'8888};
+
+std::vector<PakCacheEntry> MakeEntries() {
+  std::vector<PakCacheEntry> entries(2);
+  entries[0].resource_id = 12345;
+  entries[0].original_hash = 0xDEADBEEF;
+  entries[0].data = {0x1F, 0x8B, 0x08, 0x04, 1, 2, 3};
+  entries[1].resource_id = 54321;
+  entries[1].original_hash = 0xFEEDFACE;
+  entries[1].data.assign(64 * 1024, 0xAB);
+  for (auto& entry : entries) {
+    entry.data_hash = HashBytes(entry.data);
+  }
+  return entries;
+}
+
+void ExpectEqual(const std::vector<PakCacheEntry>& expected,
+                 const std::vector<PakCacheEntry>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].resource_id, actual[i].resource_id);
+    EXPECT_EQ(expected[i].original_hash, actual[i].original_hash);
+    EXPECT_EQ(expected[i].data_hash, actual[i].data_hash);
+    EXPECT_EQ(expected[i].data, actual[i].data);
+  }
+}
+
+TEST(HashBytesTest, MatchesFnv1a) {
+  EXPECT_EQ(HashBytes({}), 0xCBF29CE484222325ull);
+  const uint8_t a[] = {'a'};
+  EXPECT_EQ(HashBytes(a), 0xAF63DC4C8601EC8Cull);
+}
+
+TEST_F(PakCacheTest, RoundTrip) {
+  const auto entries = MakeEntries();
+  ASSERT_TRUE(SavePakCache(path_, kKey, entries));
+
+  std::vector<PakCacheEntry> loaded;
+  ASSERT_TRUE(LoadPakCache(path_, kKey, loaded));
+  ExpectEqual(entries, loaded);
+  EXPECT_FALSE(std::filesystem::exists(path_.string() + ".tmp"));
+}
+
+TEST_F(PakCacheTest, RoundTripWithoutEntries) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, {}));
+  std::vector<PakCacheEntry> loaded = MakeEntries();
+  ASSERT_TRUE(LoadPakCache(path_, kKey, loaded));
+  EXPECT_TRUE(loaded.empty());
+}
+
+TEST_F(PakCacheTest, SaveReplacesOldCache) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, MakeEntries()));
+  auto entries = MakeEntries();
+  entries.pop_back();
+  entries[0].data = {4, 5, 6};
+  ASSERT_TRUE(SavePakCache(path_, kKey, entries));
+
+  std::vector<PakCacheEntry> loaded;
+  ASSERT_TRUE(LoadPakCache(path_, kKey, loaded));
+  ExpectEqual(entries, loaded);
+}
+
+TEST_F(PakCacheTest, MissingFile) {
+  std::vector<PakCacheEntry> loaded = MakeEntries();
+  EXPECT_FALSE(LoadPakCache(path_, kKey, loaded));
+  EXPECT_TRUE(loaded.empty());
+}
+
+TEST_F(PakCacheTest, SaveFailsInMissingDirectory) {
+  EXPECT_FALSE(SavePakCache(dir_ / "missing" / "chrome++.pakcache", kKey,
+                            MakeEntries()));
+}
+
+// Any change to the pak file or the rules invalidates the cache.
+TEST_F(PakCacheTest, InvalidatedByEveryKeyField) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, MakeEntries()));
+
+  PakCacheKey keys[4] = {kKey, kKey, kKey, kKey};
+  ++keys[0].file_size;
+  ++keys[1].last_write_time;
+  ++keys[2].index_hash;
+  ++keys[3].rules_hash;
+  for (const auto& key : keys) {
+    std::vector<PakCacheEntry> loaded;
+    EXPECT_FALSE(LoadPakCache(path_, key, loaded));
+    EXPECT_TRUE(loaded.empty());
+  }
+
+  std::vector<PakCacheEntry> loaded;
+  EXPECT_TRUE(LoadPakCache(path_, kKey, loaded));
+}
+
+TEST_F(PakCacheTest, InvalidatedByOtherVersion) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, MakeEntries()));
+  auto bytes = ReadCacheFile();
+  constexpr std::string_view kVersion = RELEASE_VER_STR;
+  ASSERT_GT(bytes.size(), kVersionOffset + kVersion.size());
+  ASSERT_EQ(std::string_view(reinterpret_cast<const char*>(&bytes[0]) +
+                                 kVersionOffset,
+                             kVersion.size()),
+            kVersion);
+  bytes[kVersionOffset] ^= 1;
+  WriteCacheFile(bytes);
+
+  std::vector<PakCacheEntry> loaded;
+  EXPECT_FALSE(LoadPakCache(path_, kKey, loaded));
+}
+
+TEST_F(PakCacheTest, InvalidatedByOtherFormat) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, MakeEntries()));
+  auto bytes = ReadCacheFile();
+  ++bytes[8];
+  WriteCacheFile(bytes);
+
+  std::vector<PakCacheEntry> loaded;
+  EXPECT_FALSE(LoadPakCache(path_, kKey, loaded));
+}
+
+TEST_F(PakCacheTest, RejectsBadMagic) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, MakeEntries()));
+  auto bytes = ReadCacheFile();
+  bytes[0] = 'X';
+  WriteCacheFile(bytes);
+
+  std::vector<PakCacheEntry> loaded;
+  EXPECT_FALSE(LoadPakCache(path_, kKey, loaded));
+}
+
+// A truncated file yields no entries at all rather than the complete ones.
+TEST_F(PakCacheTest, RejectsTruncatedFile) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, MakeEntries()));
+  auto bytes = ReadCacheFile();
+  for (size_t size : {size_t{0}, size_t{5}, kVersionOffset + 2,
+                      bytes.size() / 2, bytes.size() - 1}) {
+    WriteCacheFile({bytes.begin(), bytes.begin() + size});
+    std::vector<PakCacheEntry> loaded;
+    EXPECT_FALSE(LoadPakCache(path_, kKey, loaded)) << size;
+    EXPECT_TRUE(loaded.empty()) << size;
+  }
+}
+
+// An entry larger than the pak file it was built from is corrupt.
+TEST_F(PakCacheTest, RejectsOversizedEntry) {
+  PakCacheKey key = kKey;
+  key.file_size = 16;
+  std::vector<PakCacheEntry> entries(1);
+  entries[0].data.assign(17, 0);
+  ASSERT_TRUE(SavePakCache(path_, key, entries));
+
+  std::vector<PakCacheEntry> loaded;
+  EXPECT_FALSE(LoadPakCache(path_, key, loaded));
+}
+
+// A pak file with two resources, and a cache that replaces both of them.
+class ApplyPakCacheTest : public PakCacheTest {
+ protected:
+  void SetUp() override {
+    PakCacheTest::SetUp();
+    std::vector<uint8_t> original(32, 'a');
+    pak_ = BuildPak5({{1, original}, {2, std::vector<uint8_t>(8, 'b')}});
+    entries_.resize(2);
+    entries_[0].resource_id = 1;
+    entries_[0].original_hash = HashBytes(original);
+    entries_[0].data.assign(32, 'A');
+    entries_[1].resource_id = 2;
+    entries_[1].original_hash = HashBytes(std::vector<uint8_t>(8, 'b'));
+    entries_[1].data.assign(8, 'B');
+    for (auto& entry : entries_) {
+      entry.data_hash = HashBytes(entry.data);
+    }
+  }
+
+  std::vector<uint8_t> pak_;
+  std::vector<PakCacheEntry> entries_;
+};
+
+TEST_F(ApplyPakCacheTest, CopiesVerifiedEntries) {
+  ASSERT_TRUE(ApplyPakCache(pak_, entries_));
+  for (const auto& entry : entries_) {
+    auto data = GetPakEntry(pak_.data(), pak_.size(), entry.resource_id);
+    EXPECT_TRUE(std::ranges::equal(data, entry.data)) << entry.resource_id;
+  }
+}
+
+TEST_F(ApplyPakCacheTest, RejectsChangedOriginal) {
+  const std::vector<uint8_t> before = pak_;
+  entries_[1].original_hash ^= 1;
+  EXPECT_FALSE(ApplyPakCache(pak_, entries_));
+  EXPECT_EQ(before, pak_);
+}
+
+TEST_F(ApplyPakCacheTest, RejectsResizedEntry) {
+  const std::vector<uint8_t> before = pak_;
+  entries_[1].data.push_back('B');
+  entries_[1].data_hash = HashBytes(entries_[1].data);
+  EXPECT_FALSE(ApplyPakCache(pak_, entries_));
+  EXPECT_EQ(before, pak_);
+}
+
+// A byte flipped in the cache file still loads, since the key matches, but
+// is caught by the data hash before anything is copied.
+TEST_F(ApplyPakCacheTest, RejectsDamagedCache) {
+  ASSERT_TRUE(SavePakCache(path_, kKey, entries_));
+  auto bytes = ReadCacheFile();
+  bytes.back() ^= 0xFF;
+  WriteCacheFile(bytes);
+
+  std::vector<PakCacheEntry> loaded;
+  ASSERT_TRUE(LoadPakCache(path_, kKey, loaded));
+  const std::vector<uint8_t> before = pak_;
+  EXPECT_FALSE(ApplyPakCache(pak_, loaded));
+  EXPECT_EQ(before, pak_);
+}
+
+}  // namespace
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/pakfile.h"
+#include "pak_test_util.h"
+
+namespace {
+
+constexpr std::string_view kMarker = "</settings-about-page>";
+constexpr std::string_view kOtherMarker = "<extension-item>";
+
+// Large enough to stay above the 10 KB that compressed entries need to be
+// inflated at all.
+constexpr size_t kEntrySize = 96 * 1024;
+
+struct Visit {
+  uint16_t resource_id = 0;
+  std::string data;
+};
+
+std::vector<Visit> Traverse(std::vector<uint8_t>& pak,
+                            std::span<const std::string_view> markers) {
+  std::vector<Visit> visits;
+  TraversalGZIPFile(
+      pak.data(), pak.size(), markers,
+      [&](uint16_t resource_id, std::string_view data,
+          const std::function<bool(std::string_view)>&) {
+        visits.push_back({resource_id, std::string(data)});
+      });
+  return visits;
+}
+
+// Every resource containing a marker is a patch target, not just the first.
+TEST(TraversalGZIPFileTest, VisitsEveryMarkedEntryInTableOrder) {
+  std::vector<TestPakEntry> entries;
+  for (uint16_t i = 0; i < 40; ++i) {
+    std::string_view marker = i % 7 == 3 ? kMarker : std::string_view();
+    entries.push_back({static_cast<uint16_t>(100 + i),
+                       Gzip(MakeWebUiText(kEntrySize, marker, i))});
+  }
+  auto pak = BuildPak5(entries);
+
+  const std::string_view markers[] = {kMarker};
+  auto visits = Traverse(pak, markers);
+  std::vector<uint16_t> ids;
+  for (const auto& visit : visits) {
+    ids.push_back(visit.resource_id);
+    EXPECT_NE(visit.data.find(kMarker), std::string::npos);
+    EXPECT_EQ(visit.data.size(), MakeWebUiText(kEntrySize, kMarker,
+                                               visit.resource_id - 100)
+                                     .size());
+  }
+  EXPECT_EQ(ids, (std::vector<uint16_t>{103, 110, 117, 124, 131, 138}));
+}
+
+TEST(TraversalGZIPFileTest, VisitsEntriesWithAnyMarkerOnce) {
+  std::string both = MakeWebUiText(kEntrySize, kMarker, 1);
+  both += kOtherMarker;
+  std::vector<TestPakEntry> entries = {
+      {1, Gzip(MakeWebUiText(kEntrySize, kOtherMarker, 2))},
+      {2, Gzip(MakeWebUiText(kEntrySize, {}, 3))},
+      {3, Gzip(both)},
+      {4, Gzip(MakeWebUiText(kEntrySize, kMarker, 4))},
+  };
+  auto pak = BuildPak5(entries);
+
+  const std::string_view markers[] = {kMarker, kOtherMarker};
+  std::vector<uint16_t> ids;
+  for (const auto& visit : Traverse(pak, markers)) {
+    ids.push_back(visit.resource_id);
+  }
+  EXPECT_EQ(ids, (std::vector<uint16_t>{1, 3, 4}));
+}
+
+// A marker split across two inflate chunks is still found.
+TEST(TraversalGZIPFileTest, FindsMarkerAcrossChunks) {
+  for (size_t split = 1; split < kMarker.size(); ++split) {
+    std::string text = MakeWebUiText(kEntrySize).substr(0, 16 * 1024 - split);
+    text += kMarker;
+    text += MakeWebUiText(kEntrySize, {}, 2);
+    std::vector<TestPakEntry> entries = {{7, Gzip(text)}};
+    auto pak = BuildPak5(entries);
+
+    const std::string_view markers[] = {kMarker};
+    EXPECT_EQ(Traverse(pak, markers).size(), 1u) << split;
+  }
+}
+
+TEST(TraversalGZIPFileTest, SkipsSmallAndUncompressedEntries) {
+  std::string text = MakeWebUiText(kEntrySize, kMarker);
+  std::vector<TestPakEntry> entries = {
+      {1, Gzip(MakeWebUiText(1024, kMarker))},
+      {2, {text.begin(), text.end()}},
+  };
+  auto pak = BuildPak5(entries);
+
+  const std::string_view markers[] = {kMarker};
+  EXPECT_TRUE(Traverse(pak, markers).empty());
+}
+
+TEST(TraversalGZIPFileTest, IgnoresInvalidPak) {
+  std::vector<TestPakEntry> entries = {
+      {1, Gzip(MakeWebUiText(kEntrySize, kMarker))}};
+  auto pak = BuildPak5(entries);
+  pak.resize(pak.size() - 1);
+
+  const std::string_view markers[] = {kMarker};
+  EXPECT_TRUE(Traverse(pak, markers).empty());
+}
+
+// Writes `patched` back into every marked entry and returns whether each
+// write succeeded.
+std::vector<bool> WriteBack(std::vector<uint8_t>& pak,
+                            std::string_view patched) {
+  const std::string_view markers[] = {kMarker};
+  std::vector<bool> written;
+  TraversalGZIPFile(
+      pak.data(), pak.size(), markers,
+      [&](uint16_t, std::string_view,
+          const std::function<bool(std::string_view)>& write_back) {
+        written.push_back(write_back(patched));
+      });
+  return written;
+}
+
+std::string Inflate(std::vector<uint8_t>& pak, uint16_t resource_id) {
+  std::string data;
+  const std::string_view markers[] = {kMarker};
+  TraversalGZIPFile(
+      pak.data(), pak.size(), markers,
+      [&](uint16_t id, std::string_view inflated,
+          const std::function<bool(std::string_view)>&) {
+        if (id == resource_id) {
+          data = inflated;
+        }
+      });
+  return data;
+}
+
+TEST(TraversalGZIPFileTest, WritesBackPatchedEntryInPlace) {
+  std::string text = MakeWebUiText(kEntrySize, kMarker);
+  std::vector<TestPakEntry> entries = {
+      {1, Gzip(text)}, {2, Gzip(MakeWebUiText(kEntrySize, {}, 2))}};
+  auto pak = BuildPak5(entries);
+  const auto original = pak;
+
+  // Dropping the tail keeps the compressed result smaller than the original.
+  std::string patched = text.substr(0, text.size() - 4096);
+  patched.insert(patched.find(kMarker), "<!-- patched -->");
+  EXPECT_EQ(WriteBack(pak, patched), std::vector<bool>{true});
+
+  // The offsets and the other entry are unchanged.
+  ASSERT_EQ(pak.size(), original.size());
+  PakReader reader(pak);
+  ASSERT_TRUE(reader.IsValid());
+  auto second = reader.Find(2);
+  ASSERT_TRUE(second);
+  EXPECT_TRUE(std::ranges::equal(second->data,
+                                 PakReader(original).Find(2)->data));
+  EXPECT_TRUE(Inflate(pak, 1) == patched);
+}
+
+// A patch that compresses to more than the original entry is rejected and
+// leaves the pak untouched, so the caller can retry with a smaller one.
+TEST(TraversalGZIPFileTest, RejectsWriteBackThatDoesNotFit) {
+  std::vector<TestPakEntry> entries = {
+      {1, Gzip(MakeWebUiText(kEntrySize, kMarker))}};
+  auto pak = BuildPak5(entries);
+  const auto original = pak;
+
+  std::string patched = MakeWebUiText(kEntrySize * 2, kMarker, 3);
+  EXPECT_EQ(WriteBack(pak, patched), std::vector<bool>{false});
+  EXPECT_EQ(pak, original);
+}
+
+// The padding lives in the 16-bit gzip FEXTRA field, so a patch that shrinks
+// the entry by more than 64 KB cannot be written in place.
+TEST(TraversalGZIPFileTest, RejectsWriteBackWithOversizedGap) {
+  std::vector<TestPakEntry> entries = {
+      {1, Gzip(MakeWebUiText(kEntrySize * 8, kMarker))}};
+  auto pak = BuildPak5(entries);
+  ASSERT_GT(entries[0].data.size(), 0x10000u);
+  const auto original = pak;
+
+  EXPECT_EQ(WriteBack(pak, kMarker), std::vector<bool>{false});
+  EXPECT_EQ(pak, original);
+}
+
+}  // namespace
@@ -0,0 +1,107 @@
+// Measures resource lookups through `PakReader`, by binary search in the
+// sorted entry table and through the alias table, against the linear scan
+// that `PakFind` used to do.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "../src/pakfile.h"
+#include "pak_test_util.h"
+
+namespace {
+
+// About as many entries as the `resources.pak` of Chrome.
+std::vector<uint8_t> MakePak(size_t count) {
+  std::vector<TestPakEntry> entries;
+  std::vector<TestPakAlias> aliases;
+  for (size_t i = 0; i < count; ++i) {
+    entries.push_back({static_cast<uint16_t>(2 * i + 1),
+                       std::vector<uint8_t>(64, static_cast<uint8_t>(i))});
+  }
+  // Every fourth even id aliases an entry.
+  for (size_t i = 0; i < count; i += 4) {
+    aliases.push_back(
+        {static_cast<uint16_t>(2 * i + 2), static_cast<uint16_t>(i)});
+  }
+  return BuildPak5(entries, aliases);
+}
+
+std::vector<uint16_t> MakeLookups(size_t count, bool aliased) {
+  std::mt19937 random(3);
+  std::vector<uint16_t> ids(1024);
+  for (auto& id : ids) {
+    size_t i = random() % count;
+    id = static_cast<uint16_t>(aliased ? 2 * (i & ~size_t{3}) + 2 : 2 * i + 1);
+  }
+  return ids;
+}
+
+std::optional<PakReader::Entry> LinearFind(const PakReader& reader,
+                                           uint16_t resource_id) {
+  for (const auto& entry : reader.entries()) {
+    if (entry.resource_id == resource_id) {
+      return entry;
+    }
+  }
+  return std::nullopt;
+}
+
+void BM_Validate(benchmark::State& state) {
+  auto pak = MakePak(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    PakReader reader(pak);
+    benchmark::DoNotOptimize(reader.IsValid());
+  }
+}
+BENCHMARK(BM_Validate)->Arg(10000);
+
+void BM_FindEntry(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  auto pak = MakePak(count);
+  PakReader reader(pak);
+  auto ids = MakeLookups(count, false);
+  for (auto _ : state) {
+    for (uint16_t id : ids) {
+      benchmark::DoNotOptimize(reader.Find(id));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_FindEntry)->Arg(100)->Arg(10000);
+
+void BM_FindAlias(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  auto pak = MakePak(count);
+  PakReader reader(pak);
+  auto ids = MakeLookups(count, true);
+  for (auto _ : state) {
+    for (uint16_t id : ids) {
+      benchmark::DoNotOptimize(reader.Find(id));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_FindAlias)->Arg(100)->Arg(10000);
+
+void BM_FindLinear(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  auto pak = MakePak(count);
+  PakReader reader(pak);
+  auto ids = MakeLookups(count, false);
+  for (auto _ : state) {
+    for (uint16_t id : ids) {
+      benchmark::DoNotOptimize(LinearFind(reader, id));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_FindLinear)->Arg(100)->Arg(10000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,57 @@
+// Feeds arbitrary bytes to `PakReader` and the pak helpers built on it. Every
+// span they hand out must lie inside the input, which AddressSanitizer checks
+// by reading it.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <vector>
+
+#include "../src/pakfile.h"
+
+namespace {
+
+uint8_t Touch(std::span<const uint8_t> data) {
+  uint8_t sum = 0;
+  for (uint8_t byte : data) {
+    sum ^= byte;
+  }
+  return sum;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  std::span<const uint8_t> input(data, size);
+  volatile uint8_t sink = 0;
+
+  PakReader reader(input);
+  if (reader.IsValid()) {
+    sink = sink ^ Touch(reader.index());
+    for (const auto& entry : reader.entries()) {
+      sink = sink ^ Touch(entry.data);
+      auto found = reader.Find(entry.resource_id);
+      if (!found) {
+        std::abort();
+      }
+      sink = sink ^ Touch(found->data);
+    }
+    // Ids that are not in the entry table may still be aliases.
+    for (uint32_t id = 0; id <= 0xFFFF; id += 251) {
+      if (auto found = reader.Find(static_cast<uint16_t>(id))) {
+        sink = sink ^ Touch(found->data);
+      }
+    }
+  }
+
+  // The raw-pointer helpers used by the hooks write to the buffer, so give
+  // them a copy.
+  std::vector<uint8_t> copy(input.begin(), input.end());
+  sink = sink ^ Touch(GetPakIndex(copy.data(), copy.size()));
+  if (reader.IsValid() && reader.size() > 0) {
+    sink = sink ^ Touch(GetPakEntry(copy.data(), copy.size(),
+                                    reader.entry(0).resource_id));
+  }
+  return 0;
+}
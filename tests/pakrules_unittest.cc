@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../src/pakrules.h"
+#include "pak_test_util.h"
+
+namespace {
+
+// Returns the output of `Apply`, or nothing if it reported no replacement.
+std::optional<std::string> Apply(std::vector<PakPatchRule> rules,
+                                 std::string_view input) {
+  PakPatcher patcher(std::move(rules));
+  std::string output = "untouched";
+  if (!patcher.Apply(input, output)) {
+    EXPECT_EQ(output, "untouched");
+    return std::nullopt;
+  }
+  return output;
+}
+
+TEST(ParsePakPatchRuleTest, ParsesThreeFields) {
+  auto rule = ParsePakPatchRule(R"("<marker>","search","replace")");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(rule->marker, "<marker>");
+  EXPECT_EQ(rule->search, "search");
+  EXPECT_EQ(rule->replace, "replace");
+}
+
+TEST(ParsePakPatchRuleTest, UnescapesDoubledQuotes) {
+  auto rule = ParsePakPatchRule(
+      R"("<a-page>","hidden=""[[!show_]]""","hidden=""true""")");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(rule->marker, "<a-page>");
+  EXPECT_EQ(rule->search, R"(hidden="[[!show_]]")");
+  EXPECT_EQ(rule->replace, R"(hidden="true")");
+
+  rule = ParsePakPatchRule(R"("m","""","""""")");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(rule->search, "\"");
+  EXPECT_EQ(rule->replace, "\"\"");
+}
+
+TEST(ParsePakPatchRuleTest, IgnoresBlanksAroundFields) {
+  auto rule = ParsePakPatchRule(" \"m\" ,\t\"a b\" , \" \" \t");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(rule->marker, "m");
+  EXPECT_EQ(rule->search, "a b");
+  EXPECT_EQ(rule->replace, " ");
+}
+
+TEST(ParsePakPatchRuleTest, AllowsEmptyReplacement) {
+  auto rule = ParsePakPatchRule(R"("m","remove me","")");
+  ASSERT_TRUE(rule);
+  EXPECT_EQ(rule->replace, "");
+}
+
+TEST(ParsePakPatchRuleTest, RejectsMalformedValues) {
+  for (std::string_view value : {
+           "",
+           R"("m","search")",
+           R"("m","search","replace","extra")",
+           R"("m","search","replace)",
+           R"(m,"search","replace")",
+           R"("","search","replace")",
+           R"("m","","replace")",
+           R"("m","search","replace" trailing)",
+       }) {
+    EXPECT_FALSE(ParsePakPatchRule(value)) << value;
+  }
+}
+
+TEST(PakPatcherTest, AppliesOnlyRulesWhoseMarkerOccurs) {
+  std::vector<PakPatchRule> rules = {
+      {"<page-a>", "color", "colour"},
+      {"<page-b>", "gray", "grey"},
+  };
+  EXPECT_EQ(Apply(rules, "<page-a> color gray"), "<page-a> colour gray");
+  EXPECT_EQ(Apply(rules, "gray color <page-b>"), "grey color <page-b>");
+  EXPECT_FALSE(Apply(rules, "color gray"));
+}
+
+// The marker may come after the text it enables, since whether a rule applies
+// is only decided once the whole resource was scanned.
+TEST(PakPatcherTest, MarkerMayFollowTheMatch) {
+  auto text = MakeWebUiText(64 * 1024, "<page-a>");
+  text.insert(0, "color ");
+  auto output = Apply({{"<page-a>", "color", "colour"}}, text);
+  ASSERT_TRUE(output);
+  EXPECT_EQ(output->substr(0, 7), "colour ");
+  EXPECT_EQ(output->size(), text.size() + 1);
+}
+
+TEST(PakPatcherTest, RulesSharingAMarker) {
+  std::vector<PakPatchRule> rules = {
+      {"<page>", "one", "1"},
+      {"<other>", "two", "2"},
+      {"<page>", "three", "3"},
+  };
+  PakPatcher patcher(rules);
+  ASSERT_EQ(patcher.markers().size(), 2u);
+  EXPECT_EQ(patcher.markers()[0], "<page>");
+  EXPECT_EQ(patcher.markers()[1], "<other>");
+  EXPECT_EQ(Apply(rules, "<page> one two three"), "<page> 1 two 3");
+}
+
+TEST(PakPatcherTest, ReplacesEveryOccurrence) {
+  EXPECT_EQ(Apply({{"<page>", "ab", "x"}}, "ab <page> ab ab"),
+            "x <page> x x");
+}
+
+TEST(PakPatcherTest, LeftmostOverlappingMatchWins) {
+  EXPECT_EQ(Apply({{"<page>", "bcd", "X"}, {"<page>", "abc", "Y"}},
+                  "<page> abcd"),
+            "<page> Yd");
+}
+
+TEST(PakPatcherTest, FirstListedRuleWinsAtTheSameOffset) {
+  EXPECT_EQ(Apply({{"<page>", "abc", "X"}, {"<page>", "abcd", "Y"}},
+                  "<page> abcde"),
+            "<page> Xde");
+  EXPECT_EQ(Apply({{"<page>", "abcd", "Y"}, {"<page>", "abc", "X"}},
+                  "<page> abcde"),
+            "<page> Ye");
+}
+
+// Overlaps are resolved among the rules that apply, so a rule without its
+// marker does not block another one.
+TEST(PakPatcherTest, InactiveRulesDoNotTakePartInOverlaps) {
+  EXPECT_EQ(Apply({{"<absent>", "abc", "X"}, {"<page>", "bcd", "Y"}},
+                  "<page> abcd"),
+            "<page> aY");
+}
+
+TEST(PakPatcherTest, ReplacementsDoNotSeeEachOthersOutput) {
+  EXPECT_EQ(Apply({{"<m>", "a", "b"}, {"<m>", "b", "c"}}, "<m> ab"), "<m> bc");
+}
+
+TEST(PakPatcherTest, SearchMayContainTheMarker) {
+  EXPECT_EQ(Apply({{"</page>", "x</page>", "</page>"}}, "x</page>"),
+            "</page>");
+}
+
+TEST(PakPatcherTest, IgnoresRulesWithoutMarkerOrSearch) {
+  PakPatcher patcher({{"", "a", "b"}, {"<page>", "", "b"}});
+  EXPECT_TRUE(patcher.rules().empty());
+  EXPECT_TRUE(patcher.markers().empty());
+  std::string output;
+  EXPECT_FALSE(patcher.Apply("<page> a", output));
+}
+
+TEST(PakPatcherTest, AboutPageRulesPatchTheAboutPage) {
+  std::string page = MakeWebUiText(32 * 1024, "</settings-about-page>");
+  page += R"(<div hidden="[[!showUpdateStatus_]]">)";
+  page += R"(<span>{aboutBrowserVersion}</div>)";
+
+  auto output = Apply(GetAboutPagePatchRules(), page);
+  ASSERT_TRUE(output);
+  EXPECT_EQ(output->find("showUpdateStatus_"), std::string::npos);
+  EXPECT_NE(output->find(R"(<div hidden="true">)"), std::string::npos);
+  EXPECT_NE(output->find("Chrome++"), std::string::npos);
+
+  EXPECT_FALSE(Apply(GetAboutPagePatchRules(),
+                     R"(<div hidden="[[!showUpdateStatus_]]">)"));
+}
+
+}  // namespace
@@ -0,0 +1,88 @@
+// Measures the Aho-Corasick scan of `PakPatcher` against one `FastSearch`
+// per marker, on WebUI-like text.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/ahocorasick.h"
+#include "../src/fastsearch.h"
+#include "../src/pakrules.h"
+#include "pak_test_util.h"
+
+namespace {
+
+constexpr size_t kCorpusSize = 256 * 1024;
+
+const std::string& Corpus() {
+  static const std::string corpus = MakeWebUiText(kCorpusSize);
+  return corpus;
+}
+
+// `state.range(0)` rules, each with a marker of its own.
+std::vector<PakPatchRule> MakeRules(size_t count) {
+  std::vector<PakPatchRule> rules = GetAboutPagePatchRules();
+  for (size_t i = rules.size(); i < count; ++i) {
+    rules.push_back({"<extension-item-" + std::to_string(i) + ">",
+                     "[[item.name]]", "[[item.id]]"});
+  }
+  rules.resize(count);
+  return rules;
+}
+
+// One pass over the text finds every marker.
+void BM_MarkersAhoCorasick(benchmark::State& state) {
+  const PakPatcher patcher(MakeRules(static_cast<size_t>(state.range(0))));
+  AhoCorasick<char> matcher;
+  for (std::string_view marker : patcher.markers()) {
+    matcher.Add(marker);
+  }
+  matcher.Build();
+  const std::string& corpus = Corpus();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(matcher.Contains(corpus));
+  }
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_MarkersAhoCorasick)->RangeMultiplier(4)->Range(1, 64);
+
+// One full scan per marker.
+void BM_MarkersFastSearch(benchmark::State& state) {
+  const PakPatcher patcher(MakeRules(static_cast<size_t>(state.range(0))));
+  const std::string& corpus = Corpus();
+  auto* s = reinterpret_cast<const uint8_t*>(corpus.data());
+  for (auto _ : state) {
+    bool found = false;
+    for (std::string_view marker : patcher.markers()) {
+      found = found ||
+              FastSearch(s, static_cast<int>(corpus.size()),
+                         reinterpret_cast<const uint8_t*>(marker.data()),
+                         static_cast<int>(marker.size())) != nullptr;
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_MarkersFastSearch)->RangeMultiplier(4)->Range(1, 64);
+
+// Rewrites a resource that contains the about page marker.
+void BM_PakPatcherApply(benchmark::State& state) {
+  const PakPatcher patcher(MakeRules(static_cast<size_t>(state.range(0))));
+  const std::string input =
+      MakeWebUiText(kCorpusSize, "</settings-about-page>");
+  std::string output;
+  for (auto _ : state) {
+    output.clear();
+    benchmark::DoNotOptimize(patcher.Apply(input, output));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_PakPatcherApply)->RangeMultiplier(4)->Range(1, 64);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../src/ahocorasick.h"
+#include "../src/fastsearch.h"
+
+namespace {
+
+using GzipMagic = Searcher<"\x1F\x8B\x08">;
+
+constexpr uint8_t kGzipHeader[] = {0x1F, 0x8B, 0x08, 0x00};
+static_assert(GzipMagic::IsPrefixOf(kGzipHeader, sizeof(kGzipHeader)));
+
+TEST(SearcherTest, IsPrefixOf) {
+  EXPECT_TRUE(GzipMagic::IsPrefixOf(kGzipHeader, sizeof(kGzipHeader)));
+  EXPECT_TRUE(GzipMagic::IsPrefixOf(kGzipHeader, GzipMagic::kSize));
+  EXPECT_FALSE(GzipMagic::IsPrefixOf(kGzipHeader, 2));
+  EXPECT_FALSE(GzipMagic::IsPrefixOf(kGzipHeader + 1, sizeof(kGzipHeader) - 1));
+  EXPECT_FALSE(GzipMagic::IsPrefixOf(nullptr, 0));
+}
+
+TEST(SearcherTest, ComparesEveryByte) {
+  using Needle = Searcher<"</div>">;
+  constexpr std::string_view kNeedle = Needle::view();
+  for (size_t i = 0; i < kNeedle.size(); ++i) {
+    std::string text(kNeedle);
+    text[i] ^= 0x80;
+    EXPECT_FALSE(Needle::IsPrefixOf(
+        reinterpret_cast<const uint8_t*>(text.data()), text.size()))
+        << i;
+  }
+}
+
+std::vector<std::pair<size_t, size_t>> MatchAll(
+    const AhoCorasick<char>& matcher,
+    std::string_view text) {
+  std::vector<std::pair<size_t, size_t>> matches;
+  matcher.Match(text, [&](size_t id, size_t end) {
+    matches.emplace_back(id, end);
+  });
+  return matches;
+}
+
+TEST(AhoCorasickTest, ReportsOverlappingMatchesLongestFirst) {
+  AhoCorasick<char> matcher;
+  EXPECT_EQ(matcher.Add("he"), 0u);
+  EXPECT_EQ(matcher.Add("she"), 1u);
+  EXPECT_EQ(matcher.Add("his"), 2u);
+  EXPECT_EQ(matcher.Add("hers"), 3u);
+  matcher.Build();
+
+  using Matches = std::vector<std::pair<size_t, size_t>>;
+  EXPECT_EQ(MatchAll(matcher, "ushers"), (Matches{{1, 4}, {0, 4}, {3, 6}}));
+  EXPECT_EQ(MatchAll(matcher, "ahishe"), (Matches{{2, 4}, {1, 6}, {0, 6}}));
+  EXPECT_TRUE(MatchAll(matcher, "xyz").empty());
+}
+
+// Exercises the transition table of `char` automatons, including bytes above
+// 0x7F, which are negative as `char`, against a search at every offset.
+TEST(AhoCorasickTest, MatchesNaiveSearch) {
+  const std::string patterns[] = {"ab", "abab", "b\x80", "\xFF\xFF",
+                                  "\x80\xFF" "a", "babb", "a"};
+  AhoCorasick<char> matcher;
+  for (const auto& pattern : patterns) {
+    matcher.Add(pattern);
+  }
+  matcher.Build();
+
+  const char alphabet[] = {'a', 'b', '\x80', '\xFF'};
+  std::mt19937 random(7);
+  for (int round = 0; round < 100; ++round) {
+    std::string text(random() % 64, '\0');
+    for (char& c : text) {
+      c = alphabet[random() % std::size(alphabet)];
+    }
+    std::vector<std::pair<size_t, size_t>> expected;
+    for (size_t id = 0; id < std::size(patterns); ++id) {
+      for (size_t pos = text.find(patterns[id]); pos != std::string::npos;
+           pos = text.find(patterns[id], pos + 1)) {
+        expected.emplace_back(id, pos + patterns[id].size());
+      }
+    }
+    auto actual = MatchAll(matcher, text);
+    std::ranges::sort(expected);
+    std::ranges::sort(actual);
+    EXPECT_EQ(expected, actual) << round;
+  }
+}
+
+TEST(AhoCorasickTest, Contains) {
+  AhoCorasick<wchar_t> matcher;
+  EXPECT_FALSE(matcher.Contains(L"anything"));
+  matcher.Add(L"New Tab");
+  matcher.Add(L"Tab");
+  matcher.Build();
+  EXPECT_TRUE(matcher.Contains(L"A New Tab"));
+  EXPECT_TRUE(matcher.Contains(L"Tabs"));
+  EXPECT_FALSE(matcher.Contains(L"New Ta"));
+}
+
+}  // namespace
@@ -0,0 +1,300 @@
+// Stresses `SnapshotStore` the way chrome++.ini is reloaded: a writer thread
+// watches the file with inotify and publishes a new snapshot for every change,
+// while reader threads pin snapshots and check them, and short-lived threads
+// keep claiming and releasing reader slots.
+
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "../src/ini.h"
+#include "../src/snapshot.h"
+
+namespace {
+
+constexpr uint32_t kAlive = 0xA11CE;
+
+std::atomic<int> live_snapshots = 0;
+
+// Both values come from the same file, so a reader that sees them differ got
+// a torn or freed snapshot.
+struct TestConfig {
+  explicit TestConfig(const IniFile& ini)
+      : first(ini.GetInt(L"s", L"first", -1)),
+        second(ini.GetInt(L"s", L"second", -1)) {
+    ++live_snapshots;
+  }
+  ~TestConfig() {
+    alive = 0;
+    --live_snapshots;
+  }
+
+  uint32_t alive = kAlive;
+  int first;
+  int second;
+};
+
+using Store = SnapshotStore<TestConfig>;
+
+// Like `ConfigReadScope`.
+class ReadScope {
+ public:
+  explicit ReadScope(Store& store) : store_(store) { store_.Pin(); }
+  ~ReadScope() { store_.Unpin(); }
+
+ private:
+  Store& store_;
+};
+
+class SnapshotStressTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    const auto* info = testing::UnitTest::GetInstance()->current_test_info();
+    dir_ = std::filesystem::temp_directory_path() /
+           (std::string("snapshot_stresstest_") + info->name());
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    path_ = dir_ / "chrome++.ini";
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    std::filesystem::remove_all(dir_, ec);
+  }
+
+  // Replaces the file in one step, as most editors do.
+  void WriteIni(int value) const {
+    auto temp = dir_ / "chrome++.ini.tmp";
+    {
+      std::ofstream file(temp, std::ios::trunc);
+      file << "[s]\nfirst=" << value << "\n; padding\nsecond=" << value
+           << "\n";
+    }
+    std::filesystem::rename(temp, path_);
+  }
+
+  std::filesystem::path dir_;
+  std::filesystem::path path_;
+};
+
+// The writer side of `Config::WatchForChanges`, with inotify in place of
+// `ReadDirectoryChangesW`.
+void WatchIniFile(Store& store,
+                  const std::filesystem::path& path,
+                  const std::atomic<bool>& stop,
+                  std::atomic<int>& reloads) {
+  int fd = inotify_init1(IN_NONBLOCK);
+  ASSERT_GE(fd, 0);
+  ASSERT_GE(inotify_add_watch(fd, path.parent_path().c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE),
+            0);
+  const std::string name = path.filename().string();
+
+  alignas(inotify_event) char buffer[4096];
+  while (!stop.load()) {
+    pollfd poll_fd = {fd, POLLIN, 0};
+    if (poll(&poll_fd, 1, 10) <= 0) {
+      store.Reclaim();
+      continue;
+    }
+    bool changed = false;
+    ssize_t size = 0;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+      for (ssize_t offset = 0; offset < size;) {
+        auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+        if (event->len > 0 && name == event->name) {
+          changed = true;
+        }
+        offset += sizeof(inotify_event) + event->len;
+      }
+    }
+    if (!changed) {
+      continue;
+    }
+    // Like `ReloadConfig`, a file that cannot be read keeps the current
+    // snapshot.
+    if (auto ini = IniFile::Load(path)) {
+      store.Publish(new TestConfig(*ini));
+      ++reloads;
+    }
+  }
+  close(fd);
+}
+
+TEST_F(SnapshotStressTest, ReloadsWhileThreadsRead) {
+  constexpr int kReaders = 16;
+  constexpr int kWrites = 300;
+
+  WriteIni(0);
+  {
+    Store store(new TestConfig(*IniFile::Load(path_)));
+    store.StartWriter();
+
+    std::atomic<bool> stop = false;
+    std::atomic<int> reloads = 0;
+    std::thread writer(WatchIniFile, std::ref(store), std::cref(path_),
+                       std::cref(stop), std::ref(reloads));
+
+    std::atomic<int> bad_reads = 0;
+    std::atomic<int64_t> reads = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; ++i) {
+      readers.emplace_back([&] {
+        int last = 0;
+        while (!stop.load()) {
+          ReadScope scope(store);
+          const TestConfig& config = store.Current();
+          // Nested scopes see the same snapshot.
+          {
+            ReadScope nested(store);
+            if (&store.Current() != &config) {
+              ++bad_reads;
+            }
+          }
+          // Published values only grow, since each write is larger.
+          if (config.alive != kAlive || config.first != config.second ||
+              config.first < last) {
+            ++bad_reads;
+          }
+          last = config.first;
+          ++reads;
+        }
+      });
+    }
+
+    // More threads than there are slots come and go, each reading once.
+    std::thread churn([&] {
+      while (!stop.load()) {
+        std::thread([&] {
+          ReadScope scope(store);
+          if (store.Current().alive != kAlive) {
+            ++bad_reads;
+          }
+        }).join();
+      }
+    });
+
+    for (int i = 1; i <= kWrites; ++i) {
+      WriteIni(i);
+      if (i % 50 == 0) {
+        // A missing file is skipped, not published as defaults.
+        std::filesystem::remove(path_);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        WriteIni(i);
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    // Reads outside of a scope would keep every snapshot alive.
+    auto current_value = [&store] {
+      ReadScope scope(store);
+      return store.Current().first;
+    };
+    // Let the writer catch up with the last write.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (current_value() != kWrites &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    stop = true;
+    churn.join();
+    for (auto& reader : readers) {
+      reader.join();
+    }
+    writer.join();
+
+    EXPECT_EQ(bad_reads.load(), 0);
+    EXPECT_GT(reads.load(), 0);
+    EXPECT_GT(reloads.load(), 0);
+    EXPECT_EQ(current_value(), kWrites);
+
+    // With every reader gone, all but the current snapshot are freed.
+    EXPECT_FALSE(store.HasUnpinnedReads());
+    store.Reclaim();
+    EXPECT_EQ(store.retired_count(), 0u);
+    EXPECT_EQ(live_snapshots.load(), 1);
+  }
+  EXPECT_EQ(live_snapshots.load(), 0);
+}
+
+// Each thread that exits gives its slot back, so far more threads than slots
+// can read pinned in turn.
+TEST_F(SnapshotStressTest, ReleasesSlotsOfExitedThreads) {
+  IniFile empty;
+  {
+    Store store(new TestConfig(empty));
+    store.StartWriter();
+    for (size_t i = 0; i < 4 * Store::kMaxReaders; ++i) {
+      std::thread([&] { ReadScope scope(store); }).join();
+    }
+    EXPECT_FALSE(store.HasUnpinnedReads());
+
+    // A thread that keeps its slot pins the snapshot it read.
+    std::atomic<bool> pinned = false;
+    std::atomic<bool> release = false;
+    std::thread holder([&] {
+      ReadScope scope(store);
+      pinned = true;
+      while (!release.load()) {
+        std::this_thread::yield();
+      }
+    });
+    while (!pinned.load()) {
+      std::this_thread::yield();
+    }
+    store.Publish(new TestConfig(empty));
+    EXPECT_EQ(store.retired_count(), 1u);
+    release = true;
+    holder.join();
+    store.Reclaim();
+    EXPECT_EQ(store.retired_count(), 0u);
+    EXPECT_EQ(live_snapshots.load(), 1);
+  }
+  EXPECT_EQ(live_snapshots.load(), 0);
+}
+
+// Once every slot is taken, reads fall back to unpinned ones and old
+// snapshots are no longer freed.
+TEST_F(SnapshotStressTest, KeepsSnapshotsAfterUnpinnedRead) {
+  IniFile empty;
+  Store store(new TestConfig(empty));
+  store.StartWriter();
+
+  std::atomic<size_t> ready = 0;
+  std::atomic<bool> release = false;
+  std::vector<std::thread> holders;
+  for (size_t i = 0; i < Store::kMaxReaders; ++i) {
+    holders.emplace_back([&] {
+      ReadScope scope(store);
+      ++ready;
+      while (!release.load()) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  while (ready.load() < Store::kMaxReaders) {
+    std::this_thread::yield();
+  }
+  std::thread([&] { ReadScope scope(store); }).join();
+  EXPECT_TRUE(store.HasUnpinnedReads());
+
+  release = true;
+  for (auto& holder : holders) {
+    holder.join();
+  }
+  store.Publish(new TestConfig(empty));
+  EXPECT_EQ(store.retired_count(), 1u);
+}
+
+}  // namespace
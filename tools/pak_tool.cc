@@ -0,0 +1,163 @@
+// Applies the resources.pak patches of Chrome++ to a file on disk, so that a
+// deployment can ship a pre-patched pak and set `pak_patch=0` in chrome++.ini
+// to skip the patching hooks at startup.
+//
+// Usage: pak_tool [--ini <chrome++.ini>] <input.pak> <output.pak> [rule...]
+//
+// The about page rules are always applied. With `--ini`, the rules of the
+// `[pak_patch]` section of that file follow, so the tool patches exactly what
+// the dll would. Each extra rule is written like a value of that section:
+// "marker","search","replace".
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/ini.h"
+#include "../src/pakfile.h"
+#include "../src/pakrules.h"
+
+namespace {
+
+bool ReadFile(const char* path, std::vector<uint8_t>& data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  data.assign(std::istreambuf_iterator<char>(file),
+              std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+bool WriteFile(const char* path, const std::vector<uint8_t>& data) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  return static_cast<bool>(file.flush());
+}
+
+// `wchar_t` holds UTF-16 on Windows and UTF-32 elsewhere.
+std::string EncodeUtf8(std::wstring_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    char32_t code_point = static_cast<char32_t>(text[i]);
+    if constexpr (sizeof(wchar_t) == 2) {
+      if (code_point >= 0xD800 && code_point < 0xDC00 &&
+          i + 1 < text.size() && text[i + 1] >= 0xDC00 &&
+          text[i + 1] <= 0xDFFF) {
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) +
+                     (static_cast<char32_t>(text[++i]) - 0xDC00);
+      }
+    }
+    if (code_point < 0x80) {
+      result += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+      result += static_cast<char>(0xC0 | (code_point >> 6));
+      result += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+      result += static_cast<char>(0xE0 | (code_point >> 12));
+      result += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+      result += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+      result += static_cast<char>(0xF0 | (code_point >> 18));
+      result += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+      result += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+      result += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+  }
+  return result;
+}
+
+// Appends the rules of the `[pak_patch]` section of the ini at `path`, the
+// same way `Config::LoadPakPatchRules` reads them.
+bool AppendIniRules(const char* path, std::vector<PakPatchRule>& rules) {
+  auto ini = IniFile::Load(path);
+  if (!ini) {
+    std::fprintf(stderr, "Cannot read %s\n", path);
+    return false;
+  }
+  for (const auto& [name, value] : ini->GetSection(L"pak_patch")) {
+    auto rule = ParsePakPatchRule(EncodeUtf8(value));
+    if (!rule) {
+      // Skipped like the dll does, which only logs it.
+      std::fprintf(stderr, "Skipping invalid rule in %s: %s\n", path,
+                   EncodeUtf8(name).c_str());
+      continue;
+    }
+    rules.push_back(std::move(*rule));
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* ini_path = nullptr;
+  if (argc > 2 && std::strcmp(argv[1], "--ini") == 0) {
+    ini_path = argv[2];
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc < 3) {
+    std::fprintf(stderr,
+                 "Usage: pak_tool [--ini <chrome++.ini>] <input.pak> "
+                 "<output.pak> [rule...]\n");
+    return 2;
+  }
+
+  std::vector<PakPatchRule> rules = GetAboutPagePatchRules();
+  if (ini_path && !AppendIniRules(ini_path, rules)) {
+    return 2;
+  }
+  for (int i = 3; i < argc; ++i) {
+    auto rule = ParsePakPatchRule(argv[i]);
+    if (!rule) {
+      std::fprintf(stderr, "Invalid rule: %s\n", argv[i]);
+      return 2;
+    }
+    rules.push_back(std::move(*rule));
+  }
+  PakPatcher patcher(std::move(rules));
+
+  std::vector<uint8_t> input;
+  if (!ReadFile(argv[1], input)) {
+    std::fprintf(stderr, "Cannot read %s\n", argv[1]);
+    return 1;
+  }
+
+  int patched_count = 0;
+  std::vector<uint8_t> output;
+  bool rebuilt = RebuildGZIPFile(
+      input, patcher.markers(),
+      [&](uint16_t resource_id, std::string_view data, std::string& patched) {
+        if (!patcher.Apply(data, patched)) {
+          return false;
+        }
+        std::printf("Patched resource %u\n", resource_id);
+        ++patched_count;
+        return true;
+      },
+      output);
+  if (!rebuilt) {
+    std::fprintf(stderr, "%s is not a supported pak file\n", argv[1]);
+    return 1;
+  }
+  if (patched_count == 0) {
+    std::fprintf(stderr, "No resource matched the patch rules\n");
+    return 1;
+  }
+
+  if (!WriteFile(argv[2], output)) {
+    std::fprintf(stderr, "Cannot write %s\n", argv[2]);
+    return 1;
+  }
+  return 0;
+}
@@ -2,49 +2,74 @@ add_rules("mode.debug", "mode.release")
 
 set_warnings("more")
 
-add_defines("WIN32", "_WIN32", "UNICODE", "_UNICODE")
 set_encodings("source:utf-8")
--- set_languages("c++23")
--- xmake does not currently check for `/std:c++23preview`, but cl only supports it.
--- https://github.com/xmake-io/xmake/issues/6327
-add_cxflags("/std:c++23preview", {force = true})
 set_fpmodels("precise") -- Default
-if is_mode("release") then
-    set_exceptions("none")
-    set_optimize("smallest")
-    set_runtimes("MT")
-    add_requires("vc-ltl5")
-    add_defines("NDEBUG")
-    add_ldflags("/DYNAMICBASE")
-    set_policy("build.optimization.lto", true)
+
+if is_plat("windows") then
+    add_defines("WIN32", "_WIN32", "UNICODE", "_UNICODE")
+    -- set_languages("c++23")
+    -- xmake does not currently check for `/std:c++23preview`, but cl only supports it.
+    -- https://github.com/xmake-io/xmake/issues/6327
+    add_cxflags("/std:c++23preview", {force = true})
+    if is_mode("release") then
+        set_exceptions("none")
+        set_optimize("smallest")
+        set_runtimes("MT")
+        add_requires("vc-ltl5")
+        add_defines("NDEBUG")
+        add_ldflags("/DYNAMICBASE")
+        set_policy("build.optimization.lto", true)
+    end
+
+    if is_mode("debug") then
+        set_runtimes("MTd")
+        add_defines("_DEBUG")
+        add_ldflags("/DYNAMICBASE")
+    end
+else
+    -- Only `pak_tool` builds on other platforms.
+    set_languages("c++23")
+    if is_mode("release") then
+        add_defines("NDEBUG")
+    end
 end
 
-if is_mode("debug") then
-    set_runtimes("MTd")
-    add_defines("_DEBUG")
-    add_ldflags("/DYNAMICBASE")
+-- The tests, benchmarks and fuzzers in tests/ cover the portable code and
+-- build on every platform:
+--   xmake f --tests=y && xmake build -g tests && xmake test
+option("tests")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Build the tests, benchmarks and fuzzers")
+option_end()
+
+if has_config("tests") then
+    add_requires("gtest", {configs = {main = true}})
+    add_requires("benchmark")
 end
 
-target("detours")
-    set_kind("static")
-    add_includedirs("detours/src", {public=true})
-    add_files(
-        "detours/src/detours.cpp",
-        "detours/src/disasm.cpp",
-        "detours/src/image.cpp",
-        "detours/src/modules.cpp"
-    )
-    if is_arch("x86") then
-        add_defines("_X86_")
-        add_files("detours/src/disolx86.cpp")
-    elseif is_arch("x64") then
-        add_defines("_AMD64_")
-        add_files("detours/src/disolx64.cpp")
-    elseif is_arch("arm64") then
-        add_defines("_ARM64_")
-        add_files("detours/src/disolarm64.cpp")
-    end
-    add_cxflags("-Wno-unknown-pragmas", "-Wno-reorder-ctor", "-Wno-unused-local-typedef", {tools = "clang_cl", force = true})
+if is_plat("windows") then
+    target("detours")
+        set_kind("static")
+        add_includedirs("detours/src", {public=true})
+        add_files(
+            "detours/src/detours.cpp",
+            "detours/src/disasm.cpp",
+            "detours/src/image.cpp",
+            "detours/src/modules.cpp"
+        )
+        if is_arch("x86") then
+            add_defines("_X86_")
+            add_files("detours/src/disolx86.cpp")
+        elseif is_arch("x64") then
+            add_defines("_AMD64_")
+            add_files("detours/src/disolx64.cpp")
+        elseif is_arch("arm64") then
+            add_defines("_ARM64_")
+            add_files("detours/src/disolarm64.cpp")
+        end
+        add_cxflags("-Wno-unknown-pragmas", "-Wno-reorder-ctor", "-Wno-unused-local-typedef", {tools = "clang_cl", force = true})
+end
 
 target("mini_gzip")
     set_kind("static")
@@ -52,24 +77,250 @@ target("mini_gzip")
     add_files("mini_gzip/miniz.c", "mini_gzip/mini_gzip.c")
     add_cxflags("/wd5287", "/wd4267", {tools = "cl"}) 
 
-target("chrome_plus")
-    set_kind("shared")
-    set_targetdir("$(builddir)/$(mode)")
-    set_basename("version")
-    add_deps("detours")
-    add_deps("mini_gzip")
-    add_files("src/*.cc")
-    add_files("src/*.rc")
-    add_links("onecore", "propsys", "oleacc")
-    if is_mode("release") then
-        add_packages("vc-ltl5")
-    end
-    after_build(function (target)
+if is_plat("windows") then
+    target("chrome_plus")
+        set_kind("shared")
+        set_targetdir("$(builddir)/$(mode)")
+        set_basename("version")
+        add_deps("detours")
+        add_deps("mini_gzip")
+        add_files("src/*.cc")
+        add_files("src/*.rc")
+        add_links("onecore", "propsys", "oleacc")
         if is_mode("release") then
-            for _, file in ipairs(os.files("$(builddir)/release/*")) do
-                if not file:endswith("dll") then
-                    os.rm(file)
+            add_packages("vc-ltl5")
+        end
+        after_build(function (target)
+            if is_mode("release") then
+                for _, file in ipairs(os.files("$(builddir)/release/*")) do
+                    if not file:endswith("dll") then
+                        os.rm(file)
+                    end
                 end
             end
+        end)
+end
+
+target("pak_tool")
+    set_kind("binary")
+    set_default(false)
+    -- Kept out of the release directory, which only keeps the dll.
+    set_targetdir("$(builddir)/$(mode)/tools")
+    add_deps("mini_gzip")
+    add_files(
+        "tools/pak_tool.cc",
+        "src/fastsearch.cc",
+        "src/ini.cc",
+        "src/pakfile.cc",
+        "src/pakrules.cc"
+    )
+    if is_plat("linux") then
+        add_syslinks("pthread")
+    end
+
+if has_config("tests") then
+    target("accessibletree_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/accessibletree_benchmark.cc")
+        add_packages("benchmark")
+
+    target("fastsearch_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/fastsearch_benchmark.cc", "src/fastsearch.cc")
+        add_packages("benchmark")
+
+    target("hook_replay_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/hook_replay_benchmark.cc")
+        add_packages("benchmark")
+
+    target("ini_unittest")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/ini_unittest.cc", "src/ini.cc")
+        add_packages("gtest")
+        add_tests("default")
+
+    target("ini_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/ini_benchmark.cc", "src/ini.cc")
+        add_packages("benchmark")
+
+    target("inputsequence_unittest")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/inputsequence_unittest.cc")
+        -- Stands in for the `INPUT` types outside Windows.
+        if not is_plat("windows") then
+            add_includedirs("tests/fake_windows")
+        end
+        add_packages("gtest")
+        add_tests("default")
+
+    target("inputsequence_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/inputsequence_benchmark.cc")
+        if not is_plat("windows") then
+            add_includedirs("tests/fake_windows")
+        end
+        add_packages("benchmark")
+
+    -- Watches the ini file with inotify.
+    if is_plat("linux") then
+        target("snapshot_stresstest")
+            set_kind("binary")
+            set_group("tests")
+            set_targetdir("$(builddir)/$(mode)/tests")
+            set_exceptions("cxx")
+            add_files("tests/snapshot_stresstest.cc", "src/ini.cc")
+            add_packages("gtest")
+            add_syslinks("pthread")
+            add_tests("default")
+    end
+
+    target("keybindings_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/keybindings_benchmark.cc")
+        add_packages("benchmark")
+
+    target("pakcache_unittest")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_deps("mini_gzip")
+        add_files(
+            "tests/pakcache_unittest.cc",
+            "src/fastsearch.cc",
+            "src/pakcache.cc",
+            "src/pakfile.cc"
+        )
+        add_packages("gtest")
+        add_tests("default")
+        if is_plat("linux") then
+            add_syslinks("pthread")
         end
-    end)
\ No newline at end of file
+
+    target("pakcache_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_deps("mini_gzip")
+        add_files(
+            "tests/pakcache_benchmark.cc",
+            "src/fastsearch.cc",
+            "src/pakcache.cc",
+            "src/pakfile.cc",
+            "src/pakrules.cc"
+        )
+        add_packages("benchmark")
+        if is_plat("linux") then
+            add_syslinks("pthread")
+        end
+
+    target("pakfile_unittest")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_deps("mini_gzip")
+        add_files(
+            "tests/pakfile_unittest.cc",
+            "src/fastsearch.cc",
+            "src/pakfile.cc"
+        )
+        add_packages("gtest")
+        add_tests("default")
+        if is_plat("linux") then
+            add_syslinks("pthread")
+        end
+
+    target("pakreader_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_deps("mini_gzip")
+        add_files(
+            "tests/pakreader_benchmark.cc",
+            "src/fastsearch.cc",
+            "src/pakfile.cc"
+        )
+        add_packages("benchmark")
+        if is_plat("linux") then
+            add_syslinks("pthread")
+        end
+
+    -- libFuzzer only ships with clang, so the fuzzers are a group of their
+    -- own: xmake f --toolchain=clang --tests=y && xmake build -g fuzzers
+    target("pakreader_fuzzer")
+        set_kind("binary")
+        set_group("fuzzers")
+        set_default(false)
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_deps("mini_gzip")
+        add_files(
+            "tests/pakreader_fuzzer.cc",
+            "src/fastsearch.cc",
+            "src/pakfile.cc"
+        )
+        add_cxflags("-fsanitize=fuzzer,address,undefined")
+        add_ldflags("-fsanitize=fuzzer,address,undefined")
+        if is_plat("linux") then
+            add_syslinks("pthread")
+        end
+
+    target("pakrules_unittest")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/pakrules_unittest.cc", "src/pakrules.cc")
+        add_packages("gtest")
+        add_tests("default")
+
+    target("searcher_unittest")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files("tests/searcher_unittest.cc", "src/fastsearch.cc")
+        add_packages("gtest")
+        add_tests("default")
+
+    target("searcher_benchmark")
+        set_kind("binary")
+        set_group("tests")
+        set_targetdir("$(builddir)/$(mode)/tests")
+        set_exceptions("cxx")
+        add_files(
+            "tests/searcher_benchmark.cc",
+            "src/fastsearch.cc",
+            "src/pakrules.cc"
+        )
+        add_packages("benchmark")
+end